@@ -2,6 +2,8 @@
 #define _FILE_OFFSET_BITS 64
 #define __STDC_FORMAT_MACROS
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <memory>
 
@@ -43,6 +45,39 @@ int gettimeofday(struct timeval* tp, struct timezone* tzp) {
 
 #include "FSEQFile.h"
 
+#if __has_include("trace.h")
+#include "trace.h"
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
+
+#if __has_include("range_copy.h")
+#include "range_copy.h"
+static inline size_t GatherRanges(uint8_t* packed, const uint8_t* frame, const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+    return RangeCopy::Gather(packed, frame, ranges.data(), ranges.size());
+}
+static inline size_t ScatterRanges(uint8_t* frame, const uint8_t* packed, const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+    return RangeCopy::Scatter(frame, packed, ranges.data(), ranges.size());
+}
+#else
+static inline size_t GatherRanges(uint8_t* packed, const uint8_t* frame, const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+    size_t offset = 0;
+    for (auto& rng : ranges) {
+        memcpy(&packed[offset], &frame[rng.first], rng.second);
+        offset += rng.second;
+    }
+    return offset;
+}
+static inline size_t ScatterRanges(uint8_t* frame, const uint8_t* packed, const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+    size_t offset = 0;
+    for (auto& rng : ranges) {
+        memcpy(&frame[rng.first], &packed[offset], rng.second);
+        offset += rng.second;
+    }
+    return offset;
+}
+#endif
+
 #if defined(PLATFORM_OSX)
 #define PLATFORM_UNKNOWN
 #endif
@@ -62,6 +97,9 @@ auto format_as(T t) {
 
 template<typename... Args>
 static void LogErr(int i, const char* fmt, Args... args) {
+    if (!spdlog::should_log(spdlog::level::err)) {
+        return;
+    }
     char buf[256];
     const char* nfmt = fmt;
     if (fmt[strlen(fmt) - 1] == '\n') {
@@ -73,6 +111,9 @@ static void LogErr(int i, const char* fmt, Args... args) {
 }
 template<typename... Args>
 static void LogInfo(int i, const char* fmt, Args... args) {
+    if (!spdlog::should_log(spdlog::level::info)) {
+        return;
+    }
     char buf[256];
     const char* nfmt = fmt;
     if (fmt[strlen(fmt) - 1] == '\n') {
@@ -84,6 +125,9 @@ static void LogInfo(int i, const char* fmt, Args... args) {
 }
 template<typename... Args>
 static void LogDebug(int i, const char* fmt, Args... args) {
+    if (!spdlog::should_log(spdlog::level::debug)) {
+        return;
+    }
     char buf[256];
     const char* nfmt = fmt;
     if (fmt[strlen(fmt) - 1] == '\n') {
@@ -166,6 +210,14 @@ inline void AddSlowStorageWarning() {}
 #define VB_ALL 0
 #endif
 
+// Per block and per frame messages are compiled out unless FSEQ_ENABLE_TRACE_LOGGING
+// is defined, the arguments are not even evaluated
+#ifdef FSEQ_ENABLE_TRACE_LOGGING
+#define FSEQ_LOG_TRACE(i, ...) LogDebug(i, __VA_ARGS__)
+#else
+#define FSEQ_LOG_TRACE(i, ...) do {} while (0)
+#endif
+
 #ifndef NO_ZSTD
 #ifndef LINUX
 //zstd on Debian 11 doesn't have the thread pool stuff
@@ -234,6 +286,38 @@ inline uint64_t GetTime(void) {
     return now_tv.tv_sec * 1000000LL + now_tv.tv_usec;
 }
 
+// Adds the exclusive time spent in one stage to an optional FSEQFile::Stats.
+// Time recorded by timers nested inside this one (eg: writes done from
+// within the compressor) is subtracted so every nanosecond is counted once.
+class StageTimer {
+public:
+    StageTimer(FSEQFile::Stats* stats, FSEQFile::Stats::Stage stage, uint64_t bytes = 0) :
+        m_stats(stats),
+        m_stage(stage),
+        m_bytes(bytes) {
+        if (m_stats) {
+            m_nestedStart = m_stats->totalNanos();
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+    ~StageTimer() {
+        if (m_stats) {
+            uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+            uint64_t nested = m_stats->totalNanos() - m_nestedStart;
+            m_stats->nanos[m_stage] += elapsed > nested ? elapsed - nested : 0;
+            m_stats->bytes[m_stage] += m_bytes;
+        }
+    }
+    void addBytes(uint64_t b) { m_bytes += b; }
+
+private:
+    FSEQFile::Stats* m_stats;
+    FSEQFile::Stats::Stage m_stage;
+    uint64_t m_bytes;
+    uint64_t m_nestedStart = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
 inline long roundTo4Internal(long i) {
     long remainder = i % 4;
     if (remainder == 0) {
@@ -280,9 +364,10 @@ static const int V1ESEQ_MINOR_VERSION = 0;
 static const int V1ESEQ_MAJOR_VERSION = 2;
 static const int V1ESEQ_HEADER_IDENTIFIER = 'E';
 static const int V1ESEQ_CHANNEL_DATA_OFFSET = 20;
-static const int V1ESEQ_STEP_TIME = 50;
+static const int V1ESEQ_STEP_TIME = ESEQFile::StepTime;
 
 FSEQFile* FSEQFile::openFSEQFile(const std::string& fn) {
+    TRACE_SCOPE("openFSEQFile");
     FILE* seqFile = fopen((const char*)fn.c_str(), "rb");
     if (seqFile == NULL) {
         LogErr(VB_SEQUENCE, "Error pre-reading FSEQ file (%s), fopen returned NULL\n", fn.c_str());
@@ -381,6 +466,20 @@ FSEQFile* FSEQFile::createFSEQFile(const std::string& fn,
     LogErr(VB_SEQUENCE, "Error creating FSEQ file (%s), unknown version %d\n", fn.c_str(), version);
     return nullptr;
 }
+FSEQFile* FSEQFile::createESEQFile(const std::string& fn,
+                                   uint32_t modelStart,
+                                   uint32_t modelLength) {
+    if (modelLength == 0) {
+        LogErr(VB_SEQUENCE, "Error creating ESEQ file (%s), the model has no channels\n", fn.c_str());
+        return nullptr;
+    }
+    ESEQFile* f = new ESEQFile(fn, modelStart, modelLength);
+    if (!f->m_seqFile) {
+        delete f;
+        f = nullptr;
+    }
+    return f;
+}
 std::string FSEQFile::getMediaFilename(const std::string& fn) {
     std::unique_ptr<FSEQFile> file(FSEQFile::openFSEQFile(fn));
     if (file) {
@@ -398,6 +497,12 @@ std::string FSEQFile::getMediaFilename() const {
     return "";
 }
 
+void FSEQFile::removeVariableHeader(char c0, char c1) {
+    m_variableHeaders.erase(std::remove_if(m_variableHeaders.begin(), m_variableHeaders.end(), [c0, c1](const VariableHeader& a) {
+        return a.code[0] == c0 && a.code[1] == c1;
+    }), m_variableHeaders.end());
+}
+
 static const int FSEQ_DEFAULT_STEP_TIME = 50;
 static const int FSEQ_VARIABLE_HEADER_SIZE = 4;
 
@@ -504,6 +609,8 @@ uint64_t FSEQFile::tell() {
 }
 
 uint64_t FSEQFile::write(const void* ptr, uint64_t size) {
+    TRACE_SCOPE("write");
+    StageTimer timer(m_stats, Stats::Write, size);
     if (m_seqFile) {
         return fwrite(ptr, 1, size, m_seqFile);
     }
@@ -516,7 +623,11 @@ uint64_t FSEQFile::write(const void* ptr, uint64_t size) {
 }
 
 uint64_t FSEQFile::read(void* ptr, uint64_t size) {
-    return fread(ptr, 1, size, m_seqFile);
+    TRACE_SCOPE("read");
+    StageTimer timer(m_stats, Stats::Read);
+    uint64_t r = fread(ptr, 1, size, m_seqFile);
+    timer.addBytes(r);
+    return r;
 }
 
 void FSEQFile::preload(uint64_t pos, uint64_t size) {
@@ -622,7 +733,10 @@ void FSEQFile::parseVariableHeaders(const std::vector<uint8_t>& header, int read
     }
 }
 void FSEQFile::finalize() {
-    fflush(m_seqFile);
+    //fflush(nullptr) would flush every open stream
+    if (m_seqFile) {
+        fflush(m_seqFile);
+    }
 }
 
 static const int V1FSEQ_HEADER_SIZE = 28;
@@ -732,13 +846,122 @@ V1FSEQFile::V1FSEQFile(const std::string& fn, FILE* file, const std::vector<uint
 V1FSEQFile::~V1FSEQFile() {
 }
 
+FSEQFile::RangePlan::RangePlan(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t channelLimit, bool keepOrder) {
+    m_runs.reserve(ranges.size());
+    for (auto rng : ranges) {
+        //make sure we don't read beyond the end of the sequence data
+        if (rng.first >= channelLimit || rng.second == 0) {
+            continue;
+        }
+        rng.second = std::min(rng.second, channelLimit - rng.first);
+        m_runs.push_back(rng);
+    }
+    m_sorted = m_runs;
+    std::sort(m_sorted.begin(), m_sorted.end());
+    std::vector<std::pair<uint32_t, uint32_t>> merged;
+    for (auto& rng : m_sorted) {
+        if (!merged.empty() && rng.first <= merged.back().first + merged.back().second) {
+            uint32_t end = std::max(merged.back().first + merged.back().second, rng.first + rng.second);
+            merged.back().second = end - merged.back().first;
+        } else {
+            merged.push_back(rng);
+        }
+    }
+    m_sorted = merged;
+    if (keepOrder) {
+        //the packed layout has to stay as is, only join runs that are contiguous in both
+        merged.clear();
+        for (auto& rng : m_runs) {
+            if (!merged.empty() && rng.first == merged.back().first + merged.back().second) {
+                merged.back().second += rng.second;
+            } else {
+                merged.push_back(rng);
+            }
+        }
+    }
+    m_runs = std::move(merged);
+    m_offsets.reserve(m_runs.size());
+    for (auto& rng : m_runs) {
+        m_offsets.push_back(m_size);
+        m_size += rng.second;
+        m_end = std::max(m_end, rng.first + rng.second);
+    }
+}
+
+bool FSEQFile::RangePlan::contains(uint32_t start, uint32_t count) const {
+    auto it = std::upper_bound(m_sorted.begin(), m_sorted.end(), start,
+                               [](uint32_t ch, const std::pair<uint32_t, uint32_t>& rng) { return ch < rng.first; });
+    if (it == m_sorted.begin()) {
+        return false;
+    }
+    --it;
+    return (uint64_t)start + count <= (uint64_t)it->first + it->second;
+}
+
+uint64_t FSEQFile::CoalesceRanges(std::vector<std::pair<uint32_t, uint32_t>>& ranges, size_t maxRanges, uint32_t maxGap) {
+    std::vector<std::pair<uint32_t, uint32_t>> sorted;
+    for (auto& rng : ranges) {
+        if (rng.second != 0) {
+            sorted.push_back(rng);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::pair<uint32_t, uint32_t>> merged;
+    for (auto& rng : sorted) {
+        if (!merged.empty() && rng.first <= merged.back().first + merged.back().second) {
+            uint32_t end = std::max(merged.back().first + merged.back().second, rng.first + rng.second);
+            merged.back().second = end - merged.back().first;
+        } else {
+            merged.push_back(rng);
+        }
+    }
+    if (merged.size() < 2) {
+        ranges = merged;
+        return 0;
+    }
+
+    //closing the smallest gaps first pads the fewest channels for a given range count
+    std::vector<uint32_t> gaps(merged.size() - 1);
+    std::vector<size_t> order(gaps.size());
+    for (size_t x = 0; x < gaps.size(); x++) {
+        gaps[x] = merged[x + 1].first - (merged[x].first + merged[x].second);
+        order[x] = x;
+    }
+    std::stable_sort(order.begin(), order.end(), [&gaps](size_t a, size_t b) { return gaps[a] < gaps[b]; });
+    size_t toClose = 0;
+    while (toClose < order.size() && gaps[order[toClose]] <= maxGap) {
+        toClose++;
+    }
+    if (maxRanges > 0 && merged.size() - toClose > maxRanges) {
+        toClose = merged.size() - maxRanges;
+    }
+    std::vector<bool> close(gaps.size(), false);
+    for (size_t x = 0; x < toClose; x++) {
+        close[order[x]] = true;
+    }
+
+    uint64_t padded = 0;
+    ranges.clear();
+    ranges.push_back(merged[0]);
+    for (size_t x = 1; x < merged.size(); x++) {
+        if (close[x - 1]) {
+            padded += gaps[x - 1];
+            ranges.back().second = merged[x].first + merged[x].second - ranges.back().first;
+        } else {
+            ranges.push_back(merged[x]);
+        }
+    }
+    return padded;
+}
+
 class UncompressedFrameData : public FSEQFile::FrameData {
 public:
     UncompressedFrameData(uint32_t frame,
                           uint32_t sz,
-                          const std::vector<std::pair<uint32_t, uint32_t>>& ranges) :
+                          const std::shared_ptr<const FSEQFile::RangePlan>& plan) :
         FrameData(frame),
-        m_ranges(ranges) {
+        m_plan(plan),
+        m_ranges(plan->runs()) {
         m_size = sz;
         m_data = (uint8_t*)malloc(sz);
     }
@@ -751,12 +974,20 @@ public:
     virtual bool readFrame(uint8_t* data, uint32_t maxChannels) override {
         if (m_data == nullptr)
             return false;
+        if (m_plan->end() <= maxChannels && m_plan->size() <= m_size) {
+            //everything fits, no per range clipping needed
+            ScatterRanges(data, m_data, m_ranges);
+            return true;
+        }
         uint32_t offset = 0;
         for (auto& rng : m_ranges) {
             uint32_t toRead = rng.second;
             if (offset + toRead <= m_size) {
-                uint32_t toCopy = std::min(toRead, maxChannels - rng.first);
-                memcpy(&data[rng.first], &m_data[offset], toCopy);
+                //a range starting past the buffer has nothing to copy, the subtraction would wrap
+                if (rng.first < maxChannels) {
+                    uint32_t toCopy = std::min(toRead, maxChannels - rng.first);
+                    memcpy(&data[rng.first], &m_data[offset], toCopy);
+                }
                 offset += toRead;
             } else {
                 return false;
@@ -775,20 +1006,23 @@ public:
 
     uint32_t m_size;
     uint8_t* m_data;
-    std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    //shared by every frame read since the last prepareRead
+    std::shared_ptr<const FSEQFile::RangePlan> m_plan;
+    const std::vector<std::pair<uint32_t, uint32_t>>& m_ranges;
 };
 
 void V1FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t startFrame) {
-    m_rangesToRead = ranges;
-    m_dataBlockSize = 0;
-    for (auto& rng : m_rangesToRead) {
-        //make sure we don't read beyond the end of the sequence data
-        int toRead = rng.second;
-        if ((rng.first + toRead) > m_seqChannelCount) {
-            toRead = m_seqChannelCount - rng.first;
-            rng.second = toRead;
-        }
-        m_dataBlockSize += toRead;
+    m_readPlan = std::make_shared<const RangePlan>(ranges, m_seqChannelCount);
+    if (m_readPlan->empty()) {
+        std::vector<std::pair<uint32_t, uint32_t>> all;
+        all.push_back(std::pair<uint32_t, uint32_t>(0, m_seqChannelCount));
+        m_readPlan = std::make_shared<const RangePlan>(all, m_seqChannelCount);
+    }
+    m_rangesToRead = m_readPlan->runs();
+    m_dataBlockSize = m_readPlan->size();
+    //a file without channels has nothing to prime, and getFrame would prepare it again
+    if (m_rangesToRead.empty()) {
+        return;
     }
     FrameData* f = getFrame(startFrame);
     if (f) {
@@ -797,7 +1031,7 @@ void V1FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>>& r
 }
 
 FrameData* V1FSEQFile::getFrame(uint32_t frame) {
-    if (m_rangesToRead.empty()) {
+    if (!m_readPlan) {
         std::vector<std::pair<uint32_t, uint32_t>> range;
         range.push_back(std::pair<uint32_t, uint32_t>(0, m_seqChannelCount));
         prepareRead(range, frame);
@@ -806,7 +1040,7 @@ FrameData* V1FSEQFile::getFrame(uint32_t frame) {
     offset *= frame;
     offset += m_seqChanDataOffset;
 
-    UncompressedFrameData* data = new UncompressedFrameData(frame, m_dataBlockSize, m_rangesToRead);
+    UncompressedFrameData* data = new UncompressedFrameData(frame, m_dataBlockSize, m_readPlan);
     if (seek(offset, SEEK_SET)) {
         LogErr(VB_SEQUENCE, "Failed to seek to proper offset for channel data for frame %d! %" PRIu64 "\n", frame, offset);
         return data;
@@ -843,8 +1077,67 @@ uint32_t V1FSEQFile::getMaxChannel() const {
     return m_seqChannelCount;
 }
 
+ESEQFile::ESEQFile(const std::string& fn, uint32_t modelStart, uint32_t modelLength) :
+    FSEQFile(fn),
+    m_modelStart(modelStart),
+    m_modelLength(modelLength) {
+    m_seqVersionMinor = V1ESEQ_MINOR_VERSION;
+    m_seqVersionMajor = V1ESEQ_MAJOR_VERSION;
+    m_seqChannelCount = modelLength;
+}
+
+ESEQFile::~ESEQFile() {
+}
+
+FSEQFile::FrameData* ESEQFile::getFrame(uint32_t frame) {
+    LogErr(VB_SEQUENCE, "ESEQ file (%s) is open for writing, reopen it to read frames\n", m_filename.c_str());
+    return nullptr;
+}
+
+void ESEQFile::writeHeader() {
+    uint8_t header[V1ESEQ_CHANNEL_DATA_OFFSET];
+    memset(header, 0, sizeof(header));
+
+    // File identifier (ESEQ) - 4 bytes
+    header[0] = V1ESEQ_HEADER_IDENTIFIER;
+    header[1] = 'S';
+    header[2] = 'E';
+    header[3] = 'Q';
+
+    // Model count, always 1 - 1 byte, then 1 reserved byte
+    header[4] = 1;
+    header[5] = 0;
+
+    // File format version - 2 bytes
+    header[6] = V1ESEQ_MINOR_VERSION;
+    header[7] = V1ESEQ_MAJOR_VERSION;
+
+    // Step size, the channels in each frame - 4 bytes
+    write4ByteUInt(&header[8], m_modelLength);
+    // Model start channel, 1 based - 4 bytes
+    write4ByteUInt(&header[12], m_modelStart + 1);
+    // Model length - 4 bytes
+    write4ByteUInt(&header[16], m_modelLength);
+
+    // initializeFromFSEQ copies the source's channel count, the frames only hold the model
+    m_seqChannelCount = m_modelLength;
+    m_seqChanDataOffset = V1ESEQ_CHANNEL_DATA_OFFSET;
+    write(header, V1ESEQ_CHANNEL_DATA_OFFSET);
+    LogDebug(VB_SEQUENCE, "Setup for writing ESEQ, model at %d, %d channels\n", m_modelStart + 1, m_modelLength);
+}
+
+void ESEQFile::addFrame(uint32_t frame,
+                        const uint8_t* data) {
+    write(data + m_modelStart, m_modelLength);
+}
+
+uint32_t ESEQFile::getMaxChannel() const {
+    return m_modelStart + m_modelLength;
+}
+
 static const int V2FSEQ_HEADER_SIZE = 32;
 static const int V2FSEQ_SPARSE_RANGE_SIZE = 6;
+static const size_t V2FSEQ_MAX_SPARSE_RANGES = 255;
 static const int V2FSEQ_COMPRESSION_BLOCK_SIZE = 8;
 #if !defined(NO_ZLIB) || !defined(NO_ZSTD)
 static const int V2FSEQ_OUT_BUFFER_SIZE = 32 * 1024 * 1024;        // 32MB output buffer
@@ -882,6 +1175,15 @@ public:
     void preload(uint64_t pos, uint64_t size) {
         m_file->preload(pos, size);
     }
+    FSEQFile::Stats* stats() {
+        return m_file->getStats();
+    }
+    //packs the sparse ranges of a full frame so they go out in a single write/compress call
+    const uint8_t* packSparseRanges(const uint8_t* data) {
+        m_sparseFrame.resize(m_file->getChannelCount());
+        GatherRanges(m_sparseFrame.data(), data, m_file->m_sparseRanges);
+        return m_sparseFrame.data();
+    }
 
     virtual void prepareRead(uint32_t frame) {}
 
@@ -906,6 +1208,7 @@ public:
     uint64_t m_seqChanDataOffset = 0;
     
     std::vector<uint64_t> m_variableHeaderOffsets;
+    std::vector<uint8_t> m_sparseFrame;
 };
 
 class V2NoneCompressionHandler : public V2Handler {
@@ -923,7 +1226,8 @@ public:
         }
     }
     virtual FrameData* getFrame(uint32_t frame) override {
-        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
+        TRACE_SCOPE("getFrame");
+        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_readPlan);
         uint64_t offset = m_file->getChannelCount();
         offset *= frame;
         offset += m_seqChanDataOffset;
@@ -956,12 +1260,11 @@ public:
         return data;
     }
     virtual void addFrame(uint32_t frame, const uint8_t* data) override {
+        TRACE_SCOPE("addFrame");
         if (m_file->m_sparseRanges.empty()) {
             write(data, m_file->getChannelCount());
         } else {
-            for (auto& a : m_file->m_sparseRanges) {
-                write(&data[a.first], a.second);
-            }
+            write(packSparseRanges(data), m_file->getChannelCount());
         }
     }
 };
@@ -1017,6 +1320,7 @@ public:
     }
 
     virtual void finalize() override {
+        TRACE_SCOPE("write block index");
         uint64_t lastFrame = tell();
         uint64_t off = V2FSEQ_HEADER_SIZE;
         seek(off, SEEK_SET);
@@ -1096,6 +1400,7 @@ public:
     virtual std::string GetType() const override { return "Compressed ZSTD"; }
 
     virtual FrameData *getFrame(uint32_t frame) override {
+        TRACE_SCOPE("zstd getFrame");
 
         if (m_file == nullptr) LogDebug(VB_SEQUENCE, " getFrame m_file unexpectantly null.\n");
 
@@ -1112,6 +1417,7 @@ public:
                 if (m_dctx == nullptr) LogDebug(VB_SEQUENCE, " getFrame ZSTD_createDStream failed.\n");
             }
             ZSTD_initDStream(m_dctx);
+            TRACE_SCOPE("zstd load block");
             seek(m_file->m_frameOffsets[m_curBlock].second, SEEK_SET);
 
             uint64_t len = m_file->m_frameOffsets[m_curBlock + 1].second;
@@ -1173,13 +1479,17 @@ public:
                 }
             }
             m_outBuffer.size = (fidx + 1) * m_file->getChannelCount();
+            TRACE_SCOPE("zstd decompress");
+            StageTimer timer(stats(), FSEQFile::Stats::Decompress);
+            size_t const before = m_outBuffer.pos;
             ZSTD_decompressStream(m_dctx, &m_outBuffer, &m_inBuffer);
+            timer.addBytes(m_outBuffer.pos - before);
             m_curFrameInBlock = fidx + 1;
         }
 
         fidx *= m_file->getChannelCount();
         uint8_t* fdata = (uint8_t*)m_outBuffer.dst;
-        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
+        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_readPlan);
 
         // This stops the crash on load ... but it is not the root cause.
         // But better to not load completely than crashing
@@ -1189,18 +1499,12 @@ public:
             return data;
         }
 
+        StageTimer timer(stats(), FSEQFile::Stats::Extract, m_file->m_dataBlockSize);
         if (!m_file->m_sparseRanges.empty()) {
             memcpy(data->m_data, &fdata[fidx], m_file->getChannelCount());
         } else {
-            uint32_t sz = 0;
-            //read the ranges into the buffer
-            for (auto& rng : data->m_ranges) {
-                if (rng.first < m_file->getChannelCount()) {
-                    uint64_t start = fidx + rng.first;
-                    memcpy(&data->m_data[sz], &fdata[start], rng.second);
-                    sz += rng.second;
-                }
-            }
+            //prepareRead already dropped ranges past the channel count
+            GatherRanges(data->m_data, &fdata[fidx], data->m_ranges);
         }
         return data;
     }
@@ -1223,12 +1527,13 @@ public:
         }
     }
     virtual void addFrame(uint32_t frame, const uint8_t* data) override {
+        TRACE_SCOPE("zstd addFrame");
         if (m_cctx == nullptr) {
             m_cctx = ZSTD_createCStream();
         }
         if (m_curFrameInBlock == 0) {
             uint64_t offset = tell();
-            //LogDebug(VB_SEQUENCE, "  Preparing to create a compressed block of data starting at frame %d, offset  %" PRIu64 ".\n", frame, offset);
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Preparing to create a compressed block of data starting at frame %d, offset  %" PRIu64 ".\n", frame, offset);
             m_file->m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(frame, offset));
             int clevel = m_file->m_compressionLevel == -99 ? 2 : m_file->m_compressionLevel;
             if (clevel < -25 || clevel > 25) {
@@ -1256,6 +1561,7 @@ public:
 #endif
         }
 
+        StageTimer timer(stats(), FSEQFile::Stats::Compress, m_file->getChannelCount());
         uint8_t* curData = (uint8_t*)data;
         if (m_file->m_sparseRanges.empty()) {
             ZSTD_inBuffer_s input = {
@@ -1265,14 +1571,12 @@ public:
             };
             compressData(m_cctx, input, m_outBuffer);
         } else {
-            for (auto& a : m_file->m_sparseRanges) {
-                ZSTD_inBuffer_s input = {
-                    &curData[a.first],
-                    a.second,
-                    0
-                };
-                compressData(m_cctx, input, m_outBuffer);
-            }
+            ZSTD_inBuffer_s input = {
+                packSparseRanges(curData),
+                m_file->getChannelCount(),
+                0
+            };
+            compressData(m_cctx, input, m_outBuffer);
         }
 
         if (m_outBuffer.pos > V2FSEQ_OUT_BUFFER_FLUSH_SIZE) {
@@ -1286,6 +1590,7 @@ public:
         //we'll start a new block.  We want the first block to be small so startup is
         //quicker and we can get the first few frames as fast as possible.
         if ((m_curBlock == 0 && m_curFrameInBlock == 10) || (m_curFrameInBlock >= m_framesPerBlock && m_file->m_frameOffsets.size() < m_maxBlocks)) {
+            TRACE_SCOPE("zstd flush block");
             ZSTD_inBuffer_s input = {
                 0, 0, 0
             };
@@ -1294,14 +1599,16 @@ public:
                 m_outBuffer.pos = 0;
             }
             write(m_outBuffer.dst, m_outBuffer.pos);
-            //LogDebug(VB_SEQUENCE, "  Finalized block of data ending at frame %d.  Frames in block: %d.\n", frame, m_curFrameInBlock);
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Finalized block of data ending at frame %d.  Frames in block: %d.\n", frame, m_curFrameInBlock);
             m_outBuffer.pos = 0;
             m_curFrameInBlock = 0;
             m_curBlock++;
         }
     }
     virtual void finalize() override {
+        TRACE_SCOPE("zstd finalize");
         if (m_curFrameInBlock) {
+            StageTimer timer(stats(), FSEQFile::Stats::Compress);
             ZSTD_inBuffer_s input = {
                 0, 0, 0
             };
@@ -1310,7 +1617,7 @@ public:
                 m_outBuffer.pos = 0;
             }
             write(m_outBuffer.dst, m_outBuffer.pos);
-            LogDebug(VB_SEQUENCE, "  Finalized last block of data.  Frames in block: %d.\n", m_curFrameInBlock);
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Finalized last block of data.  Frames in block: %d.\n", m_curFrameInBlock);
             m_outBuffer.pos = 0;
             m_curFrameInBlock = 0;
             m_curBlock++;
@@ -1346,12 +1653,14 @@ public:
     virtual std::string GetType() const override { return "Compressed ZLIB"; }
 
     virtual FrameData* getFrame(uint32_t frame) override {
+        TRACE_SCOPE("zlib getFrame");
         if (m_curBlock >= m_file->m_frameOffsets.size() || (frame < m_file->m_frameOffsets[m_curBlock].first) || (frame >= m_file->m_frameOffsets[m_curBlock + 1].first)) {
             //frame is not in the current block
             m_curBlock = 0;
             while (frame >= m_file->m_frameOffsets[m_curBlock + 1].first) {
                 m_curBlock++;
             }
+            TRACE_SCOPE("zlib load block");
             seek(m_file->m_frameOffsets[m_curBlock].second, SEEK_SET);
             uint64_t len = m_file->m_frameOffsets[m_curBlock + 1].second;
             len -= m_file->m_frameOffsets[m_curBlock].second;
@@ -1387,7 +1696,10 @@ public:
             m_stream->next_out = m_outBuffer;
             m_stream->avail_out = outsize;
 
+            TRACE_SCOPE("zlib decompress");
+            StageTimer timer(stats(), FSEQFile::Stats::Decompress);
             inflate(m_stream, Z_SYNC_FLUSH);
+            timer.addBytes(outsize - m_stream->avail_out);
             inflateEnd(m_stream);
             free(m_stream);
             m_stream = nullptr;
@@ -1395,22 +1707,18 @@ public:
         int fidx = frame - m_file->m_frameOffsets[m_curBlock].first;
         fidx *= m_file->getChannelCount();
         uint8_t* fdata = (uint8_t*)m_outBuffer;
-        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_rangesToRead);
+        UncompressedFrameData* data = new UncompressedFrameData(frame, m_file->m_dataBlockSize, m_file->m_readPlan);
+        StageTimer timer(stats(), FSEQFile::Stats::Extract, m_file->m_dataBlockSize);
         if (!m_file->m_sparseRanges.empty()) {
             memcpy(data->m_data, &fdata[fidx], m_file->getChannelCount());
         } else {
-            uint32_t sz = 0;
-            //read the ranges into the buffer
-            for (auto& rng : data->m_ranges) {
-                if (rng.first < m_file->getChannelCount()) {
-                    memcpy(&data->m_data[sz], &fdata[fidx + rng.first], rng.second);
-                    sz += rng.second;
-                }
-            }
+            //prepareRead already dropped ranges past the channel count
+            GatherRanges(data->m_data, &fdata[fidx], data->m_ranges);
         }
         return data;
     }
     virtual void addFrame(uint32_t frame, const uint8_t* data) override {
+        TRACE_SCOPE("zlib addFrame");
         if (m_outBuffer == nullptr) {
             m_outBuffer = (uint8_t*)malloc(V2FSEQ_OUT_BUFFER_SIZE);
         }
@@ -1419,6 +1727,7 @@ public:
         }
         if (m_curFrameInBlock == 0) {
             uint64_t offset = tell();
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Preparing to create a compressed block of data starting at frame %d, offset  %" PRIu64 ".\n", frame, offset);
             m_file->m_frameOffsets.push_back(std::pair<uint32_t, uint64_t>(frame, offset));
             deflateEnd(m_stream);
             memset(m_stream, 0, sizeof(z_stream));
@@ -1433,17 +1742,16 @@ public:
             m_stream->avail_out = V2FSEQ_OUT_BUFFER_SIZE;
         }
 
+        StageTimer timer(stats(), FSEQFile::Stats::Compress, m_file->getChannelCount());
         uint8_t* curData = (uint8_t*)data;
         if (m_file->m_sparseRanges.empty()) {
             m_stream->next_in = curData;
             m_stream->avail_in = m_file->getChannelCount();
             deflate(m_stream, 0);
         } else {
-            for (auto& a : m_file->m_sparseRanges) {
-                m_stream->next_in = &curData[a.first];
-                m_stream->avail_in = a.second;
-                deflate(m_stream, 0);
-            }
+            m_stream->next_in = (Bytef*)packSparseRanges(curData);
+            m_stream->avail_in = m_file->getChannelCount();
+            deflate(m_stream, 0);
         }
         if (m_stream->avail_out < (V2FSEQ_OUT_BUFFER_SIZE - V2FSEQ_OUT_BUFFER_FLUSH_SIZE)) {
             //buffer is getting full, better flush it
@@ -1458,6 +1766,7 @@ public:
         //we'll start a new block.  We want the first block to be small so startup is
         //quicker and we can get the first few frames as fast as possible.
         if ((m_curBlock == 0 && m_curFrameInBlock == 10) || (m_curFrameInBlock == m_framesPerBlock && m_file->m_frameOffsets.size() < m_maxBlocks)) {
+            TRACE_SCOPE("zlib flush block");
             while (deflate(m_stream, Z_FINISH) != Z_STREAM_END) {
                 uint64_t sz = V2FSEQ_OUT_BUFFER_SIZE;
                 sz -= m_stream->avail_out;
@@ -1470,13 +1779,16 @@ public:
             write(m_outBuffer, sz);
             m_stream->next_out = m_outBuffer;
             m_stream->avail_out = V2FSEQ_OUT_BUFFER_SIZE;
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Finalized block of data ending at frame %d.  Frames in block: %d.\n", frame, m_curFrameInBlock);
 
             m_curFrameInBlock = 0;
             m_curBlock++;
         }
     }
     virtual void finalize() override {
+        TRACE_SCOPE("zlib finalize");
         if (m_curFrameInBlock) {
+            StageTimer timer(stats(), FSEQFile::Stats::Compress);
             while (deflate(m_stream, Z_FINISH) != Z_STREAM_END) {
                 uint64_t sz = V2FSEQ_OUT_BUFFER_SIZE;
                 sz -= m_stream->avail_out;
@@ -1489,6 +1801,7 @@ public:
             write(m_outBuffer, sz);
             m_stream->next_out = m_outBuffer;
             m_stream->avail_out = V2FSEQ_OUT_BUFFER_SIZE;
+            FSEQ_LOG_TRACE(VB_SEQUENCE, "  Finalized last block of data.  Frames in block: %d.\n", m_curFrameInBlock);
 
             m_curFrameInBlock = 0;
             m_curBlock++;
@@ -1553,6 +1866,13 @@ void V2FSEQFile::writeHeader() {
             }
         }
         m_sparseRanges = newRanges;
+        if (m_sparseRanges.size() > V2FSEQ_MAX_SPARSE_RANGES) {
+            //the count is a single byte in the header, more would corrupt the file
+            size_t count = m_sparseRanges.size();
+            uint64_t padded = CoalesceRanges(m_sparseRanges, V2FSEQ_MAX_SPARSE_RANGES);
+            LogErr(VB_SEQUENCE, "%d sparse ranges do not fit in the header, merged into %d ranges adding %d channels\n",
+                   (int)count, (int)m_sparseRanges.size(), (int)padded);
+        }
         if (!m_sparseRanges.empty()) {
             m_seqChannelCount = 0;
             for (auto& a : m_sparseRanges) {
@@ -1851,54 +2171,26 @@ void V2FSEQFile::dumpInfo(bool indent) {
     //}
 }
 
-bool isWithinRange(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t start_channel, uint32_t channel_count) {
-    for (auto& a : ranges) {
-        if ((start_channel >= a.first && start_channel < (a.first + a.second) )
-            && ((start_channel + channel_count - 1) < (a.first + a.second))) {
-            return true;
-        }
-    }
-    return false;
-}
-
 void V2FSEQFile::prepareRead(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t startFrame) {
     if (m_sparseRanges.empty()) {
-        m_rangesToRead.clear();
-        m_dataBlockSize = 0;
-        for (auto rng : ranges) {
-            //make sure we don't read beyond the end of the sequence data
-            int toRead = rng.second;
-
-            if (rng.first < m_seqChannelCount) {
-                if ((rng.first + toRead) > m_seqChannelCount) {
-                    toRead = m_seqChannelCount - rng.first;
-                    rng.second = toRead;
-                }
-                m_dataBlockSize += toRead;
-                m_rangesToRead.push_back(rng);
-            }
-        }
-        if (m_dataBlockSize == 0) {
-            m_rangesToRead.push_back(std::pair<uint32_t, uint32_t>(0, getMaxChannel()));
-            m_dataBlockSize = getMaxChannel();
+        m_readPlan = std::make_shared<const RangePlan>(ranges, m_seqChannelCount);
+        if (m_readPlan->empty()) {
+            std::vector<std::pair<uint32_t, uint32_t>> all;
+            all.push_back(std::pair<uint32_t, uint32_t>(0, getMaxChannel()));
+            m_readPlan = std::make_shared<const RangePlan>(all, getMaxChannel());
         }
-    } else if (m_compressionType != CompressionType::none) {
-        //with compression, there is no way to NOT read the entire frame of data, we'll just
-        //use the sparse data range since we'll have everything anyway so the ranges
-        //needed is relatively irrelevant
-        m_dataBlockSize = m_seqChannelCount;
-        m_rangesToRead = m_sparseRanges;
+        m_dataBlockSize = m_readPlan->size();
     } else {
-        //no compression with sparse ranges
-        //FIXME - an intersection between the two would be useful, but hard
-        //for now, just assume that if it's sparse, it has all the data that is needed
-        //and read everything
+        //sparse files are always read in full, with compression there is no way to NOT
+        //read the entire frame and without it an intersection would be useful, but hard.
+        //The plan keeps the file's own range order, that is how the frame is packed
+        m_readPlan = std::make_shared<const RangePlan>(m_sparseRanges, UINT32_MAX, true);
         m_dataBlockSize = m_seqChannelCount;
-        m_rangesToRead = m_sparseRanges;
     }
+    m_rangesToRead = m_readPlan->runs();
 
     for (auto const& [st, cnt] : ranges) {
-        if (!isWithinRange(m_rangesToRead, st, cnt)) {
+        if (!m_readPlan->contains(st, cnt)) {
             LogErr(VB_SEQUENCE, "Requested range outside Read Ranges. Requested %d channels starting at %d\n", cnt, st);
         }
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -40,6 +41,64 @@ public:
     };
     constexpr static const char* CompressionTypeStrings[] = { "none", "zstd", "zlib" };
 
+    //Optional per stage accounting.  Times are exclusive, time spent writing
+    //from inside the compressor is only counted as Write.
+    class Stats {
+        public:
+        enum Stage {
+            Read,       //bytes read from the file
+            Decompress, //bytes produced by the decompressor
+            Extract,    //bytes copied in and out of the range buffers
+            Compress,   //bytes fed to the compressor
+            Write,      //bytes written to the file
+            StageCount
+        };
+        constexpr static const char* StageStrings[] = { "read", "decompress", "extract", "compress", "write" };
+
+        uint64_t nanos[StageCount] = {};
+        uint64_t bytes[StageCount] = {};
+
+        uint64_t totalNanos() const {
+            uint64_t t = 0;
+            for (auto n : nanos) {
+                t += n;
+            }
+            return t;
+        }
+        void add(const Stats& other) {
+            for (int x = 0; x < StageCount; x++) {
+                nanos[x] += other.nanos[x];
+                bytes[x] += other.bytes[x];
+            }
+        }
+    };
+
+    //Channel ranges compiled once by prepareRead and shared by every frame read
+    //after it.  Requested ranges are clipped, sorted and merged so touching ranges
+    //become a single copy.  A sparse file's ranges describe its packed layout, so
+    //with keepOrder they stay in file order and only touching neighbours are joined.
+    class RangePlan {
+        public:
+        RangePlan(const std::vector<std::pair<uint32_t, uint32_t>> &ranges, uint32_t channelLimit, bool keepOrder = false);
+
+        const std::vector<std::pair<uint32_t, uint32_t>> &runs() const { return m_runs; }
+        //where each run starts in the packed frame buffer
+        const std::vector<uint32_t> &offsets() const { return m_offsets; }
+        uint32_t size() const { return m_size; }
+        //one past the highest channel any run touches
+        uint32_t end() const { return m_end; }
+        bool empty() const { return m_runs.empty(); }
+        bool contains(uint32_t start, uint32_t count) const;
+
+        private:
+        std::vector<std::pair<uint32_t, uint32_t>> m_runs;
+        std::vector<uint32_t> m_offsets;
+        //sorted and merged copy of m_runs for contains()
+        std::vector<std::pair<uint32_t, uint32_t>> m_sorted;
+        uint32_t m_size = 0;
+        uint32_t m_end = 0;
+    };
+
 protected:
     //open file for reading
     FSEQFile(const std::string &fn, FILE *file, const std::vector<uint8_t> &header);
@@ -56,8 +115,16 @@ public:
                                     int version,
                                     CompressionType ct = CompressionType::zstd,
                                     int level = -99);
+    //effect sequence of the modelLength channels from the 0-based modelStart
+    static FSEQFile* createESEQFile(const std::string &fn,
+                                    uint32_t modelStart,
+                                    uint32_t modelLength);
     //utility methods
     static std::string getMediaFilename(const std::string &fn);
+    //sorts and merges the ranges, then joins every gap of up to maxGap channels and
+    //after that the smallest gaps until no more than maxRanges are left.  Returns
+    //the number of channels added by filling gaps.
+    static uint64_t CoalesceRanges(std::vector<std::pair<uint32_t, uint32_t>> &ranges, size_t maxRanges, uint32_t maxGap = 0);
     std::string getMediaFilename() const;
     uint32_t getTotalTimeMS() const { return m_seqNumFrames * m_seqStepTime; }
 
@@ -101,10 +168,17 @@ public:
     void setStepTime(int st) { m_seqStepTime = st; }
     void setChannelCount(int cc) { m_seqChannelCount = cc; }
     void addVariableHeader(const VariableHeader &header) { m_variableHeaders.push_back(header);}
+    void removeVariableHeader(char c0, char c1);
+    //0 lets writeHeader pick a new id
+    void setUniqueId(uint64_t id) { m_uniqueId = id; }
 
 
     const std::vector<uint8_t> &getMemoryBuffer() const { return m_memoryBuffer;}
     uint64_t getMemoryBufferPos() const { return m_memoryBufferPos; }
+
+    //the stats object is not owned and may be shared between a source and destination file
+    void setStats(Stats* stats) { m_stats = stats; }
+    Stats* getStats() const { return m_stats; }
 protected:
     std::string   m_filename;
     uint64_t      m_uniqueId;
@@ -119,6 +193,7 @@ protected:
 protected:
     uint64_t      m_seqFileSize;
     uint64_t      m_seqChanDataOffset;
+    Stats*        m_stats = nullptr;
 
     int seek(uint64_t location, int origin);
     uint64_t tell();
@@ -154,6 +229,7 @@ public:
     //The ranges to read and the data size needed to read the ranges
     std::vector<std::pair<uint32_t, uint32_t>> m_rangesToRead;
     uint32_t m_dataBlockSize;
+    std::shared_ptr<const RangePlan> m_readPlan;
 };
 
 
@@ -199,6 +275,7 @@ public:
     std::vector<std::pair<uint32_t, uint32_t>> m_rangesToRead;
     std::vector<std::pair<uint32_t, uint64_t>> m_frameOffsets;
     uint32_t m_dataBlockSize;
+    std::shared_ptr<const RangePlan> m_readPlan;
     bool m_allowExtendedBlocks;
 private:
 
@@ -207,3 +284,29 @@ private:
     V2Handler *m_handler;
     friend class V2Handler;
 };
+
+
+//ESEQ effect sequence, the channels of one model that a player overlays onto whatever
+//sequence it runs. There is no frame count or step time, the frames simply follow the
+//20 byte header. Only written here, openFSEQFile reads ESEQ files as sparse V2 files.
+class ESEQFile : public FSEQFile {
+public:
+    //readers play the frames at this step time, the file can't say otherwise
+    static constexpr int StepTime = 50;
+
+    ESEQFile(const std::string &fn, uint32_t modelStart, uint32_t modelLength);
+
+    virtual ~ESEQFile();
+
+    virtual FrameData *getFrame(uint32_t frame) override;
+
+    virtual void writeHeader() override;
+    //data holds the whole frame, the model's channels are taken from it
+    virtual void addFrame(uint32_t frame,
+                          const uint8_t *data) override;
+
+    virtual uint32_t getMaxChannel() const override;
+
+    uint32_t m_modelStart;
+    uint32_t m_modelLength;
+};
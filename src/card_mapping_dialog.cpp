@@ -0,0 +1,66 @@
+#include "card_mapping_dialog.h"
+
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QScrollArea>
+#include <QVBoxLayout>
+
+CardMappingDialog::CardMappingDialog(QStringList const& controllers, QList<VolumeInfo> const& volumes, QStringList const& current, QWidget* parent) :
+    QDialog(parent),
+    m_volumes(volumes)
+{
+    setWindowTitle("Export to Cards");
+    resize(560, 420);
+    auto* layout = new QVBoxLayout(this);
+    auto* label = new QLabel("Pick the card each controller is written to. All cards are written at the same time.", this);
+    label->setWordWrap(true);
+    layout->addWidget(label);
+
+    auto* scroll = new QScrollArea(this);
+    scroll->setWidgetResizable(true);
+    auto* inner = new QWidget(scroll);
+    auto* form = new QFormLayout(inner);
+    for (int x = 0; x < controllers.size(); ++x) {
+        auto* combo = new QComboBox(inner);
+        combo->addItem("Skip", QString());
+        for (auto const& volume : m_volumes) {
+            combo->addItem(volume.label(), volume.identity());
+        }
+        if (x < current.size() && !current[x].isEmpty()) {
+            int const idx = combo->findData(current[x]);
+            combo->setCurrentIndex(idx >= 0 ? idx : 0);
+        }
+        form->addRow(controllers[x], combo);
+        m_combos.append(combo);
+    }
+    scroll->setWidget(inner);
+    layout->addWidget(scroll);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons->button(QDialogButtonBox::Ok)->setText("Export");
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
+
+QStringList CardMappingDialog::rootPaths() const
+{
+    QStringList paths;
+    for (auto const* combo : m_combos) {
+        int const idx = combo->currentIndex() - 1;
+        paths.append(idx >= 0 && idx < m_volumes.size() ? m_volumes[idx].rootPath : QString());
+    }
+    return paths;
+}
+
+QStringList CardMappingDialog::identities() const
+{
+    QStringList ids;
+    for (auto const* combo : m_combos) {
+        ids.append(combo->currentData().toString());
+    }
+    return ids;
+}
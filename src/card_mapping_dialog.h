@@ -0,0 +1,28 @@
+#pragma once
+
+#include "volume_watcher.h"
+
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QComboBox;
+
+//Assigns each controller its own SD card for a multi card export
+class CardMappingDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    //current holds a volume identity per controller, empty to skip it
+    CardMappingDialog(QStringList const& controllers, QList<VolumeInfo> const& volumes, QStringList const& current, QWidget* parent = nullptr);
+
+    //root path per controller, empty when the controller is skipped
+    [[nodiscard]] QStringList rootPaths() const;
+    [[nodiscard]] QStringList identities() const;
+
+private:
+    QList<VolumeInfo> m_volumes;
+    QList<QComboBox*> m_combos;
+};
@@ -0,0 +1,324 @@
+#include "channel_activity.h"
+
+#include "FSEQFile.h"
+
+#include "spdlog/spdlog.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    constexpr char SidecarMagic[4] = { 'F', 'S', 'C', 'A' };
+    constexpr uint16_t SidecarVersion = 1;
+
+    struct SidecarHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint64_t uniqueId;
+        uint32_t frames;
+        uint32_t channels;
+    };
+    static_assert(sizeof(SidecarHeader) == 24);
+}
+
+void MaxInto(uint8_t* __restrict acc, const uint8_t* __restrict values, size_t count)
+{
+    for (size_t x = 0; x < count; ++x) {
+        acc[x] = std::max(acc[x], values[x]);
+    }
+}
+
+std::vector<uint32_t> SplitFrameSpans(FSEQFile const& src, unsigned spans)
+{
+    uint32_t const frames = src.getNumFrames();
+    std::vector<uint32_t> starts;
+    auto const* v2 = dynamic_cast<V2FSEQFile const*>(&src);
+    if (v2 && v2->m_compressionType != FSEQFile::CompressionType::none && v2->m_frameOffsets.size() > 1) {
+        //the last entry only marks the end of the data
+        size_t const blocks = v2->m_frameOffsets.size() - 1;
+        spans = static_cast<unsigned>(std::min<size_t>(spans, blocks));
+        for (unsigned x = 0; x < spans; ++x) {
+            starts.push_back(v2->m_frameOffsets[blocks * x / spans].first);
+        }
+    } else {
+        spans = std::max(1u, std::min<unsigned>(spans, frames));
+        for (unsigned x = 0; x < spans; ++x) {
+            starts.push_back(static_cast<uint32_t>(static_cast<uint64_t>(frames) * x / spans));
+        }
+    }
+    starts.push_back(frames);
+    return starts;
+}
+
+unsigned ScanThreads(unsigned threads)
+{
+    if (threads != 0) {
+        return threads;
+    }
+    return std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+}
+
+bool ScanFrames(std::string const& path, uint32_t first, uint32_t last, uint32_t channels, ScanProgress* progress,
+    std::function<void(uint32_t, const uint8_t*)> const& onFrame)
+{
+    TRACE_SCOPE_CAT("scan span", "analysis");
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(path));
+    if (nullptr == src) {
+        return false;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> ranges{ { 0, channels } };
+    //sparse files only hold their own ranges, asking for more just logs errors
+    if (auto const* v2 = dynamic_cast<V2FSEQFile const*>(src.get()); v2 && !v2->m_sparseRanges.empty()) {
+        ranges = v2->m_sparseRanges;
+    }
+    src->prepareRead(ranges, first);
+    std::vector<uint8_t> frame(channels);
+    for (uint32_t x = first; x < last; ++x) {
+        if (progress && progress->cancel) {
+            return false;
+        }
+        std::unique_ptr<FSEQFile::FrameData> fdata(src->getFrame(x));
+        if (!fdata || !fdata->readFrame(frame.data(), channels)) {
+            continue;
+        }
+        onFrame(x, frame.data());
+        if (progress) {
+            progress->frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+bool WriteSidecarFile(std::string const& sidecar, std::initializer_list<std::pair<const void*, size_t>> parts)
+{
+    //written next to the final name and renamed, exports of the same sequence may finish together
+    std::string const temp = sidecar + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        for (auto const& [data, size] : parts) {
+            out.write(static_cast<const char*>(data), size);
+        }
+        if (!out.good()) {
+            spdlog::warn("Could not write sidecar: {}", temp);
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, sidecar, ec);
+    if (ec) {
+        spdlog::warn("Could not write sidecar: {} ({})", sidecar, ec.message());
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+ChannelActivityAccumulator::ChannelActivityAccumulator(uint32_t channels) :
+    m_max(channels, 0),
+    m_nonZero(channels, 0),
+    m_changes(channels, 0),
+    m_first(channels, 0),
+    m_last(channels, 0)
+{
+}
+
+void ChannelActivityAccumulator::add(const uint8_t* frame)
+{
+    if (m_frames == 0) {
+        std::copy_n(frame, m_first.size(), m_first.begin());
+    }
+    //one pass over the frame, plain loops so it is vectorized (byte max plus widened compare counts)
+    size_t const count = m_max.size();
+    uint8_t* __restrict max = m_max.data();
+    uint32_t* __restrict nonZero = m_nonZero.data();
+    uint32_t* __restrict changes = m_changes.data();
+    uint8_t* __restrict prev = m_last.data();
+    for (size_t x = 0; x < count; ++x) {
+        uint8_t const value = frame[x];
+        max[x] = std::max(max[x], value);
+        nonZero[x] += value != 0;
+        changes[x] += value != prev[x];
+        prev[x] = value;
+    }
+    ++m_frames;
+}
+
+void ChannelActivityAccumulator::append(ChannelActivityAccumulator const& next)
+{
+    if (next.m_frames == 0) {
+        return;
+    }
+    if (m_frames == 0) {
+        *this = next;
+        return;
+    }
+    MaxInto(m_max.data(), next.m_max.data(), m_max.size());
+    for (size_t x = 0; x < m_max.size(); ++x) {
+        m_nonZero[x] += next.m_nonZero[x];
+        //next counted its first frame against off, count it against our last frame instead
+        m_changes[x] += next.m_changes[x] - (next.m_first[x] != 0) + (next.m_first[x] != m_last[x]);
+    }
+    m_last = next.m_last;
+    m_frames += next.m_frames;
+}
+
+ChannelActivity ChannelActivityAccumulator::result(uint64_t uniqueId) const
+{
+    ChannelActivity activity;
+    activity.valid = true;
+    activity.uniqueId = uniqueId;
+    activity.frames = m_frames;
+    activity.maxValue = m_max;
+    activity.nonZeroFrames = m_nonZero;
+    activity.changes = m_changes;
+    return activity;
+}
+
+uint64_t ChannelActivity::darkChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges) const
+{
+    uint64_t dark{ 0 };
+    for (auto const& [start, count] : ranges) {
+        for (uint32_t c = start; c < start + count; ++c) {
+            dark += isDark(c);
+        }
+    }
+    return dark;
+}
+
+ChannelActivity ScanChannelActivity(std::string const& path, ScanProgress* progress, unsigned threads)
+{
+    TRACE_SCOPE_CAT("ScanChannelActivity", "analysis");
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(path));
+    if (nullptr == src) {
+        spdlog::error("Error opening input file: {}", path);
+        return ChannelActivity();
+    }
+    uint32_t const channels = src->getMaxChannel();
+    auto const starts = SplitFrameSpans(*src, ScanThreads(threads));
+    size_t const spans = starts.size() - 1;
+
+    std::vector<ChannelActivityAccumulator> accumulators(spans, ChannelActivityAccumulator(channels));
+    std::vector<char> ok(spans, 0);
+    std::vector<std::thread> workers;
+    for (size_t x = 0; x < spans; ++x) {
+        workers.emplace_back([&, x]() {
+            Trace::SetThreadName("scan " + std::to_string(x));
+            ok[x] = ScanFrames(path, starts[x], starts[x + 1], channels, progress,
+                [&acc = accumulators[x]](uint32_t, const uint8_t* frame) { acc.add(frame); });
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        return ChannelActivity();
+    }
+
+    for (size_t x = 1; x < spans; ++x) {
+        accumulators[0].append(accumulators[x]);
+    }
+    auto activity = accumulators[0].result(src->getUniqueId());
+    //frames that failed to decode were skipped, the cache is matched against the header count
+    activity.frames = src->getNumFrames();
+    return activity;
+}
+
+std::string ChannelActivityPath(std::string const& path)
+{
+    return path + ".stats";
+}
+
+ChannelActivity LoadChannelActivity(std::string const& path)
+{
+    TRACE_SCOPE_CAT("LoadChannelActivity", "analysis");
+    std::ifstream in(ChannelActivityPath(path), std::ios::binary);
+    if (!in) {
+        return ChannelActivity();
+    }
+    SidecarHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !std::equal(std::begin(SidecarMagic), std::end(SidecarMagic), header.magic) || header.version != SidecarVersion) {
+        return ChannelActivity();
+    }
+    //only the header of the sequence is read to check the cache is still current
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(path));
+    if (nullptr == src || src->getUniqueId() != header.uniqueId || src->getNumFrames() != header.frames ||
+        src->getMaxChannel() != header.channels) {
+        return ChannelActivity();
+    }
+    ChannelActivity activity;
+    activity.uniqueId = header.uniqueId;
+    activity.frames = header.frames;
+    activity.maxValue.resize(header.channels);
+    activity.nonZeroFrames.resize(header.channels);
+    activity.changes.resize(header.channels);
+    in.read(reinterpret_cast<char*>(activity.maxValue.data()), header.channels);
+    in.read(reinterpret_cast<char*>(activity.nonZeroFrames.data()), header.channels * sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(activity.changes.data()), header.channels * sizeof(uint32_t));
+    activity.valid = static_cast<bool>(in);
+    return activity;
+}
+
+bool SaveChannelActivity(std::string const& path, ChannelActivity const& activity)
+{
+    if (!activity.valid) {
+        return false;
+    }
+    SidecarHeader header{};
+    std::copy(std::begin(SidecarMagic), std::end(SidecarMagic), header.magic);
+    header.version = SidecarVersion;
+    header.uniqueId = activity.uniqueId;
+    header.frames = activity.frames;
+    header.channels = activity.channels();
+    return WriteSidecarFile(ChannelActivityPath(path), {
+        { &header, sizeof(header) },
+        { activity.maxValue.data(), activity.maxValue.size() },
+        { activity.nonZeroFrames.data(), activity.nonZeroFrames.size() * sizeof(uint32_t) },
+        { activity.changes.data(), activity.changes.size() * sizeof(uint32_t) } });
+}
+
+ChannelActivity GetChannelActivity(std::string const& path, ScanProgress* progress, unsigned threads)
+{
+    auto activity = LoadChannelActivity(path);
+    if (activity.valid) {
+        return activity;
+    }
+    activity = ScanChannelActivity(path, progress, threads);
+    SaveChannelActivity(path, activity);
+    return activity;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> TrimDarkChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges,
+    ChannelActivity const& activity)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> lit;
+    for (auto const& [start, count] : ranges) {
+        uint32_t c = start;
+        uint32_t const end = start + count;
+        while (c < end) {
+            while (c < end && activity.isDark(c)) {
+                ++c;
+            }
+            uint32_t const runStart = c;
+            while (c < end && !activity.isDark(c)) {
+                ++c;
+            }
+            if (c > runStart) {
+                lit.emplace_back(runStart, c - runStart);
+            }
+        }
+    }
+    return lit;
+}
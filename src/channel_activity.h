@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+class FSEQFile;
+
+//Per channel summary of a whole sequence, all vectors are indexed by 0-based channel
+struct ChannelActivity
+{
+    bool valid{ false };
+    uint64_t uniqueId{ 0 };
+    uint32_t frames{ 0 };
+    std::vector<uint8_t> maxValue;
+    std::vector<uint32_t> nonZeroFrames; //frames the channel is on
+    std::vector<uint32_t> changes; //frames whose value differs from the frame before, the first frame is compared to off
+
+    [[nodiscard]] uint32_t channels() const { return static_cast<uint32_t>(maxValue.size()); }
+    [[nodiscard]] bool isDark(uint32_t channel) const { return channel >= maxValue.size() || maxValue[channel] == 0; }
+    [[nodiscard]] uint64_t darkChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges) const;
+};
+
+//Folds frames into the per channel statistics. Spans of a sequence can be accumulated
+//separately and appended in frame order afterwards.
+class ChannelActivityAccumulator
+{
+public:
+    explicit ChannelActivityAccumulator(uint32_t channels);
+
+    void add(const uint8_t* frame);
+    //next has to hold the frames directly following the ones added here
+    void append(ChannelActivityAccumulator const& next);
+    [[nodiscard]] uint32_t frames() const { return m_frames; }
+    [[nodiscard]] ChannelActivity result(uint64_t uniqueId) const;
+
+private:
+    uint32_t m_frames{ 0 };
+    std::vector<uint8_t> m_max;
+    std::vector<uint32_t> m_nonZero;
+    std::vector<uint32_t> m_changes;
+    std::vector<uint8_t> m_first;
+    std::vector<uint8_t> m_last;
+};
+
+//acc = max(acc, values) per byte, written so the compiler turns it into packed byte max (pmaxub / umax)
+void MaxInto(uint8_t* __restrict acc, const uint8_t* __restrict values, size_t count);
+
+//shared with the scanning threads, frames counts up as they go
+struct ScanProgress
+{
+    std::atomic<uint32_t> frames{ 0 };
+    std::atomic<bool> cancel{ false };
+};
+
+//first frame of each span followed by the frame count, spans start on compression
+//block boundaries so no block is decompressed by two threads
+std::vector<uint32_t> SplitFrameSpans(FSEQFile const& src, unsigned spans);
+//threads used for a scan, 0 picks one per core up to 8
+unsigned ScanThreads(unsigned threads);
+//Decodes frames [first, last) of path with its own reader and hands each frame number and full frame to onFrame.
+//Returns false when the file can't be opened or the scan was cancelled.
+bool ScanFrames(std::string const& path, uint32_t first, uint32_t last, uint32_t channels, ScanProgress* progress,
+    std::function<void(uint32_t, const uint8_t*)> const& onFrame);
+//replaces sidecar with the concatenated parts through a temporary file
+bool WriteSidecarFile(std::string const& sidecar, std::initializer_list<std::pair<const void*, size_t>> parts);
+
+//Decodes every frame of path, splitting the file into block aligned spans that are
+//scanned on separate threads. Returns an invalid result on errors or cancel.
+ChannelActivity ScanChannelActivity(std::string const& path, ScanProgress* progress = nullptr, unsigned threads = 0);
+
+//statistics are cached in a sidecar next to the sequence
+std::string ChannelActivityPath(std::string const& path);
+//invalid unless the sidecar was written for this exact sequence (same unique id, frames and channels)
+ChannelActivity LoadChannelActivity(std::string const& path);
+bool SaveChannelActivity(std::string const& path, ChannelActivity const& activity);
+//cached statistics when they are current, otherwise scans the sequence and stores the result
+ChannelActivity GetChannelActivity(std::string const& path, ScanProgress* progress = nullptr, unsigned threads = 0);
+
+//Splits the 0-based ranges so channels that are zero in every frame are left out
+std::vector<std::pair<uint32_t, uint32_t>> TrimDarkChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges,
+    ChannelActivity const& activity);
@@ -0,0 +1,575 @@
+#include "channel_map.h"
+
+#include "kernel_dispatch.h"
+#include "range_copy.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHANNEL_GATHER_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CHANNEL_GATHER_TARGET(x)
+#else
+#define CHANNEL_GATHER_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+bool ChannelMap::set(uint32_t output, uint32_t source)
+{
+    if (output == Unmapped || source == Unmapped) {
+        return false;
+    }
+    if (output >= m_sources.size()) {
+        m_sources.resize(static_cast<size_t>(output) + 1, Unmapped);
+    }
+    if (m_sources[output] != Unmapped) {
+        return false;
+    }
+    m_sources[output] = source;
+    ++m_mapped;
+    return true;
+}
+
+bool ChannelMap::add(uint32_t output, uint32_t source, uint32_t count, unsigned width, bool reversed)
+{
+    if (width == 0 || count % width != 0 || static_cast<uint64_t>(output) + count >= Unmapped ||
+        static_cast<uint64_t>(source) + count >= Unmapped) {
+        return false;
+    }
+    //all or nothing, a clash halfway through would leave half a string mapped
+    for (uint32_t x = 0; x < count; ++x) {
+        if (static_cast<size_t>(output) + x < m_sources.size() && m_sources[output + x] != Unmapped) {
+            return false;
+        }
+    }
+    uint32_t const pixels = count / width;
+    for (uint32_t x = 0; x < count; ++x) {
+        uint32_t const pixel = x / width;
+        set(output + x, source + (reversed ? pixels - 1 - pixel : pixel) * width + x % width);
+    }
+    return true;
+}
+
+bool ChannelMap::addReversed(uint32_t start, uint32_t count, unsigned width)
+{
+    return add(start, start, count, width, true);
+}
+
+bool ChannelMap::addSerpentine(uint32_t start, uint32_t count, uint32_t rowPixels, unsigned width)
+{
+    if (width == 0 || rowPixels == 0 || count % width != 0) {
+        return false;
+    }
+    uint64_t const row = static_cast<uint64_t>(rowPixels) * width;
+    bool ok = true;
+    for (uint64_t x = 0, r = 0; x < count; x += row, ++r) {
+        uint32_t const length = static_cast<uint32_t>(std::min<uint64_t>(row, count - x));
+        ok &= add(static_cast<uint32_t>(start + x), static_cast<uint32_t>(start + x), length, width, r % 2 == 1);
+    }
+    return ok;
+}
+
+namespace
+{
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    bool parseNumber(std::string_view text, uint32_t& value)
+    {
+        text = trim(text);
+        auto const result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    //"12", "12-40" or "40-12", with an optional "/3" pixel width, channels stay 1-based
+    bool parseSpan(std::string_view text, uint32_t& first, uint32_t& last, unsigned& width)
+    {
+        width = 1;
+        if (size_t const slash = text.find('/'); slash != std::string_view::npos) {
+            uint32_t w{ 0 };
+            if (!parseNumber(text.substr(slash + 1), w) || w == 0 || w > 16) {
+                return false;
+            }
+            width = w;
+            text = text.substr(0, slash);
+        }
+        size_t const dash = text.find('-');
+        if (dash == std::string_view::npos) {
+            if (!parseNumber(text, first)) {
+                return false;
+            }
+            last = first;
+        } else if (!parseNumber(text.substr(0, dash), first) || !parseNumber(text.substr(dash + 1), last)) {
+            return false;
+        }
+        return first != 0 && last != 0;
+    }
+
+    bool startsWithWord(std::string_view text, std::string_view word)
+    {
+        return text.size() > word.size() && std::isspace(static_cast<unsigned char>(text[word.size()])) &&
+            std::equal(word.begin(), word.end(), text.begin(), [](char a, char b) { return a == (b | 0x20); });
+    }
+
+    bool parseLine(std::string_view line, ChannelMap& map)
+    {
+        uint32_t first{ 0 };
+        uint32_t last{ 0 };
+        unsigned width{ 1 };
+        if (startsWithWord(line, "reverse")) {
+            if (!parseSpan(trim(line.substr(7)), first, last, width) || last < first) {
+                return false;
+            }
+            return map.addReversed(first - 1, last - first + 1, width);
+        }
+        if (startsWithWord(line, "serpentine")) {
+            line = trim(line.substr(10));
+            size_t const space = line.find_first_of(" \t");
+            uint32_t rowPixels{ 0 };
+            if (space == std::string_view::npos || !parseSpan(line.substr(0, space), first, last, width) || last < first ||
+                !parseNumber(line.substr(space + 1), rowPixels)) {
+                return false;
+            }
+            return map.addSerpentine(first - 1, last - first + 1, rowPixels, width);
+        }
+        size_t const equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            return false;
+        }
+        uint32_t sourceFirst{ 0 };
+        uint32_t sourceLast{ 0 };
+        unsigned outputWidth{ 1 };
+        if (!parseSpan(trim(line.substr(0, equals)), first, last, outputWidth) || outputWidth != 1 || last < first ||
+            !parseSpan(trim(line.substr(equals + 1)), sourceFirst, sourceLast, width)) {
+            return false;
+        }
+        bool const reversed = sourceLast < sourceFirst;
+        if (reversed) {
+            std::swap(sourceFirst, sourceLast);
+        }
+        if (sourceLast - sourceFirst != last - first) {
+            return false;
+        }
+        return map.add(first - 1, sourceFirst - 1, last - first + 1, width, reversed);
+    }
+}
+
+bool ParseChannelMap(std::string const& text, ChannelMap& map, std::string& error)
+{
+    ChannelMap parsed;
+    std::istringstream in(text);
+    std::string line;
+    int number{ 0 };
+    while (std::getline(in, line)) {
+        ++number;
+        std::string_view view(line);
+        view = trim(view.substr(0, view.find('#')));
+        if (view.empty()) {
+            continue;
+        }
+        if (!parseLine(view, parsed)) {
+            error = "line " + std::to_string(number) + ": '" + std::string(view) + "'";
+            return false;
+        }
+    }
+    map = std::move(parsed);
+    return true;
+}
+
+bool LoadChannelMap(std::string const& path, ChannelMap& map, std::string& error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "can't open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return ParseChannelMap(text.str(), map, error);
+}
+
+namespace ChannelGather
+{
+    namespace
+    {
+        using ApplyFn = void (*)(uint8_t*, const uint8_t*, Run const*, size_t, Shape const*);
+
+        inline void moveScalar(uint8_t* out, const uint8_t* in, uint32_t count, uint32_t width, int32_t stride)
+        {
+            for (uint32_t k = 0; k < count; ++k) {
+                const uint8_t* from = in + static_cast<ptrdiff_t>(k) * stride;
+                for (uint32_t c = 0; c < width; ++c) {
+                    out[c] = from[c];
+                }
+                out += width;
+            }
+        }
+
+        void applyScalar(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const*)
+        {
+            for (size_t x = 0; x < count; ++x) {
+                Run const& run = runs[x];
+                if (run.count == 1) {
+                    memcpy(frame + run.output, packed + run.source, run.width);
+                } else {
+                    moveScalar(frame + run.output, packed + run.source, run.count, run.width, run.stride);
+                }
+            }
+        }
+
+#if defined(CHANNEL_GATHER_X86)
+        //16 byte steps while a whole register still fits in the run, returns the elements
+        //done. The bytes past the step's elements are overwritten by the next step.
+        CHANNEL_GATHER_TARGET("ssse3")
+        inline uint32_t steps16(uint8_t* out, const uint8_t* in, Run const& run, Shape const& shape, uint32_t done)
+        {
+            uint32_t const advance = shape.elements16 * run.width;
+            uint32_t const bytes = run.count * run.width;
+            __m128i const step = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shape.step16.data()));
+            for (uint32_t x = done * run.width; x + 16 <= bytes; x += advance, done += shape.elements16) {
+                __m128i const source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + static_cast<ptrdiff_t>(done) * run.stride + shape.base16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_shuffle_epi8(source, step));
+            }
+            return done;
+        }
+
+        CHANNEL_GATHER_TARGET("ssse3")
+        void applySSSE3(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const* shapes)
+        {
+            for (size_t x = 0; x < count; ++x) {
+                Run const& run = runs[x];
+                if (run.count == 1) {
+                    memcpy(frame + run.output, packed + run.source, run.width);
+                    continue;
+                }
+                uint8_t* out = frame + run.output;
+                const uint8_t* in = packed + run.source;
+                uint32_t done{ 0 };
+                if (shapes[run.shape].elements16 != 0) {
+                    done = steps16(out, in, run, shapes[run.shape], 0);
+                }
+                moveScalar(out + done * run.width, in + static_cast<ptrdiff_t>(done) * run.stride, run.count - done, run.width, run.stride);
+            }
+        }
+
+        CHANNEL_GATHER_TARGET("avx2")
+        void applyAVX2(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const* shapes)
+        {
+            for (size_t x = 0; x < count; ++x) {
+                Run const& run = runs[x];
+                if (run.count == 1) {
+                    memcpy(frame + run.output, packed + run.source, run.width);
+                    continue;
+                }
+                uint8_t* out = frame + run.output;
+                const uint8_t* in = packed + run.source;
+                Shape const& shape = shapes[run.shape];
+                uint32_t done{ 0 };
+                if (shape.elements16 != 0) {
+                    //vpshufb stays within 128 bit lanes, each lane does one step
+                    uint32_t const advance = shape.elements16 * run.width;
+                    uint32_t const bytes = run.count * run.width;
+                    ptrdiff_t const sourceAdvance = static_cast<ptrdiff_t>(shape.elements16) * run.stride;
+                    __m256i const steps = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(shape.step16.data())));
+                    uint32_t o = 0;
+                    for (; o + advance + 16 <= bytes; o += 2 * advance, done += 2 * shape.elements16) {
+                        const uint8_t* from = in + static_cast<ptrdiff_t>(done) * run.stride + shape.base16;
+                        __m128i const low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+                        __m128i const high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + sourceAdvance));
+                        __m256i const moved = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), steps);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), _mm256_castsi256_si128(moved));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + advance), _mm256_extracti128_si256(moved, 1));
+                    }
+                    //the last step is VEX encoded here too
+                    done = steps16(out, in, run, shape, done);
+                }
+                moveScalar(out + done * run.width, in + static_cast<ptrdiff_t>(done) * run.stride, run.count - done, run.width, run.stride);
+            }
+        }
+
+        CHANNEL_GATHER_TARGET("avx512f,avx512bw,avx512vbmi")
+        void applyAVX512(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const* shapes)
+        {
+            for (size_t x = 0; x < count; ++x) {
+                Run const& run = runs[x];
+                if (run.count == 1) {
+                    memcpy(frame + run.output, packed + run.source, run.width);
+                    continue;
+                }
+                uint8_t* out = frame + run.output;
+                const uint8_t* in = packed + run.source;
+                Shape const& shape = shapes[run.shape];
+                uint32_t done{ 0 };
+                if (shape.elements64 != 0) {
+                    //whole stores while a register still fits in the run, the next step
+                    //overwrites the bytes past this one's elements. Split masked stores are slow.
+                    uint32_t const elements = shape.elements64;
+                    uint32_t const advance = elements * run.width;
+                    uint32_t const bytes = run.count * run.width;
+                    __m512i const step = _mm512_loadu_si512(shape.step64.data());
+                    uint32_t o = 0;
+                    if (shape.span64 <= 64) {
+                        for (; o + 64 <= bytes; o += advance, done += elements) {
+                            const uint8_t* from = in + static_cast<ptrdiff_t>(done) * run.stride + shape.base64;
+                            _mm512_storeu_si512(out + o, _mm512_permutexvar_epi8(step, _mm512_loadu_si512(from)));
+                        }
+                    } else {
+                        for (; o + 64 <= bytes; o += advance, done += elements) {
+                            const uint8_t* from = in + static_cast<ptrdiff_t>(done) * run.stride + shape.base64;
+                            _mm512_storeu_si512(out + o, _mm512_permutex2var_epi8(_mm512_loadu_si512(from), step, _mm512_loadu_si512(from + 64)));
+                        }
+                    }
+                    //the padding around the packed sources keeps the whole loads of a
+                    //partial step readable
+                    for (; done < run.count; o += advance, done += elements) {
+                        const uint8_t* from = in + static_cast<ptrdiff_t>(done) * run.stride + shape.base64;
+                        __m512i const moved = _mm512_permutex2var_epi8(_mm512_loadu_si512(from), step, _mm512_loadu_si512(from + 64));
+                        _mm512_mask_storeu_epi8(out + o, ~0ULL >> (64 - std::min(advance, bytes - o)), moved);
+                    }
+                    continue;
+                }
+                if (shape.elements16 != 0) {
+                    done = steps16(out, in, run, shape, 0);
+                }
+                moveScalar(out + done * run.width, in + static_cast<ptrdiff_t>(done) * run.stride, run.count - done, run.width, run.stride);
+            }
+        }
+#endif
+
+        ApplyFn kernelFor(Kernel kernel)
+        {
+            switch (kernel) {
+#if defined(CHANNEL_GATHER_X86)
+            case Kernel::SSSE3:
+                return applySSSE3;
+            case Kernel::AVX2:
+                return applyAVX2;
+            case Kernel::AVX512:
+                return applyAVX512;
+#endif
+            default:
+                return applyScalar;
+            }
+        }
+
+        KernelDispatch<Kernel, ApplyFn>& dispatch()
+        {
+            //FSEQ_GATHER_KERNEL=scalar|ssse3|avx2|avx512 pins a kernel for comparisons
+            static KernelDispatch<Kernel, ApplyFn> d("FSEQ_GATHER_KERNEL", { Kernel::AVX512, Kernel::AVX2, Kernel::SSSE3 },
+                LutTransform::KernelName, LutTransform::IsSupported, kernelFor);
+            return d;
+        }
+    }
+
+    Shape MakeShape(uint32_t width, int32_t stride)
+    {
+        Shape shape;
+        shape.width = width;
+        shape.stride = stride;
+        uint64_t const distance = static_cast<uint64_t>(stride < 0 ? -static_cast<int64_t>(stride) : stride);
+        auto const fill = [width, stride, distance](uint8_t* step, uint32_t size, uint32_t window, uint32_t& elements, uint32_t& span, int32_t& base) {
+            uint32_t e = size / width;
+            while (e >= 2 && (e - 1) * distance + width > window) {
+                --e;
+            }
+            if (e < 2) {
+                return;
+            }
+            elements = e;
+            span = static_cast<uint32_t>((e - 1) * distance + width);
+            base = stride < 0 ? static_cast<int32_t>(e - 1) * stride : 0;
+            for (uint32_t x = 0; x < e * width; ++x) {
+                step[x] = static_cast<uint8_t>(static_cast<int32_t>(x / width) * stride + static_cast<int32_t>(x % width) - base);
+            }
+        };
+        uint32_t span16{ 0 };
+        fill(shape.step16.data(), 16, 16, shape.elements16, span16, shape.base16);
+        fill(shape.step64.data(), 64, 128, shape.elements64, shape.span64, shape.base64);
+        return shape;
+    }
+
+    void Apply(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const* shapes)
+    {
+        dispatch().fn()(frame, packed, runs, count, shapes);
+    }
+
+    Kernel ActiveKernel()
+    {
+        return dispatch().active();
+    }
+
+    bool SetKernel(Kernel kernel)
+    {
+        return dispatch().set(kernel);
+    }
+}
+
+GatherPlan::GatherPlan(ChannelMap const& map)
+{
+    using ChannelGather::Run;
+    //elements wider than this are cheaper as separate copies
+    constexpr uint32_t MaxElement = 16;
+    //shorter patterns are mostly chance in scattered maps
+    constexpr uint32_t MinElements = 4;
+    auto const& sources = map.sources();
+    uint32_t const channels = static_cast<uint32_t>(sources.size());
+    auto const follows = [&sources, channels](uint32_t output, int64_t source, uint32_t width) {
+        if (static_cast<uint64_t>(output) + width > channels || source < 0 || source + width >= ChannelMap::Unmapped) {
+            return false;
+        }
+        for (uint32_t c = 0; c < width; ++c) {
+            if (sources[output + c] != source + c) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    //runs in channel numbers first, they move to packed offsets once the source ranges are known
+    std::vector<Run> runs;
+    for (uint32_t c = 0; c < channels;) {
+        uint32_t const source = sources[c];
+        if (source == ChannelMap::Unmapped) {
+            ++c;
+            continue;
+        }
+        uint32_t length = 1;
+        while (c + length < channels && follows(c + length, static_cast<int64_t>(source) + length, 1)) {
+            ++length;
+        }
+        if (length <= MaxElement && c + length < channels && sources[c + length] != ChannelMap::Unmapped) {
+            int64_t const stride = static_cast<int64_t>(sources[c + length]) - source;
+            uint32_t elements = 1;
+            while (stride >= INT32_MIN && stride <= INT32_MAX &&
+                follows(c + elements * length, static_cast<int64_t>(source) + elements * stride, length)) {
+                ++elements;
+            }
+            if (elements >= MinElements) {
+                runs.push_back({ c, source, elements, length, static_cast<int32_t>(stride), 0 });
+                c += elements * length;
+                continue;
+            }
+        }
+        //channels mapped onto themselves only cost time
+        if (source != c) {
+            runs.push_back({ c, source, 1, length, 0, 0 });
+        }
+        c += length;
+    }
+    if (runs.empty()) {
+        return;
+    }
+
+    //source spans, close ones read together rather than as separate ranges
+    constexpr uint32_t JoinGap = 64;
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+    spans.reserve(runs.size());
+    for (auto const& run : runs) {
+        int64_t const last = static_cast<int64_t>(run.source) + static_cast<int64_t>(run.count - 1) * run.stride;
+        uint32_t const low = static_cast<uint32_t>(std::min<int64_t>(run.source, last));
+        uint32_t const high = static_cast<uint32_t>(std::max<int64_t>(run.source, last)) + run.width;
+        spans.emplace_back(low, high);
+        m_extent = std::max({ m_extent, high, run.output + run.count * run.width });
+    }
+    std::sort(spans.begin(), spans.end());
+    std::vector<uint32_t> packedStart;
+    for (auto const& [low, high] : spans) {
+        if (!m_sourceRanges.empty() && low <= m_sourceRanges.back().first + m_sourceRanges.back().second + JoinGap) {
+            auto& back = m_sourceRanges.back();
+            back.second = std::max(back.second, high - back.first);
+            continue;
+        }
+        m_sourceRanges.emplace_back(low, high - low);
+    }
+    for (auto const& [start, count] : m_sourceRanges) {
+        packedStart.push_back(m_packed);
+        m_packed += count;
+    }
+
+    for (auto& run : runs) {
+        int64_t const last = static_cast<int64_t>(run.source) + static_cast<int64_t>(run.count - 1) * run.stride;
+        uint32_t const low = static_cast<uint32_t>(std::min<int64_t>(run.source, last));
+        size_t const span = std::upper_bound(m_sourceRanges.begin(), m_sourceRanges.end(), std::pair<uint32_t, uint32_t>(low, UINT32_MAX)) - m_sourceRanges.begin() - 1;
+        run.source = ChannelGather::Padding + packedStart[span] + (run.source - m_sourceRanges[span].first);
+        if (run.count > 1) {
+            auto found = std::find_if(m_shapes.begin(), m_shapes.end(),
+                [&run](auto const& shape) { return shape.width == run.width && shape.stride == run.stride; });
+            if (found == m_shapes.end()) {
+                found = m_shapes.insert(m_shapes.end(), ChannelGather::MakeShape(run.width, run.stride));
+            }
+            run.shape = static_cast<uint32_t>(found - m_shapes.begin());
+        }
+    }
+    m_runs = std::move(runs);
+    m_mapped = map.mapped();
+}
+
+std::string GatherPlan::summary() const
+{
+    size_t copies{ 0 };
+    size_t strided{ 0 };
+    size_t single{ 0 };
+    for (auto const& run : m_runs) {
+        if (run.count > 1) {
+            ++strided;
+        } else if (run.width > 1) {
+            ++copies;
+        } else {
+            ++single;
+        }
+    }
+    std::ostringstream out;
+    out << copies << " copies, " << strided << " strided runs, " << single << " single channels";
+    return out.str();
+}
+
+void GatherPlan::apply(uint8_t* frame, uint32_t size) const
+{
+    if (m_runs.empty()) {
+        return;
+    }
+    //per thread, every export thread streams its own frames through the plans it holds
+    thread_local std::vector<uint8_t> buffer;
+    size_t const needed = m_packed + 2 * ChannelGather::Padding;
+    if (buffer.size() < needed) {
+        buffer.resize(needed);
+    }
+    uint8_t* packed = buffer.data() + ChannelGather::Padding;
+    if (size >= m_extent) {
+        RangeCopy::Gather(packed, frame, m_sourceRanges.data(), m_sourceRanges.size());
+        ChannelGather::Apply(frame, buffer.data(), m_runs.data(), m_runs.size(), m_shapes.data());
+        return;
+    }
+    //a frame shorter than the map, sources past its end read as dark
+    for (auto const& [start, count] : m_sourceRanges) {
+        uint32_t const inside = start >= size ? 0 : std::min(count, size - start);
+        memcpy(packed, frame + start, inside);
+        memset(packed + inside, 0, count - inside);
+        packed += count;
+    }
+    for (auto const& run : m_runs) {
+        for (uint32_t k = 0; k < run.count; ++k) {
+            uint64_t const output = run.output + static_cast<uint64_t>(k) * run.width;
+            const uint8_t* from = buffer.data() + run.source + static_cast<ptrdiff_t>(k) * run.stride;
+            for (uint32_t c = 0; c < run.width && output + c < size; ++c) {
+                frame[output + c] = from[c];
+            }
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "frame_transform.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Output channel -> sequence channel routing for installs wired differently from the
+//layout the sequence was made for: swapped ports, reversed strings, serpentine matrices.
+//Channels are 0-based, channels without a source keep their own value.
+class ChannelMap
+{
+public:
+    static constexpr uint32_t Unmapped = UINT32_MAX;
+
+    //false when output already has a source
+    bool set(uint32_t output, uint32_t source);
+    //count channels starting at source, pixel by pixel from the end of the source range when reversed
+    bool add(uint32_t output, uint32_t source, uint32_t count, unsigned width = 1, bool reversed = false);
+    //the pixels of a string wired from its far end, channels within a pixel keep their order
+    bool addReversed(uint32_t start, uint32_t count, unsigned width);
+    //a matrix wired back and forth, every second row of rowPixels pixels is reversed
+    bool addSerpentine(uint32_t start, uint32_t count, uint32_t rowPixels, unsigned width);
+
+    [[nodiscard]] bool empty() const { return m_mapped == 0; }
+    [[nodiscard]] uint32_t mapped() const { return m_mapped; }
+    //source of each output channel, Unmapped where it keeps its own value
+    [[nodiscard]] std::vector<uint32_t> const& sources() const { return m_sources; }
+
+private:
+    std::vector<uint32_t> m_sources;
+    uint32_t m_mapped{ 0 };
+};
+
+//One line per mapping, channels are 1-based and inclusive, # starts a comment:
+//  1-300 = 601-900          channels 1-300 take 601-900
+//  301-600 = 600-301/3      pixels of 3 channels taken from the far end
+//  7 = 9
+//  reverse 901-1200/3
+//  serpentine 1201-4200/3 50   rows of 50 pixels, the second, fourth... reversed
+//error describes the first bad line
+bool ParseChannelMap(std::string const& text, ChannelMap& map, std::string& error);
+bool LoadChannelMap(std::string const& path, ChannelMap& map, std::string& error);
+
+//Copies and strided element moves between a packed buffer of source channels and a frame.
+//Element moves look up whole steps at once, pshufb handles steps whose source fits in
+//16 bytes and AVX-512 VBMI vpermi2b steps whose source fits in 128.
+namespace ChannelGather
+{
+    using LutTransform::Kernel;
+
+    //bytes readable before and after the packed sources, steps load whole registers
+    constexpr uint32_t Padding = 128;
+
+    //shuffle controls of one element width and stride, shared by the runs using them
+    struct Shape
+    {
+        uint32_t width{ 1 };
+        int32_t stride{ 0 };
+        //elements per step, 0 when the source of two elements doesn't fit the register
+        uint32_t elements16{ 0 };
+        uint32_t elements64{ 0 };
+        //source bytes of a whole AVX-512 step, one register up to 64
+        uint32_t span64{ 0 };
+        //first loaded byte relative to the step's first element, below it when reversed
+        int32_t base16{ 0 };
+        int32_t base64{ 0 };
+        std::array<uint8_t, 16> step16{};
+        std::array<uint8_t, 64> step64{};
+    };
+
+    //count elements of width bytes, element k of the output comes from source + k * stride
+    //in the packed buffer. A plain copy is a single element of its whole length.
+    struct Run
+    {
+        uint32_t output;
+        uint32_t source;
+        uint32_t count;
+        uint32_t width;
+        int32_t stride;
+        uint32_t shape;
+    };
+
+    Shape MakeShape(uint32_t width, int32_t stride);
+    //run sources are offsets into packed, the sources start Padding bytes in and
+    //Padding more readable bytes follow them
+    void Apply(uint8_t* frame, const uint8_t* packed, Run const* runs, size_t count, Shape const* shapes);
+
+    Kernel ActiveKernel();
+    //for benchmarks, false when the CPU can't run it
+    bool SetKernel(Kernel kernel);
+}
+
+//A ChannelMap compiled into runs: long copies where sources follow each other, strided
+//element runs for reversed strings and other regular patterns, single channels for the rest.
+//Applying it packs the source channels aside and gathers the runs back into the frame.
+class GatherPlan
+{
+public:
+    GatherPlan() = default;
+    explicit GatherPlan(ChannelMap const& map);
+
+    [[nodiscard]] bool empty() const { return m_runs.empty(); }
+    //0-based channels the plan reads, sorted and merged
+    [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> const& sourceRanges() const { return m_sourceRanges; }
+    //frame bytes the plan reads or writes
+    [[nodiscard]] uint32_t extent() const { return m_extent; }
+    [[nodiscard]] uint32_t mapped() const { return m_mapped; }
+    [[nodiscard]] std::vector<ChannelGather::Run> const& runs() const { return m_runs; }
+    //"3 copies, 20 strided runs, 0 single channels"
+    [[nodiscard]] std::string summary() const;
+
+    //frame is size bytes long, channels past the end are left out
+    void apply(uint8_t* frame, uint32_t size) const;
+
+private:
+    std::vector<ChannelGather::Run> m_runs;
+    std::vector<ChannelGather::Shape> m_shapes;
+    std::vector<std::pair<uint32_t, uint32_t>> m_sourceRanges;
+    uint32_t m_packed{ 0 };
+    uint32_t m_extent{ 0 };
+    uint32_t m_mapped{ 0 };
+};
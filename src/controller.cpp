@@ -0,0 +1,559 @@
+#include "controller.h"
+
+#include "config.h"
+#include "frame_transform.h"
+
+#include "spdlog/spdlog.h"
+
+#include "pugixml.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string_view>
+
+Controller::Controller(std::string name_, std::string ip_, ChannelRanges networks_) :
+    name(std::move(name_)), ip(std::move(ip_)), networks(MergeRanges(std::move(networks_)))
+{
+    setRanges(networks);
+}
+
+void Controller::setRanges(ChannelRanges r)
+{
+    ranges = MergeRanges(std::move(r));
+    start_channel = ranges.empty() ? 0 : ranges.front().first;
+    channels = 0;
+    for (auto const& [start, count] : ranges) {
+        channels += count;
+    }
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> Controller::sparseRanges() const
+{
+    return ToSparseRanges(ranges);
+}
+
+FrameTransform Controller::exportTransform() const
+{
+    FrameTransform transform;
+    transform.setChannelMap(channelMap);
+    for (auto const& order : colorOrders) {
+        if (order.start != 0) {
+            transform.addColorOrder(static_cast<uint32_t>(order.start - 1), static_cast<uint32_t>(order.count), order.order);
+        }
+    }
+    return transform;
+}
+
+PowerPorts Controller::powerPorts() const
+{
+    PowerPorts ports;
+    for (auto const& limit : powerLimits) {
+        if (limit.start != 0) {
+            ports.push_back({ static_cast<uint32_t>(limit.start - 1), static_cast<uint32_t>(limit.count), limit.milliamps, limit.amps });
+        }
+    }
+    return ports;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> ToSparseRanges(ChannelRanges const& ranges)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> sparse;
+    sparse.reserve(ranges.size());
+    for (auto const& [start, count] : ranges) {
+        if (start == 0) {
+            continue;
+        }
+        sparse.emplace_back(static_cast<uint32_t>(start - 1), static_cast<uint32_t>(count));
+    }
+    return sparse;
+}
+
+ChannelRanges MergeRanges(ChannelRanges ranges)
+{
+    std::erase_if(ranges, [](auto const& r) { return r.second == 0; });
+    std::sort(ranges.begin(), ranges.end());
+    ChannelRanges merged;
+    for (auto const& r : ranges) {
+        if (!merged.empty() && r.first <= merged.back().first + merged.back().second) {
+            auto& last = merged.back();
+            last.second = std::max(last.first + last.second, r.first + r.second) - last.first;
+        } else {
+            merged.push_back(r);
+        }
+    }
+    return merged;
+}
+
+std::string FormatRanges(ChannelRanges const& ranges)
+{
+    std::ostringstream out;
+    for (size_t x = 0; x < ranges.size(); ++x) {
+        if (x != 0) {
+            out << ", ";
+        }
+        out << ranges[x].first << "-" << (ranges[x].first + ranges[x].second - 1);
+    }
+    return out.str();
+}
+
+bool ParseRanges(std::string const& text, ChannelRanges& ranges)
+{
+    ChannelRanges parsed;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::erase_if(item, [](char c) { return c == ' ' || c == '\t'; });
+        if (item.empty()) {
+            continue;
+        }
+        uint64_t start{ 0 };
+        uint64_t end{ 0 };
+        char const* const last = item.data() + item.size();
+        auto [ptr, ec] = std::from_chars(item.data(), last, start);
+        if (ec != std::errc() || start == 0) {
+            return false;
+        }
+        end = start;
+        if (ptr != last) {
+            if (*ptr != '-') {
+                return false;
+            }
+            auto [endPtr, endEc] = std::from_chars(ptr + 1, last, end);
+            if (endEc != std::errc() || endPtr != last || end < start) {
+                return false;
+            }
+        }
+        parsed.emplace_back(start, end - start + 1);
+    }
+    ranges = MergeRanges(std::move(parsed));
+    return true;
+}
+
+std::string FormatColorOrders(ColorOrders const& orders)
+{
+    std::ostringstream out;
+    for (size_t x = 0; x < orders.size(); ++x) {
+        if (x != 0) {
+            out << ", ";
+        }
+        out << orders[x].start << "-" << (orders[x].start + orders[x].count - 1) << ":" << orders[x].order;
+    }
+    return out.str();
+}
+
+bool ParseColorOrders(std::string const& text, ColorOrders& orders)
+{
+    ColorOrders parsed;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::erase_if(item, [](char c) { return c == ' ' || c == '\t'; });
+        if (item.empty()) {
+            continue;
+        }
+        auto const colon = item.find(':');
+        ChannelRanges range;
+        std::array<uint8_t, 4> order;
+        if (colon == std::string::npos || !ParseRanges(item.substr(0, colon), range) || range.size() != 1 ||
+            ParseColorOrder(std::string_view(item).substr(colon + 1), order) == 0) {
+            return false;
+        }
+        std::string name = item.substr(colon + 1);
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+        parsed.push_back({ range.front().first, range.front().second, std::move(name) });
+    }
+    std::stable_sort(parsed.begin(), parsed.end(), [](auto const& a, auto const& b) { return a.start < b.start; });
+    orders = std::move(parsed);
+    return true;
+}
+
+std::string FormatPowerLimits(PowerLimits const& limits)
+{
+    std::ostringstream out;
+    for (size_t x = 0; x < limits.size(); ++x) {
+        if (x != 0) {
+            out << ", ";
+        }
+        out << limits[x].start << "-" << (limits[x].start + limits[x].count - 1) << ":" << limits[x].milliamps << "mA:" << limits[x].amps << "A";
+    }
+    return out.str();
+}
+
+namespace
+{
+    //"7.5A", "20mA", the unit is optional but has to match when given
+    bool parseAmount(std::string_view text, std::string_view unit, double& value)
+    {
+        if (text.size() >= unit.size() && std::equal(unit.begin(), unit.end(), text.end() - unit.size(),
+            [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); })) {
+            text.remove_suffix(unit.size());
+        }
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && ec == std::errc() && ptr == text.data() + text.size() && value > 0.0;
+    }
+}
+
+bool ParsePowerLimits(std::string const& text, PowerLimits& limits)
+{
+    PowerLimits parsed;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::erase_if(item, [](char c) { return c == ' ' || c == '\t'; });
+        if (item.empty()) {
+            continue;
+        }
+        auto const first = item.find(':');
+        auto const second = first == std::string::npos ? std::string::npos : item.find(':', first + 1);
+        ChannelRanges range;
+        PowerLimitRange limit;
+        if (second == std::string::npos || !ParseRanges(item.substr(0, first), range) || range.size() != 1 ||
+            !parseAmount(std::string_view(item).substr(first + 1, second - first - 1), "mA", limit.milliamps) ||
+            !parseAmount(std::string_view(item).substr(second + 1), "A", limit.amps)) {
+            return false;
+        }
+        limit.start = range.front().first;
+        limit.count = range.front().second;
+        parsed.push_back(limit);
+    }
+    std::stable_sort(parsed.begin(), parsed.end(), [](auto const& a, auto const& b) { return a.start < b.start; });
+    limits = std::move(parsed);
+    return true;
+}
+
+std::vector<Controller> LoadControllerFile(std::string const& filename)
+{
+    auto logger = spdlog::get(PROJECT_NAME);
+    if (!logger) {
+        logger = spdlog::default_logger();
+    }
+    std::vector<Controller> controllers;
+    pugi::xml_document doc;
+
+    pugi::xml_parse_result result = doc.load_file(filename.c_str());
+    pugi::xml_node networks = doc.child("Networks");
+    if(!networks) {
+        logger->error("No Networks node found in the controller file: {}", filename);
+        return controllers;
+    }
+    uint64_t startChannel{ 1 };
+    for (pugi::xml_node controller = networks.child("Controller"); controller; controller = controller.next_sibling("Controller")) {
+        auto name = controller.attribute("Name").value();
+        auto ip = controller.attribute("IP").value();
+
+        uint64_t totalChannels = {0};
+        ChannelRanges networkRanges;
+        for (pugi::xml_node network = controller.child("network"); network; network = network.next_sibling("network")) {
+            uint64_t size = network.attribute("MaxChannels").as_ullong();
+            networkRanges.emplace_back(startChannel + totalChannels, size);
+            totalChannels += size;
+        }
+        if(totalChannels != 0) {
+            logger->debug("Found Controller: {} at {} with {} channels starting at {} in {} networks", name, ip, totalChannels, startChannel, networkRanges.size());
+            auto& added = controllers.emplace_back(name, ip, std::move(networkRanges));
+            added.vendor = controller.attribute("Vendor").value();
+            added.model = controller.attribute("Model").value();
+        } else {
+            logger->warn("Found Controller: {} at {} with 0 channels, skipping", name, ip);
+        }
+        startChannel += totalChannels;
+    }
+    //the models say which of those channels are actually used
+    std::error_code ec;
+    auto const modelFile = std::filesystem::path(filename).replace_filename("xlights_rgbeffects.xml");
+    if (!controllers.empty() && std::filesystem::exists(modelFile, ec)) {
+        LoadModelFile(modelFile.string(), controllers);
+    }
+    return controllers;
+}
+
+namespace
+{
+    //channels per node and whether a whole string is one node, from the StringType xLights writes
+    std::pair<uint64_t, bool> nodeChannels(pugi::xml_node model)
+    {
+        std::string_view const type = model.attribute("StringType").as_string("RGB Nodes");
+        if (type == "3 Channel RGB") {
+            return { 3, true };
+        }
+        if (type == "4 Channel RGBW") {
+            return { 4, true };
+        }
+        if (type.starts_with("Single Color") || type == "Strobes") {
+            return { 1, true };
+        }
+        if (type == "Node Single Color") {
+            return { 1, false };
+        }
+        if (type == "Superstring") {
+            return { std::max<uint64_t>(model.attribute("SuperStringColours").as_ullong(1), 1), false };
+        }
+        //"RGBW Nodes", "WRGB Nodes", "GRBW Nodes"...
+        if (type.ends_with(" Nodes") && type.find('W') != std::string_view::npos) {
+            return { 4, false };
+        }
+        return { 3, false };
+    }
+
+    //highest node number of a custom model, "1,2,,3;4,,5|6..." or the compressed "node,row,col;..."
+    uint64_t customNodes(pugi::xml_node model)
+    {
+        std::string_view const compressed = model.attribute("CustomModelCompressed").as_string();
+        std::string_view const grid = model.attribute("CustomModel").as_string();
+        uint64_t nodes{ 0 };
+        bool first{ true };
+        uint64_t value{ 0 };
+        bool digits{ false };
+        for (char c : compressed.empty() ? grid : compressed) {
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                digits = true;
+                continue;
+            }
+            //only the first number of a compressed entry is a node
+            if (digits && (compressed.empty() || first)) {
+                nodes = std::max(nodes, value);
+            }
+            first = c == ';';
+            value = 0;
+            digits = false;
+        }
+        if (digits && (compressed.empty() || first)) {
+            nodes = std::max(nodes, value);
+        }
+        return nodes;
+    }
+
+    //channels of the whole model and the strings they are wired as, 0 channels for layouts
+    //whose size can't be worked out from the file
+    uint64_t modelChannels(pugi::xml_node model, uint64_t& strings)
+    {
+        std::string_view const display = model.attribute("DisplayAs").as_string();
+        uint64_t const parm1 = model.attribute("parm1").as_ullong();
+        uint64_t const parm2 = model.attribute("parm2").as_ullong();
+        uint64_t const parm3 = model.attribute("parm3").as_ullong();
+        strings = std::max<uint64_t>(parm1, 1);
+        if (display == "Channel Block") {
+            return parm1;
+        }
+        //parm1 is the channel count of DMX fixtures
+        if (display.starts_with("Dmx")) {
+            strings = 1;
+            return parm1;
+        }
+        if (display == "Image") {
+            return 0;
+        }
+        auto const [perNode, singleNode] = nodeChannels(model);
+        uint64_t nodes{ 0 };
+        if (display == "Custom") {
+            strings = std::max<uint64_t>(model.attribute("CustomStrings").as_ullong(1), 1);
+            nodes = customNodes(model);
+        } else if (singleNode) {
+            nodes = parm1;
+        } else if (display == "Cube") {
+            strings = std::max<uint64_t>(model.attribute("Strings").as_ullong(1), 1);
+            nodes = parm1 * parm2 * parm3;
+        } else if (display == "Spinner") {
+            nodes = parm1 * parm2 * parm3;
+        } else if (display == "Window Frame") {
+            strings = 1;
+            nodes = parm1 + 2 * parm2 + parm3;
+        } else {
+            //strings and nodes per string for lines, arches, matrices, trees, stars...
+            nodes = parm1 * parm2;
+        }
+        return nodes * perNode;
+    }
+
+    //Resolves the start channel forms xLights writes: "1234", "!Controller:1", "@Model:1"
+    //from the start of another model, ">Model:1" after its end. "#universe:1" needs the
+    //universe numbering of the outputs and isn't resolved.
+    class ModelLayout
+    {
+    public:
+        ModelLayout(pugi::xml_node models, std::vector<Controller> const& controllers)
+        {
+            for (pugi::xml_node model = models.child("model"); model; model = model.next_sibling("model")) {
+                m_models.emplace(model.attribute("name").value(), model);
+            }
+            for (auto const& controller : controllers) {
+                if (!controller.networks.empty()) {
+                    m_controllers.emplace(controller.name, controller.networks.front().first);
+                }
+            }
+        }
+
+        //1-based channel ranges of the model, empty when it can't be placed
+        ChannelRanges ranges(pugi::xml_node model)
+        {
+            std::string const name = model.attribute("name").value();
+            uint64_t const begin = start(name);
+            uint64_t strings{ 1 };
+            uint64_t const total = modelChannels(model, strings);
+            if (begin == 0 || total == 0) {
+                return {};
+            }
+            if (!model.attribute("Advanced").as_bool() || strings < 2) {
+                return { { begin, total } };
+            }
+            //strings with a start of their own
+            ChannelRanges ranges;
+            uint64_t const perString = total / strings;
+            for (uint64_t x = 0; x < strings; ++x) {
+                auto const attribute = model.attribute(("String" + std::to_string(x + 1)).c_str());
+                uint64_t const stringStart = attribute ? resolve(attribute.value()) : begin + x * perString;
+                if (stringStart == 0) {
+                    return {};
+                }
+                ranges.emplace_back(stringStart, perString);
+            }
+            return MergeRanges(std::move(ranges));
+        }
+
+    private:
+        uint64_t start(std::string const& name)
+        {
+            auto const found = m_models.find(name);
+            if (found == m_models.end()) {
+                return 0;
+            }
+            auto const known = m_starts.find(name);
+            if (known != m_starts.end()) {
+                return known->second;
+            }
+            //models placed after each other in a loop have no start
+            if (!m_resolving.insert(name).second) {
+                return 0;
+            }
+            uint64_t const channel = resolve(found->second.attribute("StartChannel").value());
+            m_resolving.erase(name);
+            m_starts.emplace(name, channel);
+            return channel;
+        }
+
+        uint64_t resolve(std::string_view text)
+        {
+            if (text.empty()) {
+                return 0;
+            }
+            char const kind = text.front();
+            auto const colon = text.rfind(':');
+            uint64_t offset{ 0 };
+            if (kind == '>' || kind == '@' || kind == '!') {
+                if (colon == std::string_view::npos) {
+                    return 0;
+                }
+                auto const digits = text.substr(colon + 1);
+                auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), offset);
+                if (ec != std::errc() || ptr != digits.data() + digits.size() || offset == 0) {
+                    return 0;
+                }
+            }
+            std::string const name(kind == '>' || kind == '@' || kind == '!' ? text.substr(1, colon - 1) : std::string_view());
+            switch (kind) {
+            case '!': {
+                auto const found = m_controllers.find(name);
+                return found == m_controllers.end() ? 0 : found->second + offset - 1;
+            }
+            case '@': {
+                uint64_t const base = start(name);
+                return base == 0 ? 0 : base + offset - 1;
+            }
+            case '>': {
+                uint64_t const base = start(name);
+                uint64_t strings{ 1 };
+                uint64_t const count = base == 0 ? 0 : modelChannels(m_models.at(name), strings);
+                return count == 0 ? 0 : base + count + offset - 1;
+            }
+            default: {
+                uint64_t channel{ 0 };
+                auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), channel);
+                return ec != std::errc() || ptr != text.data() + text.size() ? 0 : channel;
+            }
+            }
+        }
+
+        std::map<std::string, pugi::xml_node> m_models;
+        std::map<std::string, uint64_t> m_controllers;
+        std::map<std::string, uint64_t> m_starts;
+        std::set<std::string> m_resolving;
+    };
+
+    //parts of ranges inside within, both sorted and merged
+    ChannelRanges intersectRanges(ChannelRanges const& ranges, ChannelRanges const& within)
+    {
+        ChannelRanges result;
+        for (auto const& [start, count] : ranges) {
+            for (auto const& [withinStart, withinCount] : within) {
+                uint64_t const first = std::max(start, withinStart);
+                uint64_t const end = std::min(start + count, withinStart + withinCount);
+                if (first < end) {
+                    result.emplace_back(first, end - first);
+                }
+            }
+        }
+        return MergeRanges(std::move(result));
+    }
+}
+
+bool LoadModelFile(std::string const& filename, std::vector<Controller>& controllers)
+{
+    auto logger = spdlog::get(PROJECT_NAME);
+    if (!logger) {
+        logger = spdlog::default_logger();
+    }
+    pugi::xml_document doc;
+    pugi::xml_parse_result result = doc.load_file(filename.c_str());
+    pugi::xml_node models = doc.child("xrgb").child("models");
+    if (!result || !models) {
+        logger->warn("No models found in the model file: {}", filename);
+        return false;
+    }
+    ModelLayout layout(models, controllers);
+    //a model that can't be placed may sit on any channel of its controller, or any controller
+    std::set<std::string> unplaced;
+    bool unplacedAnywhere{ false };
+    size_t placed{ 0 };
+    for (pugi::xml_node model = models.child("model"); model; model = model.next_sibling("model")) {
+        auto const ranges = layout.ranges(model);
+        std::string const controller = model.attribute("Controller").value();
+        if (ranges.empty()) {
+            logger->warn("Model {} ({} starting at '{}') can't be placed, keeping the networks of {}", model.attribute("name").value(),
+                model.attribute("DisplayAs").value(), model.attribute("StartChannel").value(), controller.empty() ? "every controller" : controller);
+            unplacedAnywhere = unplacedAnywhere || controller.empty();
+            unplaced.insert(controller);
+            continue;
+        }
+        ++placed;
+        for (auto& target : controllers) {
+            auto clipped = intersectRanges(ranges, target.networks);
+            if (!clipped.empty()) {
+                target.models.push_back({ model.attribute("name").value(), std::move(clipped) });
+            }
+        }
+    }
+    logger->info("Placed {} models from {}", placed, filename);
+    for (auto& controller : controllers) {
+        //a controller without models is more likely one the file doesn't know about than an unused one
+        if (controller.models.empty() || unplacedAnywhere || unplaced.contains(controller.name)) {
+            continue;
+        }
+        ChannelRanges used;
+        for (auto const& model : controller.models) {
+            used.insert(used.end(), model.ranges.begin(), model.ranges.end());
+        }
+        controller.modelRanges = MergeRanges(std::move(used));
+        uint64_t const total = controller.channels;
+        controller.setRanges(controller.modelRanges);
+        logger->info("Controller {}: {} models use {} of {} channels in {} ranges", controller.name, controller.models.size(),
+            controller.channels, total, controller.ranges.size());
+    }
+    return true;
+}
@@ -1,16 +1,104 @@
 #pragma once
 
+#include "frame_transform.h"
+#include "power_limiter.h"
+
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+//start channel and channel count, the start is 1-based the way xLights shows it
+using ChannelRanges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+//pixel color order of a 1-based channel range, "GRB", "BRGW"...
+struct ColorOrderRange
+{
+    uint64_t start{ 0 };
+    uint64_t count{ 0 };
+    std::string order;
+};
+using ColorOrders = std::vector<ColorOrderRange>;
+
+//supply budget of a 1-based channel range, mA per channel at full and amps for the range
+struct PowerLimitRange
+{
+    uint64_t start{ 0 };
+    uint64_t count{ 0 };
+    double milliamps{ 0.0 };
+    double amps{ 0.0 };
+};
+using PowerLimits = std::vector<PowerLimitRange>;
+
+//a model of xlights_rgbeffects.xml, the channels it uses on one controller
+struct ModelChannels
+{
+    std::string name;
+    ChannelRanges ranges;
+};
 
 struct Controller
 {
 	Controller()
 	{}
 	Controller(std::string name_,std::string ip_,uint64_t sc, uint64_t chan )
-		: name(std::move(name_)), ip(std::move(ip_)), start_channel(sc), channels(chan)
+		: name(std::move(name_)), ip(std::move(ip_)), start_channel(sc), channels(chan), networks{ { sc, chan } }, ranges(networks)
 	{}
+	Controller(std::string name_, std::string ip_, ChannelRanges networks_);
 	std::string name;
 	std::string ip;
+	//as xLights names them, "Falcon" "F16V4", empty for controllers set up without one
+	std::string vendor;
+	std::string model;
 	uint64_t start_channel{0};
 	uint64_t channels{0};
-};
\ No newline at end of file
+	//one entry per network as read from the file, adjacent networks merged
+	ChannelRanges networks;
+	//models of xlights_rgbeffects.xml on this controller, empty without that file
+	std::vector<ModelChannels> models;
+	//channels some model uses, empty unless every model on the controller could be placed
+	ChannelRanges modelRanges;
+	//what gets exported, defaultRanges() unless the user edited them
+	ChannelRanges ranges;
+	//ports whose pixels don't take RGB
+	ColorOrders colorOrders;
+	//channel routing for strings and matrices wired differently from the sequence, null for none
+	std::string channelMapFile;
+	std::shared_ptr<const GatherPlan> channelMap;
+	//ports whose frames are dimmed when they would draw more than their supply
+	PowerLimits powerLimits;
+
+	void setRanges(ChannelRanges r);
+	//modelRanges when known, the networks otherwise
+	[[nodiscard]] ChannelRanges const& defaultRanges() const { return modelRanges.empty() ? networks : modelRanges; }
+	//0-based ranges for FSEQFile sparse output
+	[[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> sparseRanges() const;
+	//routes channels through channelMap then reorders the pixels of colorOrders, empty when
+	//every port takes RGB in the order the sequence has
+	[[nodiscard]] FrameTransform exportTransform() const;
+	//0-based powerLimits for PowerLimiter
+	[[nodiscard]] PowerPorts powerPorts() const;
+};
+
+//sorts and joins overlapping or touching ranges, drops empty ones
+ChannelRanges MergeRanges(ChannelRanges ranges);
+//FSEQFile sparse ranges are 0-based
+std::vector<std::pair<uint32_t, uint32_t>> ToSparseRanges(ChannelRanges const& ranges);
+//"1-510, 1021-1530", end channels are inclusive
+std::string FormatRanges(ChannelRanges const& ranges);
+//parses the FormatRanges text, false on malformed input
+bool ParseRanges(std::string const& text, ChannelRanges& ranges);
+//"1-510:GRB, 1021-1530:BRGW", sorted by start channel
+std::string FormatColorOrders(ColorOrders const& orders);
+bool ParseColorOrders(std::string const& text, ColorOrders& orders);
+//"1-510:20mA:5A, 1021-1530:12mA:7.5A", sorted by start channel
+std::string FormatPowerLimits(PowerLimits const& limits);
+bool ParsePowerLimits(std::string const& text, PowerLimits& limits);
+
+//parses an xlights_networks.xml file and the xlights_rgbeffects.xml next to it when there
+//is one, safe to call from a worker thread
+std::vector<Controller> LoadControllerFile(std::string const& filename);
+//places the models of an xlights_rgbeffects.xml on controllers and makes the channels they
+//use the default ranges, false when the file can't be read
+bool LoadModelFile(std::string const& filename, std::vector<Controller>& controllers);
@@ -0,0 +1,303 @@
+#include "controller_profile.h"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+    //the V2 writer aims at 64 KB blocks and spreads bigger files over at most 255 of them
+    constexpr uint64_t BlockTarget = 64 * 1024;
+    constexpr uint64_t MaxBlocks = 250;
+    //players also run their outputs, leave room over the bare data rate
+    constexpr double Headroom = 2.0;
+    //compressed / raw before a calibration measured it, most shows do better
+    constexpr std::array<double, 3> TypicalRatios{ 1.0, 0.35, 0.45 };
+
+    double toMB(double bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    bool equalsNoCase(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    //"; " separated notes without the last separator
+    std::string notes(std::ostringstream const& out)
+    {
+        std::string text = out.str();
+        if (text.size() >= 2) {
+            text.resize(text.size() - 2);
+        }
+        return text;
+    }
+
+    bool parseCodec(std::string const& text, FSEQFile::CompressionType& codec)
+    {
+        for (int x = 0; x < 3; ++x) {
+            if (equalsNoCase(text, FSEQFile::CompressionTypeStrings[x])) {
+                codec = static_cast<FSEQFile::CompressionType>(x);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //{ "zstd": 40, "none": 200 }
+    bool readCodecValues(nlohmann::json const& json, std::array<double, 3>& values)
+    {
+        if (!json.is_object()) {
+            return false;
+        }
+        for (auto const& [key, value] : json.items()) {
+            FSEQFile::CompressionType codec;
+            if (!parseCodec(key, codec) || !value.is_number()) {
+                return false;
+            }
+            values[codec] = value.get<double>();
+        }
+        return true;
+    }
+
+    //fields of json override the profile's, false on a field of the wrong type
+    bool applyProfile(nlohmann::json const& json, ControllerProfile& profile)
+    {
+        if (json.contains("vendor")) {
+            if (!json["vendor"].is_string()) {
+                return false;
+            }
+            profile.vendor = json["vendor"].get<std::string>();
+        }
+        if (json.contains("models")) {
+            if (!json["models"].is_array()) {
+                return false;
+            }
+            profile.models.clear();
+            for (auto const& model : json["models"]) {
+                if (!model.is_string()) {
+                    return false;
+                }
+                profile.models.push_back(model.get<std::string>());
+            }
+        }
+        if (json.contains("version")) {
+            //"2.2", "2.0", "1.0"
+            std::string const version = json["version"].is_string() ? json["version"].get<std::string>() : std::string();
+            if (version.size() != 3 || version[1] != '.' || !std::isdigit(static_cast<unsigned char>(version[0])) ||
+                !std::isdigit(static_cast<unsigned char>(version[2]))) {
+                return false;
+            }
+            profile.majorVersion = version[0] - '0';
+            profile.minorVersion = version[2] - '0';
+        }
+        if (json.contains("codecs")) {
+            if (!json["codecs"].is_array() || json["codecs"].empty()) {
+                return false;
+            }
+            profile.codecs.clear();
+            for (auto const& name : json["codecs"]) {
+                FSEQFile::CompressionType codec;
+                if (!name.is_string() || !parseCodec(name.get<std::string>(), codec)) {
+                    return false;
+                }
+                profile.codecs.push_back(codec);
+            }
+        }
+        if (json.contains("decode_mbps") && !readCodecValues(json["decode_mbps"], profile.decodeMBps)) {
+            return false;
+        }
+        if (json.contains("ratios") && !readCodecValues(json["ratios"], profile.ratios)) {
+            return false;
+        }
+        auto const number = [&json](char const* key, auto& value) {
+            if (!json.contains(key)) {
+                return true;
+            }
+            if (!json[key].is_number() || json[key].get<double>() < 0.0) {
+                return false;
+            }
+            value = json[key].get<std::remove_reference_t<decltype(value)>>();
+            return true;
+        };
+        uint64_t blockKB = profile.maxBlockBytes / 1024;
+        if (!number("read_mbps", profile.readMBps) || !number("max_block_kb", blockKB) || !number("max_channels", profile.maxChannels)) {
+            return false;
+        }
+        profile.maxBlockBytes = blockKB * 1024;
+        return true;
+    }
+}
+
+bool ControllerProfile::matches(std::string const& vendor_, std::string const& model) const
+{
+    if (!equalsNoCase(vendor, vendor_)) {
+        return false;
+    }
+    if (models.empty()) {
+        return true;
+    }
+    return std::any_of(models.begin(), models.end(), [&model](std::string const& prefix) {
+        return model.size() >= prefix.size() && equalsNoCase(std::string_view(model).substr(0, prefix.size()), prefix);
+    });
+}
+
+bool ControllerProfile::supports(FSEQFile::CompressionType codec) const
+{
+    return std::find(codecs.begin(), codecs.end(), codec) != codecs.end();
+}
+
+bool ControllerProfiles::load(std::string const& json, std::string& error)
+{
+    nlohmann::json const parsed = nlohmann::json::parse(json, nullptr, false);
+    if (parsed.is_discarded() || !parsed.is_object() || !parsed.contains("profiles") || !parsed["profiles"].is_array()) {
+        error = "expected an object with a \"profiles\" array";
+        return false;
+    }
+    //parsed into a copy so a bad entry leaves the loaded profiles alone
+    auto profiles = m_profiles;
+    for (auto const& entry : parsed["profiles"]) {
+        if (!entry.is_object() || !entry.contains("name") || !entry["name"].is_string()) {
+            error = "profile without a name";
+            return false;
+        }
+        auto const name = entry["name"].get<std::string>();
+        auto found = std::find_if(profiles.begin(), profiles.end(), [&name](auto const& profile) { return profile.name == name; });
+        if (found == profiles.end()) {
+            profiles.emplace_back().name = name;
+            found = std::prev(profiles.end());
+        }
+        if (!applyProfile(entry, *found)) {
+            error = "bad field in profile " + name;
+            return false;
+        }
+    }
+    m_profiles = std::move(profiles);
+    return true;
+}
+
+ControllerProfile const* ControllerProfiles::find(std::string const& vendor, std::string const& model) const
+{
+    auto const found = std::find_if(m_profiles.rbegin(), m_profiles.rend(), [&](auto const& profile) { return profile.matches(vendor, model); });
+    return found == m_profiles.rend() ? nullptr : &*found;
+}
+
+bool ControllerProfiles::SaveRatios(std::string const& path, ControllerProfile const& profile, std::string& error)
+{
+    nlohmann::json json = nlohmann::json::object();
+    if (std::ifstream in(path); in) {
+        std::stringstream text;
+        text << in.rdbuf();
+        json = nlohmann::json::parse(text.str(), nullptr, false);
+        //never overwrite a file the user broke by hand, they would lose their edits
+        if (json.is_discarded() || !json.is_object()) {
+            error = path + " is not a profiles file";
+            return false;
+        }
+    }
+    if (!json.contains("profiles") || !json["profiles"].is_array()) {
+        json["profiles"] = nlohmann::json::array();
+    }
+    auto& profiles = json["profiles"];
+    auto entry = std::find_if(profiles.begin(), profiles.end(), [&profile](auto const& item) {
+        return item.is_object() && item.value("name", "") == profile.name;
+    });
+    if (entry == profiles.end()) {
+        profiles.push_back({ { "name", profile.name } });
+        entry = std::prev(profiles.end());
+    }
+    nlohmann::json ratios = nlohmann::json::object();
+    for (int x = 0; x < 3; ++x) {
+        if (profile.ratios[x] > 0.0) {
+            ratios[FSEQFile::CompressionTypeStrings[x]] = profile.ratios[x];
+        }
+    }
+    (*entry)["ratios"] = ratios;
+    std::ofstream out(path);
+    if (!out) {
+        error = "can't write " + path;
+        return false;
+    }
+    out << json.dump(4);
+    return out.good();
+}
+
+ExportFormat ChooseExportFormat(ControllerProfile const& profile, ExportFormat const& run, ExportEstimate const& estimate,
+    std::string& reason, std::string& warning)
+{
+    std::ostringstream why;
+    why.precision(3);
+    warning.clear();
+    ExportFormat format = run;
+    if (std::make_pair(run.major_ver, run.minor_ver) > std::make_pair(profile.majorVersion, profile.minorVersion)) {
+        format.major_ver = profile.majorVersion;
+        format.minor_ver = profile.minorVersion;
+        why << "plays up to V" << profile.majorVersion << "." << profile.minorVersion << "; ";
+    }
+    if (profile.maxChannels != 0 && estimate.channels > profile.maxChannels) {
+        warning = std::to_string(estimate.channels) + " channels, " + profile.name + " takes " + std::to_string(profile.maxChannels);
+    }
+    //V1 files are never compressed
+    if (format.major_ver < 2) {
+        if (format.compressionType != FSEQFile::CompressionType::none) {
+            format.compressionType = FSEQFile::CompressionType::none;
+        }
+        reason = notes(why);
+        return format;
+    }
+
+    double const rawMBps = estimate.stepTime == 0 ? 0.0 : toMB(estimate.channels * (1000.0 / estimate.stepTime));
+    uint64_t const blockBytes = std::max(BlockTarget, estimate.rawBytes / MaxBlocks);
+    auto const fits = [&](FSEQFile::CompressionType codec, std::ostringstream& out) {
+        double const decode = profile.decodeMBps[codec];
+        if (decode > 0.0 && decode < rawMBps * Headroom) {
+            out << FSEQFile::CompressionTypeStrings[codec] << " decodes " << decode << " MB/s, needs " << rawMBps * Headroom << "; ";
+            return false;
+        }
+        if (codec != FSEQFile::CompressionType::none && profile.maxBlockBytes != 0 && blockBytes > profile.maxBlockBytes) {
+            out << FSEQFile::CompressionTypeStrings[codec] << " blocks of " << blockBytes / 1024 << " KB, holds " << profile.maxBlockBytes / 1024 << "; ";
+            return false;
+        }
+        double ratio = profile.ratios[codec] > 0.0 ? profile.ratios[codec] : TypicalRatios[codec];
+        if (codec == run.compressionType && estimate.valid) {
+            ratio = estimate.ratio;
+        }
+        if (profile.readMBps > 0.0 && rawMBps * ratio * Headroom > profile.readMBps) {
+            out << FSEQFile::CompressionTypeStrings[codec] << " reads " << rawMBps * ratio << " MB/s of " << profile.readMBps << "; ";
+            return false;
+        }
+        return true;
+    };
+
+    std::vector<FSEQFile::CompressionType> candidates;
+    if (profile.supports(run.compressionType)) {
+        candidates.push_back(run.compressionType);
+    } else {
+        why << FSEQFile::CompressionTypeStrings[run.compressionType] << " not supported; ";
+    }
+    for (auto codec : profile.codecs) {
+        if (std::find(candidates.begin(), candidates.end(), codec) == candidates.end()) {
+            candidates.push_back(codec);
+        }
+    }
+    auto const chosen = std::find_if(candidates.begin(), candidates.end(), [&](auto codec) { return fits(codec, why); });
+    if (chosen != candidates.end()) {
+        format.compressionType = *chosen;
+    } else {
+        //nothing fits, uncompressed at least costs the player no decoding
+        format.compressionType = profile.supports(FSEQFile::CompressionType::none) ? FSEQFile::CompressionType::none : profile.codecs.front();
+        why << "nothing fits; ";
+        warning += std::string(warning.empty() ? "" : ", ") + "no format " + profile.name + " keeps up with";
+    }
+    //the run's level means nothing to another codec
+    format.compressionLevel = format.compressionType == run.compressionType ? run.compressionLevel : -99;
+    reason = notes(why);
+    return format;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "FSEQFile.h"
+#include "export_estimator.h"
+#include "export_job.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//What the player of a controller can take, from the profile database shipped with the
+//program and the user's overrides. Rates and limits of 0 are unknown and not checked.
+struct ControllerProfile
+{
+    std::string name;
+    //matched against the Vendor and Model xLights writes for the controller, case insensitive
+    std::string vendor;
+    //model name prefixes, empty matches every model of the vendor
+    std::vector<std::string> models;
+    //newest file version it plays
+    int majorVersion{ 2 };
+    int minorVersion{ 2 };
+    //codecs it decodes, the first is used when the run's codec isn't one of them
+    std::vector<FSEQFile::CompressionType> codecs{ FSEQFile::CompressionType::zstd, FSEQFile::CompressionType::zlib, FSEQFile::CompressionType::none };
+    //MB/s of channel data the player decodes with each codec, indexed by CompressionType
+    std::array<double, 3> decodeMBps{};
+    //MB/s the player reads from its card
+    double readMBps{ 0.0 };
+    //largest uncompressed block the player holds in memory
+    uint64_t maxBlockBytes{ 0 };
+    uint64_t maxChannels{ 0 };
+    //compressed / raw of each codec measured on the user's sequences, 0 until calibrated
+    std::array<double, 3> ratios{};
+
+    [[nodiscard]] bool matches(std::string const& vendor, std::string const& model) const;
+    [[nodiscard]] bool supports(FSEQFile::CompressionType codec) const;
+};
+
+//Built-in profiles with the user's overrides on top. An override with the name of a
+//built-in profile replaces the fields it has, other overrides are added as they are.
+class ControllerProfiles
+{
+public:
+    //{ "profiles": [ { "name": ..., "vendor": ..., ... } ] }, false with error for bad text
+    bool load(std::string const& json, std::string& error);
+    //last profile matching the controller so profiles the user added win, null when none does
+    [[nodiscard]] ControllerProfile const* find(std::string const& vendor, std::string const& model) const;
+    [[nodiscard]] std::vector<ControllerProfile> const& profiles() const { return m_profiles; }
+
+    //merges the calibrated ratios of profile into the overrides file at path, keeping what else it has
+    static bool SaveRatios(std::string const& path, ControllerProfile const& profile, std::string& error);
+
+private:
+    std::vector<ControllerProfile> m_profiles;
+};
+
+//Format for a controller's file: the run's format wherever the profile allows it, else the
+//first codec the player decodes fast enough, holds the blocks of and reads off its card
+//with room to spare. reason says what was changed and why, empty when nothing was.
+//warning says what no format fixes, more channels than the player takes or no codec
+//it keeps up with, empty when the file suits the player.
+ExportFormat ChooseExportFormat(ControllerProfile const& profile, ExportFormat const& run, ExportEstimate const& estimate,
+    std::string& reason, std::string& warning);
@@ -0,0 +1,59 @@
+#include "eseq_export_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+EseqExportDialog::EseqExportDialog(QString const& controller, QStringList const& items, QWidget* parent) :
+    QDialog(parent)
+{
+    setWindowTitle(QString("Export ESEQ - %1").arg(controller));
+    resize(460, 420);
+    auto* layout = new QVBoxLayout(this);
+    auto* label = new QLabel("Each checked model gets an effect sequence of its channels for every selected FSEQ, all read in one pass.", this);
+    label->setWordWrap(true);
+    layout->addWidget(label);
+
+    m_list = new QListWidget(this);
+    for (auto const& item : items) {
+        auto* row = new QListWidgetItem(item, m_list);
+        row->setFlags(row->flags() | Qt::ItemIsUserCheckable);
+        row->setCheckState(Qt::Checked);
+    }
+    layout->addWidget(m_list);
+
+    auto* rowButtons = new QHBoxLayout();
+    auto const checkAll = [this](Qt::CheckState state) {
+        for (int x = 0; x < m_list->count(); ++x) {
+            m_list->item(x)->setCheckState(state);
+        }
+    };
+    auto* all = new QPushButton("All", this);
+    connect(all, &QPushButton::clicked, this, [checkAll]() { checkAll(Qt::Checked); });
+    rowButtons->addWidget(all);
+    auto* none = new QPushButton("None", this);
+    connect(none, &QPushButton::clicked, this, [checkAll]() { checkAll(Qt::Unchecked); });
+    rowButtons->addWidget(none);
+    rowButtons->addStretch();
+    layout->addLayout(rowButtons);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons->button(QDialogButtonBox::Ok)->setText("Export");
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
+
+QList<int> EseqExportDialog::selected() const
+{
+    QList<int> rows;
+    for (int x = 0; x < m_list->count(); ++x) {
+        if (m_list->item(x)->checkState() == Qt::Checked) {
+            rows.append(x);
+        }
+    }
+    return rows;
+}
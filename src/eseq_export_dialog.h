@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QListWidget;
+
+//Picks the models or ranges of a controller that get an ESEQ file each
+class EseqExportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    EseqExportDialog(QString const& controller, QStringList const& items, QWidget* parent = nullptr);
+
+    //indexes into items of the checked rows
+    [[nodiscard]] QList<int> selected() const;
+
+private:
+    QListWidget* m_list{ nullptr };
+};
@@ -0,0 +1,134 @@
+#include "export_estimator.h"
+
+#include "frame_resampler.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+    constexpr uint32_t SampleWindows = 4;
+}
+
+double ExportEstimate::playbackBytesPerSecond() const
+{
+    double const seconds = durationSeconds();
+    if (seconds <= 0.0) {
+        return 0.0;
+    }
+    return estimatedBytes / seconds;
+}
+
+void ExportEstimate::trim(uint32_t windowFrames)
+{
+    if (!valid || frames == 0 || windowFrames >= frames) {
+        return;
+    }
+    double const scale = static_cast<double>(windowFrames) / frames;
+    rawBytes = static_cast<uint64_t>(rawBytes * scale);
+    estimatedBytes = static_cast<uint64_t>(estimatedBytes * scale);
+    frames = windowFrames;
+}
+
+void ExportEstimate::resample(int newStepTime)
+{
+    if (!valid || frames == 0 || newStepTime <= 0 || static_cast<uint32_t>(newStepTime) == stepTime) {
+        return;
+    }
+    uint32_t const newFrames = FrameResampler::OutputFrames(frames, stepTime, newStepTime);
+    double const scale = static_cast<double>(newFrames) / frames;
+    rawBytes = static_cast<uint64_t>(rawBytes * scale);
+    estimatedBytes = static_cast<uint64_t>(estimatedBytes * scale);
+    frames = newFrames;
+    stepTime = newStepTime;
+}
+
+ExportEstimate EstimateExport(std::string const& in_path, std::vector<std::pair<uint32_t, uint32_t>> ranges,
+    int major_ver, int minor_ver, FSEQFile::CompressionType compressionType, int compressionLevel, bool sparse,
+    uint32_t sampleFrames)
+{
+    ExportEstimate estimate;
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(in_path));
+    if (nullptr == src) {
+        return estimate;
+    }
+    uint32_t channelCount{ 0 };
+    for (auto const& [start, count] : ranges) {
+        channelCount += count;
+    }
+    if (ranges.empty()) {
+        ranges.push_back(std::pair<uint32_t, uint32_t>(0, src->getChannelCount()));
+        channelCount = src->getChannelCount();
+    }
+    estimate.frames = src->getNumFrames();
+    estimate.stepTime = src->getStepTime();
+    estimate.channels = channelCount;
+    estimate.rawBytes = static_cast<uint64_t>(estimate.frames) * channelCount;
+
+    auto const makeDest = [&]() -> std::unique_ptr<FSEQFile> {
+        std::unique_ptr<FSEQFile> dest;
+        if (major_ver == 1) {
+            dest = std::make_unique<V1FSEQFile>("-memory-");
+        } else {
+            auto v2 = std::make_unique<V2FSEQFile>("-memory-", compressionType, compressionLevel);
+            if (sparse) {
+                v2->m_sparseRanges = ranges;
+            }
+            dest = std::move(v2);
+        }
+        dest->enableMinorVersionFeatures(minor_ver);
+        dest->initializeFromFSEQ(*src);
+        //sparse headers clip their ranges against the source channel count and sum them up themselves
+        if (major_ver == 1 || !sparse) {
+            dest->setChannelCount(channelCount);
+        }
+        dest->writeHeader();
+        return dest;
+    };
+
+    //header size does not depend on the data, measure it once
+    uint64_t const headerBytes = makeDest()->getMemoryBufferPos();
+    if (major_ver == 1 || compressionType == FSEQFile::CompressionType::none || estimate.frames == 0) {
+        estimate.estimatedBytes = headerBytes + estimate.rawBytes;
+        estimate.valid = true;
+        return estimate;
+    }
+
+    src->prepareRead(ranges);
+    std::vector<uint8_t> data(std::max<uint32_t>(src->getChannelCount(), channelCount));
+    uint32_t const windowFrames = std::max<uint32_t>(1, std::min(estimate.frames, sampleFrames) / SampleWindows);
+    uint64_t sampledRaw{ 0 };
+    uint64_t sampledCompressed{ 0 };
+    for (uint32_t w = 0; w < SampleWindows; w++) {
+        uint32_t const first = static_cast<uint32_t>(static_cast<uint64_t>(estimate.frames - windowFrames) * w / std::max<uint32_t>(1, SampleWindows - 1));
+        auto dest = makeDest();
+        uint64_t const start = dest->getMemoryBufferPos();
+        uint32_t added{ 0 };
+        for (uint32_t x = first; x < first + windowFrames && x < estimate.frames; x++) {
+            std::unique_ptr<FSEQFile::FrameData> fdata(src->getFrame(x));
+            if (!fdata) {
+                break;
+            }
+            fdata->readFrame(data.data(), static_cast<uint32_t>(data.size()));
+            //real frame numbers so the fast first block is only modelled where it occurs
+            dest->addFrame(x, data.data());
+            ++added;
+        }
+        if (added == 0) {
+            continue;
+        }
+        dest->finalize();
+        sampledCompressed += dest->getMemoryBuffer().size() - start;
+        sampledRaw += static_cast<uint64_t>(added) * channelCount;
+        if (estimate.frames <= windowFrames) {
+            break;
+        }
+    }
+    if (sampledRaw == 0) {
+        return estimate;
+    }
+    estimate.ratio = static_cast<double>(sampledCompressed) / sampledRaw;
+    estimate.estimatedBytes = headerBytes + static_cast<uint64_t>(estimate.rawBytes * estimate.ratio);
+    estimate.valid = true;
+    return estimate;
+}
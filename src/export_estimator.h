@@ -0,0 +1,33 @@
+#pragma once
+
+#include "FSEQFile.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ExportEstimate
+{
+    bool valid{ false };
+    uint32_t frames{ 0 };
+    uint32_t stepTime{ 0 };
+    uint32_t channels{ 0 };
+    uint64_t rawBytes{ 0 };       //uncompressed channel data of the selected ranges
+    uint64_t estimatedBytes{ 0 }; //predicted output file size, header included
+    double ratio{ 1.0 };          //sampled compressed / raw
+
+    [[nodiscard]] double durationSeconds() const { return frames * (stepTime / 1000.0); }
+    //bytes per second a player has to read to keep up
+    [[nodiscard]] double playbackBytesPerSecond() const;
+    //scales the sizes to a part of the sequence
+    void trim(uint32_t windowFrames);
+    //scales the sizes to the frame count the same sequence has at another step time
+    void resample(int newStepTime);
+};
+
+//Predicts the size of an export by compressing a few evenly spaced windows of
+//frames into memory with the same settings as the real export.
+ExportEstimate EstimateExport(std::string const& in_path, std::vector<std::pair<uint32_t, uint32_t>> ranges,
+    int major_ver, int minor_ver, FSEQFile::CompressionType compressionType, int compressionLevel, bool sparse,
+    uint32_t sampleFrames = 240);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "FSEQFile.h"
+#include "export_estimator.h"
+#include "frame_transform.h"
+#include "power_limiter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//called after every frame, returning false aborts the file
+using ExportProgressCallback = std::function<bool(uint32_t frame, uint32_t frames, uint64_t bytesWritten)>;
+
+//source frames inside an export's time window
+struct FrameWindow
+{
+    uint32_t first{ 0 };
+    uint32_t count{ 0 };
+
+    [[nodiscard]] bool trims(uint32_t frames) const { return first != 0 || count != frames; }
+};
+
+//header changes for an export that only holds part of the source
+inline void TrimExportHeader(FSEQFile& dest, FrameWindow const& window)
+{
+    dest.setNumFrames(window.count);
+    //players caching by id have to see a different sequence
+    dest.setUniqueId(0);
+    //the media would start from the top while the lights start part way in
+    if (window.first != 0) {
+        dest.removeVariableHeader('m', 'f');
+    }
+}
+
+//The file format part of the settings, controller profiles may pick another one per file
+struct ExportFormat
+{
+    int major_ver{ 2 };
+    int minor_ver{ 2 };
+    FSEQFile::CompressionType compressionType{ FSEQFile::CompressionType::zstd };
+    int compressionLevel{ -99 };
+
+    auto operator<=>(ExportFormat const&) const = default;
+};
+
+//Output format options shared by every file in one export run
+struct ExportSettings
+{
+    int major_ver{ 2 };
+    int minor_ver{ 2 };
+    FSEQFile::CompressionType compressionType{ FSEQFile::CompressionType::zstd };
+    int compressionLevel{ -99 };
+    bool sparse{ false };
+    //drop channels that are zero in every frame from the sparse ranges
+    bool trimDark{ false };
+    //output step time in ms, 0 keeps the source step time
+    int stepTime{ 0 };
+    //blend neighbouring frames when resampling instead of dropping or repeating them
+    bool blendFrames{ true };
+    //time window in ms, an endMS of 0 runs to the end of the sequence
+    uint32_t startMS{ 0 };
+    uint32_t endMS{ 0 };
+    //brightness, gamma and curve applied to the exported ranges
+    ChannelCurve curve;
+
+    [[nodiscard]] ExportFormat format() const { return { major_ver, minor_ver, compressionType, compressionLevel }; }
+    [[nodiscard]] ExportSettings with(ExportFormat const& format) const
+    {
+        ExportSettings settings = *this;
+        settings.major_ver = format.major_ver;
+        settings.minor_ver = format.minor_ver;
+        settings.compressionType = format.compressionType;
+        settings.compressionLevel = format.compressionLevel;
+        return settings;
+    }
+
+    //frames from the one playing at startMS up to the last one starting before endMS
+    [[nodiscard]] FrameWindow window(uint32_t frames, int stepTime) const
+    {
+        uint32_t const step = static_cast<uint32_t>(std::max(1, stepTime));
+        FrameWindow window;
+        window.first = std::min(frames, startMS / step);
+        uint32_t const end = endMS == 0 ? frames : std::min(frames, (endMS + step - 1) / step);
+        window.count = end > window.first ? end - window.first : 0;
+        return window;
+    }
+};
+
+struct ControllerProfile;
+
+//One source sequence written to one destination
+struct ExportJob
+{
+    std::string source;
+    std::string fileName;
+    std::string destination;
+    std::string device;      //root of the volume destination is on
+    std::string controller;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    ExportEstimate estimate;
+    //channels added between ranges by the range optimizer
+    uint64_t paddedChannels{ 0 };
+    //always dark channels left out of the ranges
+    uint64_t trimmedChannels{ 0 };
+    //controller specific stages run after the settings curve, the channel map and pixel color order
+    FrameTransform transform;
+    //supply budgets checked on the final values of every frame
+    PowerPorts power;
+    //player limits the format is chosen against, null to take the run's format
+    std::shared_ptr<const ControllerProfile> profile;
+    //format the profile picked when it isn't the run's
+    std::optional<ExportFormat> format;
+    //an ESEQ of the single range instead of an FSEQ
+    bool eseq{ false };
+    //what the file breaks of the player's limits, shown in the plan
+    std::string warning;
+
+    [[nodiscard]] ExportSettings settings(ExportSettings const& run) const { return format ? run.with(*format) : run; }
+};
@@ -0,0 +1,109 @@
+#include "export_plan.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace
+{
+    //sampled estimates can run a little low on sequences that get busier towards the end
+    constexpr double EstimateMargin = 0.05;
+
+    uint64_t RoundToBlocks(uint64_t bytes, uint64_t blockSize)
+    {
+        if (blockSize == 0) {
+            return bytes;
+        }
+        return (bytes + blockSize - 1) / blockSize * blockSize;
+    }
+
+    uint64_t MaxFileSize(std::string fileSystemType)
+    {
+        std::transform(fileSystemType.begin(), fileSystemType.end(), fileSystemType.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (fileSystemType == "vfat" || fileSystemType == "msdos" || fileSystemType.starts_with("fat")) {
+            return 0xFFFFFFFFull;
+        }
+        return 0;
+    }
+}
+
+uint64_t ExportPlan::requiredBytes() const
+{
+    uint64_t total{ 0 };
+    for (auto const& entry : entries) {
+        total += entry.allocatedBytes;
+    }
+    return total;
+}
+
+uint64_t ExportPlan::reclaimedBytes() const
+{
+    uint64_t total{ 0 };
+    for (auto const& entry : entries) {
+        total += entry.replacedBytes;
+    }
+    return total;
+}
+
+std::vector<std::pair<std::string, uint64_t>> ExportPlan::controllerTotals() const
+{
+    std::vector<std::pair<std::string, uint64_t>> totals;
+    for (auto const& entry : entries) {
+        auto it = std::find_if(totals.begin(), totals.end(), [&](auto const& t) { return t.first == entry.controller; });
+        if (it == totals.end()) {
+            totals.emplace_back(entry.controller, entry.allocatedBytes);
+        } else {
+            it->second += entry.allocatedBytes;
+        }
+    }
+    return totals;
+}
+
+bool ExportPlan::hasTooLarge() const
+{
+    return std::any_of(entries.begin(), entries.end(), [](auto const& entry) { return entry.tooLarge; });
+}
+
+bool ExportPlan::hasWarnings() const
+{
+    return std::any_of(entries.begin(), entries.end(), [](auto const& entry) { return !entry.warning.empty(); });
+}
+
+ExportPlan::Fit ExportPlan::fit() const
+{
+    double const space = static_cast<double>(availableBytes) + reclaimedBytes();
+    double const required = static_cast<double>(requiredBytes());
+    if (hasTooLarge() || required > space) {
+        return Fit::DoesNotFit;
+    }
+    if (required * (1.0 + EstimateMargin) > space) {
+        return Fit::Tight;
+    }
+    return Fit::Fits;
+}
+
+ExportPlan BuildExportPlan(std::vector<ExportJob> const& jobs, uint64_t availableBytes, uint64_t blockSize, std::string const& fileSystemType)
+{
+    ExportPlan plan;
+    plan.availableBytes = availableBytes;
+    plan.blockSize = blockSize;
+    plan.maxFileBytes = MaxFileSize(fileSystemType);
+    for (auto const& job : jobs) {
+        ExportPlanEntry entry;
+        entry.controller = job.controller;
+        entry.fileName = job.fileName;
+        entry.destination = job.destination;
+        entry.estimatedBytes = job.estimate.estimatedBytes;
+        entry.allocatedBytes = RoundToBlocks(job.estimate.estimatedBytes, blockSize);
+        entry.ratio = job.estimate.ratio;
+        entry.tooLarge = plan.maxFileBytes != 0 && job.estimate.estimatedBytes > plan.maxFileBytes;
+        entry.warning = job.warning;
+        std::error_code ec;
+        auto const existing = std::filesystem::file_size(job.destination, ec);
+        if (!ec) {
+            entry.replacedBytes = RoundToBlocks(existing, blockSize);
+        }
+        plan.entries.push_back(std::move(entry));
+    }
+    return plan;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "export_job.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ExportPlanEntry
+{
+    std::string controller;
+    std::string fileName;
+    std::string destination;
+    uint64_t estimatedBytes{ 0 };
+    uint64_t allocatedBytes{ 0 }; //rounded up to whole file system blocks
+    uint64_t replacedBytes{ 0 };  //space freed by overwriting an existing file
+    double ratio{ 1.0 };
+    bool tooLarge{ false };       //over the file system's maximum file size
+    std::string warning;          //player limits the file breaks
+};
+
+//Checks the estimated export against the free space of the target before anything is written
+struct ExportPlan
+{
+    enum class Fit { Fits, Tight, DoesNotFit };
+
+    std::vector<ExportPlanEntry> entries;
+    uint64_t availableBytes{ 0 };
+    uint64_t blockSize{ 0 };
+    uint64_t maxFileBytes{ 0 };   //0 when the file system has no practical limit
+
+    [[nodiscard]] uint64_t requiredBytes() const;
+    [[nodiscard]] uint64_t reclaimedBytes() const;
+    [[nodiscard]] std::vector<std::pair<std::string, uint64_t>> controllerTotals() const;
+    [[nodiscard]] bool hasTooLarge() const;
+    [[nodiscard]] bool hasWarnings() const;
+    [[nodiscard]] Fit fit() const;
+};
+
+ExportPlan BuildExportPlan(std::vector<ExportJob> const& jobs, uint64_t availableBytes, uint64_t blockSize, std::string const& fileSystemType);
@@ -0,0 +1,87 @@
+#include "export_plan_dialog.h"
+
+#include <QColor>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace
+{
+    QString formatSize(uint64_t bytes)
+    {
+        if (bytes >= 1024ull * 1024 * 1024) {
+            return QString("%1 GB").arg(bytes / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2);
+        }
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+}
+
+ExportPlanDialog::ExportPlanDialog(ExportPlan const& plan, QString const& target, QWidget* parent) :
+    QDialog(parent)
+{
+    setWindowTitle("Export Plan");
+    resize(640, 480);
+    auto* layout = new QVBoxLayout(this);
+
+    auto const fit = plan.fit();
+    QString summary = QString("Target: %1<br>Estimated output: %2<br>Free space: %3")
+        .arg(target.toHtmlEscaped()).arg(formatSize(plan.requiredBytes())).arg(formatSize(plan.availableBytes));
+    if (plan.reclaimedBytes() != 0) {
+        summary += QString(" (+%1 from files that will be replaced)").arg(formatSize(plan.reclaimedBytes()));
+    }
+    if (plan.hasTooLarge()) {
+        summary += QString("<br><b>One or more files are larger than the %1 the card's file system allows.</b>").arg(formatSize(plan.maxFileBytes));
+    } else if (fit == ExportPlan::Fit::DoesNotFit) {
+        summary += "<br><b>The export will not fit on the selected drive.</b>";
+    } else if (fit == ExportPlan::Fit::Tight) {
+        summary += "<br><b>The export will only just fit, the estimate may be slightly low.</b>";
+    }
+    if (plan.hasWarnings()) {
+        summary += "<br><b>Files marked in orange are more than their controller's player takes.</b>";
+    }
+    auto* label = new QLabel(summary, this);
+    label->setWordWrap(true);
+    layout->addWidget(label);
+
+    auto* tree = new QTreeWidget(this);
+    tree->setColumnCount(3);
+    tree->setHeaderLabels({ "File", "Estimated Size", "Ratio" });
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    tree->setRootIsDecorated(true);
+    auto const totals = plan.controllerTotals();
+    bool const grouped = totals.size() > 1 || (totals.size() == 1 && !totals.front().first.empty());
+    for (auto const& [controller, bytes] : totals) {
+        QTreeWidgetItem* parentItem = nullptr;
+        if (grouped) {
+            parentItem = new QTreeWidgetItem(tree, { QString::fromStdString(controller), formatSize(bytes), QString() });
+            parentItem->setExpanded(totals.size() == 1);
+        }
+        for (auto const& entry : plan.entries) {
+            if (entry.controller != controller) {
+                continue;
+            }
+            QStringList columns{ QString::fromStdString(entry.fileName), formatSize(entry.allocatedBytes),
+                QString("%1%").arg(entry.ratio * 100.0, 0, 'f', 1) };
+            auto* item = parentItem ? new QTreeWidgetItem(parentItem, columns) : new QTreeWidgetItem(tree, columns);
+            item->setToolTip(0, QString::fromStdString(entry.destination));
+            if (entry.tooLarge) {
+                item->setForeground(1, Qt::red);
+            }
+            if (!entry.warning.empty()) {
+                item->setForeground(0, QColor(255, 140, 0));
+                item->setToolTip(0, QString("%1\n%2").arg(QString::fromStdString(entry.destination)).arg(QString::fromStdString(entry.warning)));
+            }
+        }
+    }
+    layout->addWidget(tree);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    buttons->button(QDialogButtonBox::Ok)->setText("Export");
+    buttons->button(QDialogButtonBox::Ok)->setEnabled(fit != ExportPlan::Fit::DoesNotFit);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "export_plan.h"
+
+#include <QDialog>
+
+//Shows the estimated size of every output, grouped by controller, next to the
+//free space on the target. Export is only offered when the plan fits.
+class ExportPlanDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ExportPlanDialog(ExportPlan const& plan, QString const& target, QWidget* parent = nullptr);
+};
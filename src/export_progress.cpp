@@ -0,0 +1,80 @@
+#include "export_progress.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+namespace
+{
+    QString formatDuration(double seconds)
+    {
+        auto const total = static_cast<qint64>(seconds + 0.5);
+        if (total >= 3600) {
+            return QString("%1:%2:%3").arg(total / 3600).arg((total / 60) % 60, 2, 10, QChar('0')).arg(total % 60, 2, 10, QChar('0'));
+        }
+        return QString("%1:%2").arg(total / 60).arg(total % 60, 2, 10, QChar('0'));
+    }
+}
+
+ExportProgress::ExportProgress(QWidget* parent, uint64_t totalBytes, double cardWriteMBps) :
+    m_dialog("Exporting FSEQ Files...", "Abort", 0, Steps, parent),
+    m_totalBytes(std::max<uint64_t>(totalBytes, 1)),
+    m_cardWriteMBps(cardWriteMBps)
+{
+    m_dialog.setWindowModality(Qt::WindowModal);
+    m_dialog.setMinimumDuration(0);
+    m_dialog.setValue(0);
+    m_timer.start();
+    m_lastRefresh.start();
+}
+
+void ExportProgress::beginFile(QString const& label, uint64_t estimatedBytes)
+{
+    m_label = label;
+    m_fileBytes = estimatedBytes;
+    refresh(0.0, 0);
+}
+
+bool ExportProgress::update(uint32_t frame, uint32_t frames, uint64_t bytesWritten)
+{
+    //repainting on every frame would cost more than the export itself
+    if (m_lastRefresh.elapsed() < 100) {
+        return !m_dialog.wasCanceled();
+    }
+    refresh(frames ? static_cast<double>(frame) / frames : 1.0, bytesWritten);
+    return !m_dialog.wasCanceled();
+}
+
+void ExportProgress::endFile(uint64_t bytesWritten)
+{
+    m_doneBytes += m_fileBytes;
+    m_writtenBytes += bytesWritten;
+    m_fileBytes = 0;
+}
+
+void ExportProgress::refresh(double fileFraction, uint64_t bytesWritten)
+{
+    m_lastRefresh.restart();
+    double const done = m_doneBytes + m_fileBytes * fileFraction;
+    double const fraction = std::min(1.0, done / m_totalBytes);
+    m_dialog.setValue(static_cast<int>(fraction * Steps));
+
+    double const elapsed = m_timer.elapsed() / 1000.0;
+    double const written = static_cast<double>(m_writtenBytes + bytesWritten);
+    QString status;
+    if (elapsed > 0.5 && written > 0) {
+        status = QString("%1 MB/s").arg(written / (1024.0 * 1024.0) / elapsed, 0, 'f', 1);
+    }
+    //until there is some history fall back to the measured card speed
+    double remaining{ -1.0 };
+    if (elapsed > 2.0 && fraction > 0.02) {
+        remaining = elapsed / fraction - elapsed;
+    } else if (m_cardWriteMBps > 0.0) {
+        remaining = (m_totalBytes - done) / (m_cardWriteMBps * 1024.0 * 1024.0);
+    }
+    if (remaining >= 0.0) {
+        status += (status.isEmpty() ? "" : ", ") + QString("about %1 remaining").arg(formatDuration(remaining));
+    }
+    m_dialog.setLabelText(status.isEmpty() ? m_label : m_label + "\n" + status);
+    QCoreApplication::processEvents();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QProgressDialog>
+#include <QString>
+
+#include <cstdint>
+
+//Progress dialog driven by estimated output bytes instead of file count, so
+//one large sequence no longer looks like a small one. Shows MB/s and time left.
+class ExportProgress
+{
+public:
+    ExportProgress(QWidget* parent, uint64_t totalBytes, double cardWriteMBps);
+
+    void beginFile(QString const& label, uint64_t estimatedBytes);
+    //returns false once the user pressed Abort
+    bool update(uint32_t frame, uint32_t frames, uint64_t bytesWritten);
+    void endFile(uint64_t bytesWritten);
+
+    [[nodiscard]] bool wasCanceled() const { return m_dialog.wasCanceled(); }
+
+private:
+    void refresh(double fileFraction, uint64_t bytesWritten);
+
+    static constexpr int Steps = 1000;
+
+    QProgressDialog m_dialog;
+    QElapsedTimer m_timer;
+    QElapsedTimer m_lastRefresh;
+    QString m_label;
+    uint64_t m_totalBytes{ 0 };
+    uint64_t m_doneBytes{ 0 };
+    uint64_t m_fileBytes{ 0 };
+    uint64_t m_writtenBytes{ 0 };
+    double m_cardWriteMBps{ 0.0 };
+};
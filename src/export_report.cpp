@@ -0,0 +1,195 @@
+#include "export_report.h"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    double toMB(uint64_t bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    double toSeconds(uint64_t nanos)
+    {
+        return nanos / 1e9;
+    }
+
+    double rate(uint64_t bytes, uint64_t nanos)
+    {
+        if (nanos == 0) {
+            return 0.0;
+        }
+        return toMB(bytes) / toSeconds(nanos);
+    }
+
+    FSEQFile::Stats::Stage slowestStage(FSEQFile::Stats const& stats)
+    {
+        auto const it = std::max_element(std::begin(stats.nanos), std::end(stats.nanos));
+        return static_cast<FSEQFile::Stats::Stage>(std::distance(std::begin(stats.nanos), it));
+    }
+
+    nlohmann::json stagesToJson(FSEQFile::Stats const& stats)
+    {
+        nlohmann::json stages = nlohmann::json::object();
+        for (int x = 0; x < FSEQFile::Stats::StageCount; x++) {
+            stages[FSEQFile::Stats::StageStrings[x]] = {
+                { "seconds", toSeconds(stats.nanos[x]) },
+                { "bytes", stats.bytes[x] },
+                { "mb_per_sec", rate(stats.bytes[x], stats.nanos[x]) }
+            };
+        }
+        return stages;
+    }
+}
+
+double ExportFileReport::compressionRatio() const
+{
+    if (!compressed || outputBytes == 0) {
+        return 1.0;
+    }
+    return static_cast<double>(rawBytes) / outputBytes;
+}
+
+FSEQFile::Stats::Stage ExportFileReport::bottleneck() const
+{
+    return slowestStage(stats);
+}
+
+FSEQFile::Stats ExportRunReport::totals() const
+{
+    FSEQFile::Stats total;
+    for (auto const& file : files) {
+        total.add(file.stats);
+    }
+    return total;
+}
+
+uint64_t ExportRunReport::sourceBytes() const
+{
+    uint64_t total{ 0 };
+    for (auto const& file : files) {
+        total += file.sourceBytes;
+    }
+    return total;
+}
+
+uint64_t ExportRunReport::outputBytes() const
+{
+    uint64_t total{ 0 };
+    for (auto const& file : files) {
+        total += file.outputBytes;
+    }
+    return total;
+}
+
+double ExportRunReport::compressionRatio() const
+{
+    uint64_t const out = outputBytes();
+    if (out == 0) {
+        return 1.0;
+    }
+    uint64_t raw{ 0 };
+    for (auto const& file : files) {
+        raw += file.compressed ? file.rawBytes : file.outputBytes;
+    }
+    return static_cast<double>(raw) / out;
+}
+
+FSEQFile::Stats::Stage ExportRunReport::bottleneck() const
+{
+    return slowestStage(totals());
+}
+
+std::string ExportRunReport::summary() const
+{
+    auto const total = totals();
+    auto const busy = total.totalNanos();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "Files: " << files.size() << (cancelled ? " (cancelled)" : "") << "\n";
+    out << "Time: " << toSeconds(wallNanos) << " s\n";
+    out << "Read: " << toMB(sourceBytes()) << " MB (" << rate(sourceBytes(), wallNanos) << " MB/s)\n";
+    out << "Written: " << toMB(outputBytes()) << " MB (" << rate(outputBytes(), wallNanos) << " MB/s)\n";
+    out << std::setprecision(2) << "Compression Ratio: " << compressionRatio() << ":1\n" << std::setprecision(1);
+    out << "\n";
+    for (int x = 0; x < FSEQFile::Stats::StageCount; x++) {
+        double const share = busy ? 100.0 * total.nanos[x] / busy : 0.0;
+        out << FSEQFile::Stats::StageStrings[x] << ": " << toSeconds(total.nanos[x]) << " s (" << share << "%, "
+            << rate(total.bytes[x], total.nanos[x]) << " MB/s)\n";
+    }
+    out << "\nBottleneck: " << FSEQFile::Stats::StageStrings[bottleneck()];
+    return out.str();
+}
+
+std::string ExportRunReport::details() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    for (auto const& file : files) {
+        out << file.destination << (file.ok ? "" : " (FAILED)") << "\n";
+        out << "    " << toSeconds(file.wallNanos) << " s, " << toMB(file.outputBytes) << " MB, ";
+        if (file.compressed) {
+            out << std::setprecision(2) << file.compressionRatio() << ":1, " << std::setprecision(1);
+        } else {
+            out << "uncompressed, ";
+        }
+        out << "bottleneck " << FSEQFile::Stats::StageStrings[file.bottleneck()] << "\n";
+        if (file.sparseRanges != 0) {
+            out << "    " << file.sparseRanges << " sparse ranges, " << file.paddedChannels << " padded channels, "
+                << file.trimmedChannels << " dark channels trimmed\n";
+        }
+        if (file.powerLimitedFrames != 0) {
+            out << "    " << file.powerLimitedFrames << " frames power limited\n";
+            std::istringstream ports(file.powerLimits);
+            for (std::string line; std::getline(ports, line);) {
+                out << "        " << line << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+bool ExportRunReport::writeJson(std::string const& path) const
+{
+    nlohmann::json json;
+    json["wall_seconds"] = toSeconds(wallNanos);
+    json["cancelled"] = cancelled;
+    json["source_bytes"] = sourceBytes();
+    json["output_bytes"] = outputBytes();
+    json["compression_ratio"] = compressionRatio();
+    json["bottleneck"] = FSEQFile::Stats::StageStrings[bottleneck()];
+    json["stages"] = stagesToJson(totals());
+    json["files"] = nlohmann::json::array();
+    for (auto const& file : files) {
+        json["files"].push_back({
+            { "source", file.source },
+            { "destination", file.destination },
+            { "controller", file.controller },
+            { "ok", file.ok },
+            { "frames", file.frames },
+            { "wall_seconds", toSeconds(file.wallNanos) },
+            { "source_bytes", file.sourceBytes },
+            { "output_bytes", file.outputBytes },
+            { "compressed", file.compressed },
+            { "compression_ratio", file.compressionRatio() },
+            { "sparse_ranges", file.sparseRanges },
+            { "padded_channels", file.paddedChannels },
+            { "trimmed_channels", file.trimmedChannels },
+            { "power_limited_frames", file.powerLimitedFrames },
+            { "power_limits", file.powerLimits },
+            { "bottleneck", FSEQFile::Stats::StageStrings[file.bottleneck()] },
+            { "stages", stagesToJson(file.stats) }
+        });
+    }
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << json.dump(4);
+    return out.good();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "FSEQFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ExportFileReport
+{
+    std::string source;
+    std::string destination;
+    std::string controller;
+    bool ok{ false };
+    uint32_t frames{ 0 };
+    uint64_t sourceBytes{ 0 };
+    uint64_t outputBytes{ 0 };
+    //channels per frame times frames, what the file holds before compression
+    uint64_t rawBytes{ 0 };
+    bool compressed{ false };
+    uint64_t wallNanos{ 0 };
+    size_t sparseRanges{ 0 };
+    uint64_t paddedChannels{ 0 };
+    uint64_t trimmedChannels{ 0 };
+    //frames dimmed to stay within a port's supply, and which ports and frames
+    uint32_t powerLimitedFrames{ 0 };
+    std::string powerLimits;
+    FSEQFile::Stats stats;
+
+    //raw frame bytes over file bytes, 1 for uncompressed files
+    [[nodiscard]] double compressionRatio() const;
+    [[nodiscard]] FSEQFile::Stats::Stage bottleneck() const;
+};
+
+//Aggregated timings of one Export / Export All run
+struct ExportRunReport
+{
+    std::vector<ExportFileReport> files;
+    uint64_t wallNanos{ 0 };
+    bool cancelled{ false };
+
+    [[nodiscard]] FSEQFile::Stats totals() const;
+    [[nodiscard]] uint64_t sourceBytes() const;
+    [[nodiscard]] uint64_t outputBytes() const;
+    //uncompressed files count at 1:1
+    [[nodiscard]] double compressionRatio() const;
+    [[nodiscard]] FSEQFile::Stats::Stage bottleneck() const;
+
+    [[nodiscard]] std::string summary() const;
+    [[nodiscard]] std::string details() const;
+    bool writeJson(std::string const& path) const;
+};
@@ -0,0 +1,71 @@
+#include "frame_resampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+FrameResampler::FrameResampler(uint32_t sourceFrames, int sourceStepTime, int stepTime, bool blend, uint32_t frameSize) :
+    m_sourceFrames(sourceFrames),
+    m_sourceStepTime(std::max(1, sourceStepTime)),
+    m_stepTime(std::max(1, stepTime)),
+    m_blend(blend),
+    m_frameSize(frameSize),
+    m_frames(OutputFrames(sourceFrames, sourceStepTime, stepTime))
+{
+    m_buffers[0].resize(frameSize);
+    m_buffers[1].resize(frameSize);
+}
+
+uint32_t FrameResampler::OutputFrames(uint32_t sourceFrames, int sourceStepTime, int stepTime)
+{
+    if (sourceFrames == 0) {
+        return 0;
+    }
+    uint64_t const lengthMS = static_cast<uint64_t>(sourceFrames) * std::max(1, sourceStepTime);
+    uint64_t const step = std::max(1, stepTime);
+    return static_cast<uint32_t>(std::max<uint64_t>(1, (lengthMS + step / 2) / step));
+}
+
+void FrameResampler::Blend(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t count, uint32_t weight)
+{
+    //16 bit lanes are enough, the weights add up to 256 so the sum stays below 65536
+    uint16_t const wb = static_cast<uint16_t>(weight);
+    uint16_t const wa = static_cast<uint16_t>(256 - weight);
+    for (size_t x = 0; x < count; ++x) {
+        out[x] = static_cast<uint8_t>((a[x] * wa + b[x] * wb + 128) >> 8);
+    }
+}
+
+const uint8_t* FrameResampler::source(uint32_t frame, DecodeFrame const& decode)
+{
+    for (int x = 0; x < 2; ++x) {
+        if (m_held[x] == frame) {
+            return m_buffers[x].data();
+        }
+    }
+    //frames only move forward, the lower one is never needed again
+    int slot = 0;
+    if (m_held[0] != UINT32_MAX && (m_held[1] == UINT32_MAX || m_held[1] < m_held[0])) {
+        slot = 1;
+    }
+    decode(frame, m_buffers[slot].data(), m_frameSize);
+    m_held[slot] = frame;
+    return m_buffers[slot].data();
+}
+
+void FrameResampler::frame(uint32_t n, uint8_t* out, DecodeFrame const& decode)
+{
+    uint64_t const ms = static_cast<uint64_t>(n) * m_stepTime;
+    uint64_t first = ms / m_sourceStepTime;
+    uint32_t weight = static_cast<uint32_t>((ms % m_sourceStepTime) * 256 / m_sourceStepTime);
+    if (first + 1 >= m_sourceFrames) {
+        first = m_sourceFrames - 1;
+        weight = 0;
+    }
+    const uint8_t* a = source(static_cast<uint32_t>(first), decode);
+    if (!m_blend || weight == 0) {
+        std::memcpy(out, a, m_frameSize);
+        return;
+    }
+    const uint8_t* b = source(static_cast<uint32_t>(first + 1), decode);
+    Blend(out, a, b, m_frameSize, weight);
+}
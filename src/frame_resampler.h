@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//Plays a sequence back at a different step time. Output frame n shows the source at
+//n * stepTime ms, either the source frame at or before that time (decimation) or a
+//linear blend of the two source frames around it.
+class FrameResampler
+{
+public:
+    //fills data, size bytes long, with the given source frame
+    using DecodeFrame = std::function<void(uint32_t frame, uint8_t* data, uint32_t size)>;
+
+    FrameResampler(uint32_t sourceFrames, int sourceStepTime, int stepTime, bool blend, uint32_t frameSize);
+
+    [[nodiscard]] uint32_t frames() const { return m_frames; }
+    [[nodiscard]] int stepTime() const { return m_stepTime; }
+
+    //writes frameSize bytes of output frame n to out, output frames have to be requested in order
+    void frame(uint32_t n, uint8_t* out, DecodeFrame const& decode);
+
+    //frames needed to cover the same length at stepTime
+    static uint32_t OutputFrames(uint32_t sourceFrames, int sourceStepTime, int stepTime);
+    //out = a + (b - a) * weight / 256, rounded
+    static void Blend(uint8_t* out, const uint8_t* a, const uint8_t* b, size_t count, uint32_t weight);
+
+private:
+    //buffer holding the source frame, decoding it over the older of the two
+    const uint8_t* source(uint32_t frame, DecodeFrame const& decode);
+
+    uint32_t m_sourceFrames{ 0 };
+    int m_sourceStepTime{ 0 };
+    int m_stepTime{ 0 };
+    bool m_blend{ true };
+    uint32_t m_frameSize{ 0 };
+    uint32_t m_frames{ 0 };
+    std::vector<uint8_t> m_buffers[2];
+    uint32_t m_held[2]{ UINT32_MAX, UINT32_MAX };
+};
@@ -0,0 +1,627 @@
+#include "frame_transform.h"
+
+#include "channel_map.h"
+#include "kernel_dispatch.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LUT_TRANSFORM_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define LUT_TRANSFORM_TARGET(x)
+#else
+#define LUT_TRANSFORM_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+bool ChannelCurve::isIdentity() const
+{
+    auto const table = lut();
+    for (int x = 0; x < 256; ++x) {
+        if (table[x] != x) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ChannelLut ChannelCurve::lut() const
+{
+    //the custom curve always runs through 0:0 and 255:255 unless it moves them
+    std::vector<std::pair<uint8_t, uint8_t>> curve = points;
+    std::sort(curve.begin(), curve.end());
+    if (curve.empty() || curve.front().first != 0) {
+        curve.insert(curve.begin(), { 0, 0 });
+    }
+    if (curve.back().first != 255) {
+        curve.emplace_back(255, 255);
+    }
+
+    double const scale = std::clamp(brightness, 0, 100) / 100.0;
+    double const power = gamma > 0.0 ? gamma : 1.0;
+    ChannelLut table{};
+    size_t segment = 0;
+    for (int x = 0; x < 256; ++x) {
+        double const level = std::pow(x / 255.0, power) * scale * 255.0;
+        int const in = static_cast<int>(std::lround(level));
+        while (segment + 2 < curve.size() && curve[segment + 1].first <= in) {
+            ++segment;
+        }
+        //levels only grow with x, so segment never has to move back
+        auto const [x0, y0] = curve[segment];
+        auto const [x1, y1] = curve[segment + 1];
+        double out = y1;
+        if (x1 > x0) {
+            out = y0 + (static_cast<double>(y1) - y0) * (std::clamp(in, static_cast<int>(x0), static_cast<int>(x1)) - x0) / (x1 - x0);
+        }
+        table[x] = static_cast<uint8_t>(std::clamp(std::lround(out), 0L, 255L));
+    }
+    return table;
+}
+
+bool ParseCurvePoints(std::string const& text, std::vector<std::pair<uint8_t, uint8_t>>& points)
+{
+    std::vector<std::pair<uint8_t, uint8_t>> parsed;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::erase_if(item, [](char c) { return c == ' ' || c == '\t'; });
+        if (item.empty()) {
+            continue;
+        }
+        unsigned input{ 0 };
+        unsigned output{ 0 };
+        char const* const last = item.data() + item.size();
+        auto [ptr, ec] = std::from_chars(item.data(), last, input);
+        if (ec != std::errc() || ptr == last || *ptr != ':' || input > 255) {
+            return false;
+        }
+        auto [endPtr, endEc] = std::from_chars(ptr + 1, last, output);
+        if (endEc != std::errc() || endPtr != last || output > 255) {
+            return false;
+        }
+        parsed.emplace_back(static_cast<uint8_t>(input), static_cast<uint8_t>(output));
+    }
+    std::stable_sort(parsed.begin(), parsed.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+    //one output per input, the last one given wins
+    auto const dupes = std::unique(parsed.rbegin(), parsed.rend(), [](auto const& a, auto const& b) { return a.first == b.first; });
+    parsed.erase(parsed.begin(), dupes.base());
+    points = std::move(parsed);
+    return true;
+}
+
+std::string FormatCurvePoints(std::vector<std::pair<uint8_t, uint8_t>> const& points)
+{
+    std::ostringstream out;
+    for (size_t x = 0; x < points.size(); ++x) {
+        if (x != 0) {
+            out << ", ";
+        }
+        out << static_cast<int>(points[x].first) << ":" << static_cast<int>(points[x].second);
+    }
+    return out.str();
+}
+
+unsigned ParseColorOrder(std::string_view text, std::array<uint8_t, 4>& order)
+{
+    constexpr std::string_view channels = "RGBW";
+    if (text.size() != 3 && text.size() != 4) {
+        return 0;
+    }
+    std::array<uint8_t, 4> parsed{ 0, 1, 2, 3 };
+    unsigned used{ 0 };
+    for (size_t x = 0; x < text.size(); ++x) {
+        size_t const index = channels.find(static_cast<char>(text[x] & ~0x20));
+        //each color once, and W only in 4 byte pixels
+        if (index == std::string_view::npos || index >= text.size() || (used & (1u << index)) != 0) {
+            return 0;
+        }
+        used |= 1u << index;
+        parsed[x] = static_cast<uint8_t>(index);
+    }
+    order = parsed;
+    return static_cast<unsigned>(text.size());
+}
+
+void FrameTransform::add(uint32_t start, uint32_t count, ChannelLut const& lut)
+{
+    if (count == 0) {
+        return;
+    }
+    auto found = std::find(m_luts.begin(), m_luts.end(), lut);
+    if (found == m_luts.end()) {
+        found = m_luts.insert(m_luts.end(), lut);
+    }
+    size_t const index = found - m_luts.begin();
+    //sparse ranges are often back to back ports, one longer run vectorizes better
+    if (!m_ranges.empty() && m_ranges.back().lut == index && m_ranges.back().start + m_ranges.back().count == start) {
+        m_ranges.back().count += count;
+        return;
+    }
+    m_ranges.push_back({ start, count, index });
+}
+
+void FrameTransform::add(std::vector<std::pair<uint32_t, uint32_t>> const& ranges, ChannelCurve const& curve)
+{
+    if (curve.isIdentity()) {
+        return;
+    }
+    //targets often share channels, each one may only go through the table once
+    auto sorted = ranges;
+    std::sort(sorted.begin(), sorted.end());
+    auto const lut = curve.lut();
+    uint64_t start{ 0 };
+    uint64_t end{ 0 };
+    for (auto const& [from, count] : sorted) {
+        if (from > end) {
+            add(static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), lut);
+            start = from;
+        }
+        end = std::max<uint64_t>(end, static_cast<uint64_t>(from) + count);
+    }
+    add(static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), lut);
+}
+
+bool FrameTransform::addColorOrder(uint32_t start, uint32_t count, std::string_view order)
+{
+    std::array<uint8_t, 4> parsed;
+    unsigned const width = ParseColorOrder(order, parsed);
+    if (width == 0) {
+        return false;
+    }
+    //RGB and RGBW are what the sequence already holds
+    if (parsed != std::array<uint8_t, 4>{ 0, 1, 2, 3 } && count >= width) {
+        m_orders.push_back({ start, count, PixelShuffle::MakeControl(parsed, width) });
+    }
+    return true;
+}
+
+void FrameTransform::setChannelMap(std::shared_ptr<const GatherPlan> plan)
+{
+    m_map = plan && !plan->empty() ? std::move(plan) : nullptr;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> FrameTransform::sourceRanges(std::vector<std::pair<uint32_t, uint32_t>> ranges) const
+{
+    if (!m_map || ranges.empty()) {
+        return ranges;
+    }
+    ranges.insert(ranges.end(), m_map->sourceRanges().begin(), m_map->sourceRanges().end());
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<uint32_t, uint32_t>> merged;
+    for (auto const& [start, count] : ranges) {
+        if (!merged.empty() && start <= merged.back().first + merged.back().second) {
+            merged.back().second = std::max(merged.back().second, start + count - merged.back().first);
+        } else if (count != 0) {
+            merged.emplace_back(start, count);
+        }
+    }
+    return merged;
+}
+
+uint32_t FrameTransform::extent() const
+{
+    return m_map ? m_map->extent() : 0;
+}
+
+void FrameTransform::apply(uint8_t* frame, uint32_t size) const
+{
+    if (m_map) {
+        m_map->apply(frame, size);
+    }
+    for (auto const& range : m_ranges) {
+        if (range.start >= size) {
+            continue;
+        }
+        LutTransform::Apply(frame + range.start, std::min(range.count, size - range.start), m_luts[range.lut]);
+    }
+    for (auto const& order : m_orders) {
+        if (order.start >= size) {
+            continue;
+        }
+        PixelShuffle::Apply(frame + order.start, std::min(order.count, size - order.start), order.control);
+    }
+}
+
+namespace LutTransform
+{
+    namespace
+    {
+        using ApplyFn = void (*)(uint8_t*, size_t, const uint8_t*);
+
+        void applyScalar(uint8_t* data, size_t count, const uint8_t* lut)
+        {
+            for (size_t x = 0; x < count; ++x) {
+                data[x] = lut[data[x]];
+            }
+        }
+
+#if defined(LUT_TRANSFORM_X86)
+        //pshufb only indexes 16 entries, so the table is split in 16 rows. Subtracting
+        //16 per row moves the wanted row into 0-15, adding 0x70 with saturation then
+        //leaves those below 0x80 and pushes every other value to 0x80 and up, which
+        //pshufb turns into 0. Or'ing the 16 lookups together gives the result.
+        LUT_TRANSFORM_TARGET("ssse3")
+        void applySSSE3(uint8_t* data, size_t count, const uint8_t* lut)
+        {
+            if (count < 16) {
+                applyScalar(data, count, lut);
+                return;
+            }
+            __m128i rows[16];
+            for (int r = 0; r < 16; ++r) {
+                rows[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut + r * 16));
+            }
+            __m128i const bias = _mm_set1_epi8(0x70);
+            __m128i const step = _mm_set1_epi8(16);
+            size_t x = 0;
+            for (; x + 16 <= count; x += 16) {
+                __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x));
+                __m128i result = _mm_shuffle_epi8(rows[0], _mm_adds_epu8(index, bias));
+                for (int r = 1; r < 16; ++r) {
+                    index = _mm_sub_epi8(index, step);
+                    result = _mm_or_si128(result, _mm_shuffle_epi8(rows[r], _mm_adds_epu8(index, bias)));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(data + x), result);
+            }
+            //in place, so the tail can't overlap the last block the way the copies do
+            applyScalar(data + x, count - x, lut);
+        }
+
+        LUT_TRANSFORM_TARGET("avx2")
+        void applyAVX2(uint8_t* data, size_t count, const uint8_t* lut)
+        {
+            //no SSSE3 kernel for short ranges or the tail, switching from AVX to
+            //legacy SSE code costs more than the lookups it would save
+            if (count < 32) {
+                applyScalar(data, count, lut);
+                return;
+            }
+            //vpshufb looks up within each 128 bit lane, both lanes get the same row
+            __m256i rows[16];
+            for (int r = 0; r < 16; ++r) {
+                rows[r] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lut + r * 16)));
+            }
+            __m256i const bias = _mm256_set1_epi8(0x70);
+            __m256i const step = _mm256_set1_epi8(16);
+            size_t x = 0;
+            for (; x + 32 <= count; x += 32) {
+                __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + x));
+                __m256i result = _mm256_shuffle_epi8(rows[0], _mm256_adds_epu8(index, bias));
+                for (int r = 1; r < 16; ++r) {
+                    index = _mm256_sub_epi8(index, step);
+                    result = _mm256_or_si256(result, _mm256_shuffle_epi8(rows[r], _mm256_adds_epu8(index, bias)));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + x), result);
+            }
+            applyScalar(data + x, count - x, lut);
+        }
+
+        LUT_TRANSFORM_TARGET("avx512f,avx512bw,avx512vbmi")
+        inline __m512i lookupAVX512(__m512i index, __m512i t0, __m512i t1, __m512i t2, __m512i t3)
+        {
+            //vpermi2b indexes 128 entries across two registers, the top bit picks the half
+            __m512i const low = _mm512_permutex2var_epi8(t0, index, t1);
+            __m512i const high = _mm512_permutex2var_epi8(t2, index, t3);
+            return _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), low, high);
+        }
+
+        LUT_TRANSFORM_TARGET("avx512f,avx512bw,avx512vbmi")
+        void applyAVX512(uint8_t* data, size_t count, const uint8_t* lut)
+        {
+            //loading the table costs more than looking up a single RGB node
+            if (count < 16) {
+                applyScalar(data, count, lut);
+                return;
+            }
+            __m512i const t0 = _mm512_loadu_si512(lut);
+            __m512i const t1 = _mm512_loadu_si512(lut + 64);
+            __m512i const t2 = _mm512_loadu_si512(lut + 128);
+            __m512i const t3 = _mm512_loadu_si512(lut + 192);
+            size_t x = 0;
+            for (; x + 64 <= count; x += 64) {
+                _mm512_storeu_si512(data + x, lookupAVX512(_mm512_loadu_si512(data + x), t0, t1, t2, t3));
+            }
+            if (x < count) {
+                __mmask64 const mask = ~0ULL >> (64 - (count - x));
+                _mm512_mask_storeu_epi8(data + x, mask, lookupAVX512(_mm512_maskz_loadu_epi8(mask, data + x), t0, t1, t2, t3));
+            }
+        }
+
+        bool cpuHas(Kernel kernel)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            int const maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool const ssse3 = (info[2] & (1 << 9)) != 0;
+            bool const osxsave = (info[2] & (1 << 27)) != 0;
+            if (kernel == Kernel::SSSE3) {
+                return ssse3;
+            }
+            if (!osxsave || maxLeaf < 7) {
+                return false;
+            }
+            unsigned long long const xcr0 = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            if (kernel == Kernel::AVX2) {
+                return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+            }
+            //AVX512F, AVX512BW and VBMI, with the opmask and upper ZMM state enabled by the OS
+            return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0 && (info[2] & (1 << 1)) != 0;
+#else
+            __builtin_cpu_init();
+            switch (kernel) {
+            case Kernel::SSSE3:
+                return __builtin_cpu_supports("ssse3");
+            case Kernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case Kernel::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi");
+            default:
+                return false;
+            }
+#endif
+        }
+#endif
+
+        ApplyFn kernelFor(Kernel kernel)
+        {
+            switch (kernel) {
+#if defined(LUT_TRANSFORM_X86)
+            case Kernel::SSSE3:
+                return applySSSE3;
+            case Kernel::AVX2:
+                return applyAVX2;
+            case Kernel::AVX512:
+                return applyAVX512;
+#endif
+            default:
+                return applyScalar;
+            }
+        }
+
+        KernelDispatch<Kernel, ApplyFn>& dispatch()
+        {
+            //FSEQ_LUT_KERNEL=scalar|ssse3|avx2|avx512 pins a kernel for comparisons. The pshufb kernels
+            //need 4 instructions per 16 table entries and only match a scalar table load, they stay
+            //around for --bench-ranges on other CPUs
+            static KernelDispatch<Kernel, ApplyFn> d("FSEQ_LUT_KERNEL", { Kernel::AVX512 }, KernelName, IsSupported, kernelFor);
+            return d;
+        }
+    }
+
+    void Apply(uint8_t* data, size_t count, ChannelLut const& lut)
+    {
+        dispatch().fn()(data, count, lut.data());
+    }
+
+    Kernel ActiveKernel()
+    {
+        return dispatch().active();
+    }
+
+    const char* KernelName(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::SSSE3:
+            return "ssse3";
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::AVX512:
+            return "avx512";
+        default:
+            return "unknown";
+        }
+    }
+
+    bool IsSupported(Kernel kernel)
+    {
+        if (kernel == Kernel::Scalar) {
+            return true;
+        }
+#if defined(LUT_TRANSFORM_X86)
+        return cpuHas(kernel);
+#else
+        return false;
+#endif
+    }
+
+    bool SetKernel(Kernel kernel)
+    {
+        return dispatch().set(kernel);
+    }
+}
+
+namespace PixelShuffle
+{
+    namespace
+    {
+        using ApplyFn = void (*)(uint8_t*, size_t, Control const&);
+
+        template<unsigned Width>
+        void reorderScalar(uint8_t* data, size_t count, const uint8_t* order)
+        {
+            uint8_t pixel[Width];
+            for (size_t x = 0; x + Width <= count; x += Width) {
+                memcpy(pixel, data + x, Width);
+                for (unsigned c = 0; c < Width; ++c) {
+                    data[x + c] = pixel[order[c]];
+                }
+            }
+        }
+
+        void applyScalar(uint8_t* data, size_t count, Control const& control)
+        {
+            if (control.width == 3) {
+                reorderScalar<3>(data, count, control.order.data());
+            } else {
+                reorderScalar<4>(data, count, control.order.data());
+            }
+        }
+
+#if defined(LUT_TRANSFORM_X86)
+        LUT_TRANSFORM_TARGET("ssse3")
+        void applySSSE3(uint8_t* data, size_t count, Control const& control)
+        {
+            //RGB moves 15 bytes a step, the 16th byte is stored back unchanged and
+            //shuffled as the first byte of the next step. Each step is loaded before
+            //the previous one is stored, reloading a just stored byte stalls forwarding.
+            size_t const whole = count / control.width * control.width;
+            if (whole < 16) {
+                applyScalar(data, whole, control);
+                return;
+            }
+            size_t const advance = 16 / control.width * control.width;
+            __m128i const step = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control.step16.data()));
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            size_t x = 0;
+            for (; x + advance + 16 <= whole; x += advance) {
+                __m128i const next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x + advance));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(data + x), _mm_shuffle_epi8(pixels, step));
+                pixels = next;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + x), _mm_shuffle_epi8(pixels, step));
+            x += advance;
+            applyScalar(data + x, whole - x, control);
+        }
+
+        //two steps, one per lane
+        LUT_TRANSFORM_TARGET("avx2")
+        inline __m256i loadStepsAVX2(const uint8_t* data, size_t advance)
+        {
+            __m128i const low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            __m128i const high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + advance));
+            return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+
+        LUT_TRANSFORM_TARGET("avx2")
+        inline void storeStepsAVX2(uint8_t* data, size_t advance, __m256i pixels)
+        {
+            //low first, for RGB its last byte is the unshuffled first byte of the high lane
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm256_castsi256_si128(pixels));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + advance), _mm256_extracti128_si256(pixels, 1));
+        }
+
+        LUT_TRANSFORM_TARGET("avx2")
+        void applyAVX2(uint8_t* data, size_t count, Control const& control)
+        {
+            //vpshufb stays within 128 bit lanes, each lane holds the same 15 or 16 byte step
+            size_t const whole = count / control.width * control.width;
+            size_t const advance = 16 / control.width * control.width;
+            __m128i const step = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control.step16.data()));
+            size_t x = 0;
+            if (whole >= advance + 16) {
+                __m256i const steps = _mm256_broadcastsi128_si256(step);
+                __m256i pixels = loadStepsAVX2(data, advance);
+                for (; x + 3 * advance + 16 <= whole; x += 2 * advance) {
+                    __m256i const next = loadStepsAVX2(data + x + 2 * advance, advance);
+                    storeStepsAVX2(data + x, advance, _mm256_shuffle_epi8(pixels, steps));
+                    pixels = next;
+                }
+                storeStepsAVX2(data + x, advance, _mm256_shuffle_epi8(pixels, steps));
+                x += 2 * advance;
+            }
+            //the last step stays VEX encoded here, calling the SSSE3 kernel would
+            //pay for switching between AVX and legacy SSE state on every port
+            for (; x + 16 <= whole; x += advance) {
+                __m128i const pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(data + x), _mm_shuffle_epi8(pixels, step));
+            }
+            applyScalar(data + x, whole - x, control);
+        }
+
+        LUT_TRANSFORM_TARGET("avx512f,avx512bw,avx512vbmi")
+        void applyAVX512(uint8_t* data, size_t count, Control const& control)
+        {
+            //21 RGB or 16 RGBW pixels per step, overlapping and loading ahead the same
+            //way as the pshufb kernels keeps the loop on plain moves, only the tail is masked
+            size_t const whole = count / control.width * control.width;
+            size_t const advance = 64 / control.width * control.width;
+            __m512i const step = _mm512_loadu_si512(control.step64.data());
+            size_t x = 0;
+            if (whole >= 64) {
+                __m512i pixels = _mm512_loadu_si512(data);
+                for (; x + advance + 64 <= whole; x += advance) {
+                    __m512i const next = _mm512_loadu_si512(data + x + advance);
+                    _mm512_storeu_si512(data + x, _mm512_permutexvar_epi8(step, pixels));
+                    pixels = next;
+                }
+                _mm512_storeu_si512(data + x, _mm512_permutexvar_epi8(step, pixels));
+                x += advance;
+            }
+            if (x < whole) {
+                __mmask64 const tail = ~0ULL >> (64 - (whole - x));
+                __m512i const pixels = _mm512_maskz_loadu_epi8(tail, data + x);
+                _mm512_mask_storeu_epi8(data + x, tail, _mm512_permutexvar_epi8(step, pixels));
+            }
+        }
+#endif
+
+        ApplyFn kernelFor(Kernel kernel)
+        {
+            switch (kernel) {
+#if defined(LUT_TRANSFORM_X86)
+            case Kernel::SSSE3:
+                return applySSSE3;
+            case Kernel::AVX2:
+                return applyAVX2;
+            case Kernel::AVX512:
+                return applyAVX512;
+#endif
+            default:
+                return applyScalar;
+            }
+        }
+
+        KernelDispatch<Kernel, ApplyFn>& dispatch()
+        {
+            //FSEQ_SHUFFLE_KERNEL=scalar|ssse3|avx2|avx512 pins a kernel for comparisons
+            static KernelDispatch<Kernel, ApplyFn> d("FSEQ_SHUFFLE_KERNEL", { Kernel::AVX512, Kernel::AVX2, Kernel::SSSE3 },
+                LutTransform::KernelName, LutTransform::IsSupported, kernelFor);
+            return d;
+        }
+    }
+
+    Control MakeControl(std::array<uint8_t, 4> const& order, unsigned width)
+    {
+        Control control;
+        control.width = width;
+        control.order = order;
+        auto const fill = [&order, width](uint8_t* step, size_t size) {
+            size_t const whole = size / width * width;
+            for (size_t x = 0; x < size; ++x) {
+                step[x] = static_cast<uint8_t>(x < whole ? x - x % width + order[x % width] : x);
+            }
+        };
+        fill(control.step16.data(), control.step16.size());
+        fill(control.step64.data(), control.step64.size());
+        return control;
+    }
+
+    void Apply(uint8_t* data, size_t count, Control const& control)
+    {
+        dispatch().fn()(data, count, control);
+    }
+
+    Kernel ActiveKernel()
+    {
+        return dispatch().active();
+    }
+
+    bool SetKernel(Kernel kernel)
+    {
+        return dispatch().set(kernel);
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//out = lut[in] for every channel value
+using ChannelLut = std::array<uint8_t, 256>;
+
+//Brightness and gamma for channels whose controller can't do it itself. The custom
+//curve is applied last, on top of the brightness and gamma.
+struct ChannelCurve
+{
+    //percent of full output, 100 leaves the values alone
+    int brightness{ 100 };
+    //out = in^gamma, 1.0 leaves the values alone
+    double gamma{ 1.0 };
+    //input, output control points, linear in between, empty for none
+    std::vector<std::pair<uint8_t, uint8_t>> points;
+
+    [[nodiscard]] bool isIdentity() const;
+    [[nodiscard]] ChannelLut lut() const;
+};
+
+//"0:0, 128:64, 255:200", false on malformed input
+bool ParseCurvePoints(std::string const& text, std::vector<std::pair<uint8_t, uint8_t>>& points);
+std::string FormatCurvePoints(std::vector<std::pair<uint8_t, uint8_t>> const& points);
+
+//source byte of each output byte for a color order the way controllers name it, "GRB",
+//"BRG", "WRGB"... Sequences hold RGB or RGBW, returns the pixel width or 0 for bad text
+unsigned ParseColorOrder(std::string_view text, std::array<uint8_t, 4>& order);
+
+//256 entry table lookups over a buffer, the widest kernel the CPU supports is picked
+//on first use. The SIMD kernels look up 16 entries at a time with pshufb, AVX-512
+//VBMI looks up 128 at a time with vpermi2b.
+namespace LutTransform
+{
+    enum class Kernel
+    {
+        Scalar,
+        SSSE3,
+        AVX2,
+        AVX512,
+        Count
+    };
+
+    //data[x] = lut[data[x]]
+    void Apply(uint8_t* data, size_t count, ChannelLut const& lut);
+
+    Kernel ActiveKernel();
+    const char* KernelName(Kernel kernel);
+    bool IsSupported(Kernel kernel);
+    //for benchmarks, false when the CPU can't run it
+    bool SetKernel(Kernel kernel);
+}
+
+//Reorders the bytes of every whole 3 or 4 byte pixel in a buffer. pshufb handles 5 RGB
+//or 4 RGBW pixels per 16 bytes, AVX-512 VBMI vpermb 21 or 16 per 64 bytes.
+namespace PixelShuffle
+{
+    using LutTransform::Kernel;
+
+    //byte moves of one color order, built once and reused for every frame
+    struct Control
+    {
+        unsigned width{ 3 };
+        //output byte i of each pixel is input byte order[i]
+        std::array<uint8_t, 4> order{ 0, 1, 2, 3 };
+        //pshufb and vpermb controls, bytes past the last whole pixel stay put
+        std::array<uint8_t, 16> step16{};
+        std::array<uint8_t, 64> step64{};
+    };
+
+    //width is 3 or 4
+    Control MakeControl(std::array<uint8_t, 4> const& order, unsigned width);
+    void Apply(uint8_t* data, size_t count, Control const& control);
+
+    Kernel ActiveKernel();
+    //for benchmarks, false when the CPU can't run it
+    bool SetKernel(Kernel kernel);
+}
+
+class GatherPlan;
+
+//Per range lookup tables applied in place to a decoded frame before it is written
+class FrameTransform
+{
+public:
+    //channels are routed through the plan before the tables and color orders
+    void setChannelMap(std::shared_ptr<const GatherPlan> plan);
+    //0-based channel range, where ranges overlap the tables apply in the order they were added
+    void add(uint32_t start, uint32_t count, ChannelLut const& lut);
+    //channels in more than one of the ranges still go through the curve once
+    void add(std::vector<std::pair<uint32_t, uint32_t>> const& ranges, ChannelCurve const& curve);
+    //pixels of the range are sent in another color order after the tables, false for bad text
+    bool addColorOrder(uint32_t start, uint32_t count, std::string_view order);
+
+    [[nodiscard]] bool empty() const { return m_ranges.empty() && m_orders.empty() && !m_map; }
+    //ranges plus the channels the channel map reads them from, sorted and merged
+    [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> sourceRanges(std::vector<std::pair<uint32_t, uint32_t>> ranges) const;
+    //frame bytes the channel map reads or writes, 0 without one
+    [[nodiscard]] uint32_t extent() const;
+    //frame is size bytes long, ranges past the end are clipped
+    void apply(uint8_t* frame, uint32_t size) const;
+
+private:
+    struct Range
+    {
+        uint32_t start;
+        uint32_t count;
+        size_t lut;
+    };
+
+    struct Order
+    {
+        uint32_t start;
+        uint32_t count;
+        PixelShuffle::Control control;
+    };
+
+    std::vector<ChannelLut> m_luts;
+    std::vector<Range> m_ranges;
+    std::vector<Order> m_orders;
+    std::shared_ptr<const GatherPlan> m_map;
+};
@@ -0,0 +1,123 @@
+#include "fseq_header_reader.h"
+
+#include "FSEQFile.h"
+
+#include <QMetaObject>
+#include <QTimer>
+
+#include <memory>
+#include <utility>
+
+FSEQHeaderReader::FSEQHeaderReader(QObject* parent) :
+    QObject(parent)
+{
+    //header reads are I/O bound, a single reader keeps network shares from thrashing
+    m_pool.setMaxThreadCount(1);
+    m_batchTimer = new QTimer(this);
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(100);
+    connect(m_batchTimer, &QTimer::timeout, this, &FSEQHeaderReader::headersRead);
+}
+
+FSEQHeaderReader::~FSEQHeaderReader()
+{
+    m_stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_queue.clear();
+    }
+    m_pool.waitForDone();
+}
+
+void FSEQHeaderReader::reset()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    ++m_generation;
+    m_queue.clear();
+    m_results.clear();
+    m_requested.clear();
+}
+
+void FSEQHeaderReader::request(int row, QString const& path)
+{
+    if (row >= static_cast<int>(m_requested.size())) {
+        m_requested.resize(row + 1, false);
+    }
+    if (m_requested[row]) {
+        return;
+    }
+    m_requested[row] = true;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_queue.push_back({ m_generation, row, path });
+    if (!m_running) {
+        m_running = true;
+        m_pool.start([this]() { readHeaders(); });
+    }
+}
+
+std::vector<FSEQHeaderReader::Result> FSEQHeaderReader::takeResults()
+{
+    std::vector<GenerationResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        results.swap(m_results);
+        m_batchPending = false;
+    }
+    std::vector<Result> current;
+    current.reserve(results.size());
+    for (auto& [generation, result] : results) {
+        if (generation == m_generation) {
+            current.push_back(std::move(result));
+        }
+    }
+    return current;
+}
+
+void FSEQHeaderReader::readHeaders()
+{
+    while (!m_stopping) {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_queue.empty()) {
+                m_running = false;
+                return;
+            }
+            //newest requests are the rows currently on screen
+            request = std::move(m_queue.back());
+            m_queue.pop_back();
+        }
+        if (request.generation != m_generation) {
+            continue;
+        }
+
+        FSEQHeaderInfo info;
+        info.loaded = true;
+        std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(request.path.toStdString()));
+        if (src) {
+            info.valid = true;
+            info.versionMajor = src->getVersionMajor();
+            info.versionMinor = src->getVersionMinor();
+            info.channels = static_cast<uint32_t>(src->getChannelCount());
+            info.frames = static_cast<uint32_t>(src->getNumFrames());
+            info.stepTime = src->getStepTime();
+            if (src->getVersionMajor() == 2) {
+                info.compression = static_cast<V2FSEQFile*>(src.get())->CompressionTypeString().c_str();
+            } else {
+                info.compression = FSEQFile::CompressionTypeStrings[FSEQFile::CompressionType::none];
+            }
+        }
+        bool startTimer{ false };
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_results.push_back({ request.generation, { request.row, std::move(info) } });
+            startTimer = !std::exchange(m_batchPending, true);
+        }
+        if (startTimer) {
+            QMetaObject::invokeMethod(m_batchTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_running = false;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+class QTimer;
+
+struct FSEQHeaderInfo
+{
+    bool loaded{ false };
+    bool valid{ false };
+    int versionMajor{ 0 };
+    int versionMinor{ 0 };
+    uint32_t channels{ 0 };
+    uint32_t frames{ 0 };
+    int stepTime{ 0 };
+    QString compression;
+};
+
+//Reads the headers of the FSEQ listing on a background thread, newest requests first.
+//Each row is read once until reset, results are handed out in batches.
+class FSEQHeaderReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        int row;
+        FSEQHeaderInfo info;
+    };
+
+    explicit FSEQHeaderReader(QObject* parent = nullptr);
+    ~FSEQHeaderReader();
+
+    //forgets the queue, the results and which rows were asked for
+    void reset();
+    //queues the row unless it was asked for since the last reset
+    void request(int row, QString const& path);
+    //headers read since the last call, rows from before a reset are dropped
+    [[nodiscard]] std::vector<Result> takeResults();
+
+signals:
+    //at most every 100 ms, each dataChanged re-sorts a proxy sorted on a header column
+    void headersRead();
+
+private:
+    struct Request
+    {
+        uint64_t generation;
+        int row;
+        QString path;
+    };
+
+    struct GenerationResult
+    {
+        uint64_t generation;
+        Result result;
+    };
+
+    void readHeaders();
+
+    //rows whose header is read or waiting to be
+    std::vector<bool> m_requested;
+    QTimer* m_batchTimer{ nullptr };
+
+    //shared with the worker thread
+    std::mutex m_lock;
+    std::deque<Request> m_queue;
+    std::vector<GenerationResult> m_results;
+    bool m_running{ false };
+    bool m_batchPending{ false };
+    std::atomic<uint64_t> m_generation{ 0 };
+    std::atomic<bool> m_stopping{ false };
+    QThreadPool m_pool;
+};
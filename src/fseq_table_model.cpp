@@ -0,0 +1,211 @@
+#include "fseq_table_model.h"
+
+#include <algorithm>
+#include <utility>
+
+FSEQTableModel::FSEQTableModel(QObject* parent) :
+    QAbstractTableModel(parent)
+{
+    m_reader = new FSEQHeaderReader(this);
+    connect(m_reader, &FSEQHeaderReader::headersRead, this, &FSEQTableModel::applyHeaders);
+}
+
+void FSEQTableModel::setFiles(QFileInfoList const& files)
+{
+    beginResetModel();
+    m_reader->reset();
+    m_entries.clear();
+    endResetModel();
+    appendFiles(files);
+}
+
+void FSEQTableModel::appendFiles(QFileInfoList const& files)
+{
+    if (files.isEmpty()) {
+        return;
+    }
+    int const first = static_cast<int>(m_entries.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(files.size()) - 1);
+    m_entries.reserve(m_entries.size() + files.size());
+    for (QFileInfo const& fileInfo : files) {
+        FSEQEntry entry;
+        entry.path = fileInfo.absoluteFilePath();
+        entry.fileName = fileInfo.fileName();
+        entry.modified = fileInfo.lastModified();
+        entry.size = fileInfo.size();
+        m_entries.push_back(std::move(entry));
+    }
+    endInsertRows();
+}
+
+void FSEQTableModel::clear()
+{
+    setFiles(QFileInfoList());
+}
+
+int FSEQTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return static_cast<int>(m_entries.size());
+}
+
+int FSEQTableModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return std::to_underlying(FSEQColumn::Count);
+}
+
+QVariant FSEQTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_entries.size())) {
+        return QVariant();
+    }
+    auto const& entry = m_entries[index.row()];
+    auto const column = static_cast<FSEQColumn>(index.column());
+
+    if (role == Qt::CheckStateRole && column == FSEQColumn::Enabled) {
+        return entry.checked ? Qt::Checked : Qt::Unchecked;
+    }
+    if (role == Qt::ToolTipRole && column == FSEQColumn::FileName) {
+        return entry.path;
+    }
+    if (role != Qt::DisplayRole && role != SortRole) {
+        return QVariant();
+    }
+
+    switch (column) {
+    case FSEQColumn::Enabled:
+        return role == SortRole ? QVariant(entry.checked) : QVariant();
+    case FSEQColumn::FileName:
+        return entry.fileName;
+    case FSEQColumn::DataModified:
+        if (role == SortRole) {
+            return entry.modified;
+        }
+        return entry.modified.toString(Qt::ISODate);
+    case FSEQColumn::Size:
+        if (role == SortRole) {
+            return entry.size;
+        }
+        return QString("%1 MB").arg(entry.size / (1024.0 * 1024.0), 0, 'f', 1);
+    default:
+        break;
+    }
+
+    //everything else comes from the file header
+    if (!entry.header.loaded) {
+        m_reader->request(index.row(), entry.path);
+        return QVariant();
+    }
+    if (!entry.header.valid) {
+        return role == SortRole ? QVariant() : QVariant("Invalid");
+    }
+    switch (column) {
+    case FSEQColumn::Version:
+        if (role == SortRole) {
+            return entry.header.versionMajor * 100 + entry.header.versionMinor;
+        }
+        return QString("%1.%2").arg(entry.header.versionMajor).arg(entry.header.versionMinor);
+    case FSEQColumn::Channels:
+        return entry.header.channels;
+    case FSEQColumn::Frames:
+        return entry.header.frames;
+    case FSEQColumn::Duration:
+    {
+        uint64_t const totalMS = static_cast<uint64_t>(entry.header.frames) * entry.header.stepTime;
+        if (role == SortRole) {
+            return static_cast<qulonglong>(totalMS);
+        }
+        return QString("%1:%2").arg(totalMS / 60000).arg((totalMS / 1000) % 60, 2, 10, QChar('0'));
+    }
+    case FSEQColumn::Compression:
+        return entry.header.compression;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+bool FSEQTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || role != Qt::CheckStateRole || static_cast<FSEQColumn>(index.column()) != FSEQColumn::Enabled) {
+        return false;
+    }
+    m_entries[index.row()].checked = value.toInt() == Qt::Checked;
+    emit dataChanged(index, index, { Qt::CheckStateRole });
+    return true;
+}
+
+QVariant FSEQTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (static_cast<FSEQColumn>(section)) {
+    case FSEQColumn::Enabled:
+        return "Select";
+    case FSEQColumn::FileName:
+        return "FSEQ";
+    case FSEQColumn::DataModified:
+        return "Date Modified";
+    case FSEQColumn::Version:
+        return "Version";
+    case FSEQColumn::Channels:
+        return "Channels";
+    case FSEQColumn::Frames:
+        return "Frames";
+    case FSEQColumn::Duration:
+        return "Duration";
+    case FSEQColumn::Compression:
+        return "Compression";
+    case FSEQColumn::Size:
+        return "Size";
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags FSEQTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    if (static_cast<FSEQColumn>(index.column()) == FSEQColumn::Enabled) {
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void FSEQTableModel::setAllChecked(bool checked)
+{
+    if (m_entries.empty()) {
+        return;
+    }
+    for (auto& entry : m_entries) {
+        entry.checked = checked;
+    }
+    emit dataChanged(index(0, std::to_underlying(FSEQColumn::Enabled)),
+        index(static_cast<int>(m_entries.size()) - 1, std::to_underlying(FSEQColumn::Enabled)), { Qt::CheckStateRole });
+}
+
+void FSEQTableModel::applyHeaders()
+{
+    int first = static_cast<int>(m_entries.size());
+    int last = -1;
+    for (auto& result : m_reader->takeResults()) {
+        if (result.row >= static_cast<int>(m_entries.size())) {
+            continue;
+        }
+        m_entries[result.row].header = std::move(result.info);
+        first = std::min(first, result.row);
+        last = std::max(last, result.row);
+    }
+    if (last >= first) {
+        emit dataChanged(index(first, std::to_underlying(FSEQColumn::Version)), index(last, std::to_underlying(FSEQColumn::Compression)));
+    }
+}
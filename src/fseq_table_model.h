@@ -0,0 +1,55 @@
+#pragma once
+
+#include "fseq_header_reader.h"
+
+#include <QAbstractTableModel>
+#include <QDateTime>
+#include <QFileInfoList>
+
+#include <vector>
+
+enum class FSEQColumn : int { Enabled = 0, FileName, DataModified, Version, Channels, Frames, Duration, Compression, Size, Count };
+
+struct FSEQEntry
+{
+    QString path;
+    QString fileName;
+    QDateTime modified;
+    qint64 size{ 0 };
+    bool checked{ true };
+    FSEQHeaderInfo header;
+};
+
+//Table model for the FSEQ folder listing. Rows are cheap, the per file header
+//metadata is only read when a row is first displayed, on a background thread.
+class FSEQTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int SortRole = Qt::UserRole + 1;
+
+    explicit FSEQTableModel(QObject* parent = nullptr);
+
+    void setFiles(QFileInfoList const& files);
+    void appendFiles(QFileInfoList const& files);
+    void clear();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    [[nodiscard]] FSEQEntry const& entry(int row) const { return m_entries[row]; }
+    void setAllChecked(bool checked);
+
+private:
+    void applyHeaders();
+
+    std::vector<FSEQEntry> m_entries;
+    //data() asks for every row it shows without a header, owned by pointer so the const
+    //data() can queue rows without the model's own state changing
+    FSEQHeaderReader* m_reader{ nullptr };
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <initializer_list>
+#include <string_view>
+
+//The active SIMD kernel of RangeCopy, LutTransform, PixelShuffle, ChannelGather and ChannelSum.
+//Kernel is the RangeCopy or LutTransform enum, Fn what calls go through, a function pointer or a
+//pointer to a table of them. Picked on first use and swapped by SetKernel for benchmarks.
+template <typename Kernel, typename Fn>
+class KernelDispatch
+{
+public:
+    using NameFn = const char* (*)(Kernel);
+    using SupportedFn = bool (*)(Kernel);
+    using KernelForFn = Fn (*)(Kernel);
+
+    //the kernel variable names, e.g. FSEQ_SUM_KERNEL=avx2 to pin one for comparisons, otherwise
+    //the first of preferred the CPU runs, Scalar when there is none
+    KernelDispatch(const char* variable, std::initializer_list<Kernel> preferred, NameFn name, SupportedFn supported, KernelForFn kernelFor) :
+        m_supported(supported),
+        m_kernelFor(kernelFor)
+    {
+        Kernel kernel = Forced(variable, name, supported);
+        if (kernel == Kernel::Count) {
+            kernel = Kernel::Scalar;
+            for (auto const candidate : preferred) {
+                if (supported(candidate)) {
+                    kernel = candidate;
+                    break;
+                }
+            }
+        }
+        m_active = kernel;
+        m_fn = kernelFor(kernel);
+    }
+
+    [[nodiscard]] Fn fn() const { return m_fn.load(std::memory_order_relaxed); }
+    [[nodiscard]] Kernel active() const { return m_active; }
+
+    //false when the CPU can't run it
+    bool set(Kernel kernel)
+    {
+        if (!m_supported(kernel)) {
+            return false;
+        }
+        m_fn = m_kernelFor(kernel);
+        m_active = kernel;
+        return true;
+    }
+
+    //kernel the variable names, ignoring case, Count when unset, unknown or unsupported
+    static Kernel Forced(const char* variable, NameFn name, SupportedFn supported)
+    {
+        const char* forced = std::getenv(variable);
+        if (forced == nullptr) {
+            return Kernel::Count;
+        }
+        std::string_view const wanted(forced);
+        for (int x = 0; x < static_cast<int>(Kernel::Count); ++x) {
+            auto const kernel = static_cast<Kernel>(x);
+            std::string_view const kernelName = name(kernel);
+            if (kernelName.size() == wanted.size() && std::equal(kernelName.begin(), kernelName.end(), wanted.begin(),
+                [](char a, char b) { return (a | 0x20) == (b | 0x20); }) && supported(kernel)) {
+                return kernel;
+            }
+        }
+        return Kernel::Count;
+    }
+
+private:
+    SupportedFn m_supported;
+    KernelForFn m_kernelFor;
+    std::atomic<Kernel> m_active;
+    std::atomic<Fn> m_fn;
+};
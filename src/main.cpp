@@ -1,8 +1,16 @@
 #include "mainwindow.h"
+#include "range_bench.h"
 #include <QApplication>
 
+#include <cstring>
+
 int main(int argc, char *argv[])
 {
+    for (int x = 1; x < argc; ++x) {
+        if (strcmp(argv[x], "--bench-ranges") == 0) {
+            return RunRangeBenchmark(argc, argv);
+        }
+    }
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QApplication a(argc, argv);
     MainWindow w;
@@ -5,8 +5,24 @@
 
 #include "controller.h"
 #include "auto_updater.h"
+#include "fseq_table_model.h"
+#include "volume_watcher.h"
+#include "trace.h"
+#include "export_progress.h"
+#include "export_plan_dialog.h"
+#include "card_mapping_dialog.h"
+#include "eseq_export_dialog.h"
+#include "range_editor_dialog.h"
+#include "range_optimizer.h"
+#include "channel_activity.h"
+#include "multi_target_export.h"
+#include "frame_resampler.h"
+#include "sequence_preview.h"
+#include "channel_map.h"
+#include "controller_profile.h"
 
-#include <QTableWidgetItem>
+#include <QHeaderView>
+#include <QSortFilterProxyModel>
 #include <QSettings>
 #include <QTimer>
 #include <QNetworkRequest>
@@ -17,27 +33,34 @@
 #include <QStorageInfo>
 #include <QProgressDialog>
 #include <QStandardPaths>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QFile>
 
 #include "spdlog/spdlog.h"
 
+#include "spdlog/async.h"
+#include "spdlog/cfg/env.h"
 #include "spdlog/sinks/qt_sinks.h"
 #include "spdlog/sinks/rotating_file_sink.h"
 
-#include "pugixml.hpp"
-
 #include <iostream>
 #include <memory>
 #include <filesystem>
+#include <chrono>
 #include <utility>
 #include <fstream>
 #include <sstream>
-
-enum class FSEQColumn : int { Enabled = 0, FileName, DataModified };
+#include <map>
+#include <tuple>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     m_ui(new Ui::MainWindow)
 {
+    m_startupTimer.start();
     QCoreApplication::setApplicationName(PROJECT_NAME);
     QCoreApplication::setApplicationVersion(PROJECT_VER);
     m_ui->setupUi(this);
@@ -54,11 +77,19 @@ MainWindow::MainWindow(QWidget *parent) :
         auto file{ std::string(logdir.toStdString() + log_name) };
         auto rotating = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(file, 1024 * 1024, 5, false);
 
-        m_logger = std::make_shared<spdlog::logger>(PROJECT_NAME, rotating);
-        m_logger->flush_on(spdlog::level::debug);
-        m_logger->set_level(spdlog::level::debug);
+        //formatting happens on the caller, the file write on the logger thread. When the
+        //queue is full the oldest messages are dropped rather than stalling an export
+        spdlog::init_thread_pool(8192, 1);
+        m_logger = std::make_shared<spdlog::async_logger>(PROJECT_NAME, rotating, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+        m_logger->flush_on(spdlog::level::warn);
+        m_logger->set_level(spdlog::level::info);
         m_logger->set_pattern("[%D %H:%M:%S] [%L] %v");
         spdlog::register_logger(m_logger);
+        //FSEQFile logs through the default logger
+        spdlog::set_default_logger(m_logger);
+        spdlog::flush_every(std::chrono::seconds(3));
+        //SPDLOG_LEVEL=debug turns the debug output back on
+        spdlog::cfg::load_env_levels();
     }
     catch (std::exception& /*ex*/)
     {
@@ -69,16 +100,53 @@ MainWindow::MainWindow(QWidget *parent) :
 
     m_settings = std::make_unique< QSettings>(m_appdir + "/settings.txt", QSettings::IniFormat);
 
+    m_fseqModel = new FSEQTableModel(this);
+    m_fseqProxy = new QSortFilterProxyModel(this);
+    m_fseqProxy->setSourceModel(m_fseqModel);
+    m_fseqProxy->setSortRole(FSEQTableModel::SortRole);
+    m_fseqProxy->setFilterKeyColumn(std::to_underlying(FSEQColumn::FileName));
+    m_fseqProxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    m_ui->tableViewFSEQs->setModel(m_fseqProxy);
+    m_ui->tableViewFSEQs->sortByColumn(std::to_underlying(FSEQColumn::FileName), Qt::AscendingOrder);
+    //fixed row heights and section sizes so the view never measures every row
+    m_ui->tableViewFSEQs->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_ui->tableViewFSEQs->verticalHeader()->setDefaultSectionSize(m_ui->tableViewFSEQs->fontMetrics().height() + 6);
+    m_ui->tableViewFSEQs->verticalHeader()->hide();
+    m_ui->tableViewFSEQs->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    m_ui->tableViewFSEQs->horizontalHeader()->setStretchLastSection(true);
+    m_ui->tableViewFSEQs->setColumnWidth(std::to_underlying(FSEQColumn::Enabled), 50);
+    m_ui->tableViewFSEQs->setColumnWidth(std::to_underlying(FSEQColumn::FileName), 260);
+    m_ui->tableViewFSEQs->setColumnWidth(std::to_underlying(FSEQColumn::DataModified), 140);
+    connect(m_ui->lineEditFilter, &QLineEdit::textChanged, m_fseqProxy, &QSortFilterProxyModel::setFilterFixedString);
+
+    m_preview = new SequencePreviewDock(this);
+    addDockWidget(Qt::BottomDockWidgetArea, m_preview);
+    m_preview->setVisible(m_settings->value("ShowPreview", false).toBool());
+    m_ui->menuFile->insertAction(m_ui->actionShow_All_Drives, m_preview->toggleViewAction());
+    connect(m_preview->toggleViewAction(), &QAction::toggled, this, [this](bool checked) {
+        m_settings->setValue("ShowPreview", checked);
+    });
+    connect(m_ui->tableViewFSEQs->selectionModel(), &QItemSelectionModel::currentRowChanged, this, [this](QModelIndex const& current) {
+        if (current.isValid()) {
+            m_preview->setSequence(m_fseqModel->entry(m_fseqProxy->mapToSource(current).row()).path);
+        }
+    });
+
     on_checkBoxSparse_stateChanged(0);
-    searchForUSBs();
-    auto homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
-    auto fseqFolder = m_settings->value("FSEQFolder", homeDir).toString();
-    if (!fseqFolder.isEmpty() && QDir().exists(fseqFolder))
-    {
-        m_fseqFolder = fseqFolder;
-		setWindowTitle(m_title + " - " + m_fseqFolder);
-        searchForFSEQs();
+
+    m_volumeWatcher = new VolumeWatcher(this);
+    connect(m_volumeWatcher, &VolumeWatcher::volumesChanged, this, &MainWindow::updateVolumes);
+    bool const showAllDrives = m_settings->value("ShowAllDrives", false).toBool();
+    m_ui->actionShow_All_Drives->setChecked(showAllDrives);
+    m_volumeWatcher->setShowAllVolumes(showAllDrives);
+    m_ui->actionUse_Controller_Profiles->setChecked(m_settings->value("UseControllerProfiles", false).toBool());
+    loadProfiles();
+
+    //CONTROLLER_GEN_TRACE=1 records from startup, the trace is written on exit
+    if (qEnvironmentVariableIntValue("CONTROLLER_GEN_TRACE") != 0) {
+        m_ui->actionRecord_Trace->setChecked(true);
     }
+
     m_updater = std::make_unique<AutoUpdater>(this);
     connect(m_updater.get(), &AutoUpdater::updateError, this, [](int code, const QString& message) {
         QMessageBox::warning(nullptr, "Update Check Failed", QString("Update check failed: %1 - %2").arg(code).arg(message));
@@ -97,12 +165,37 @@ MainWindow::MainWindow(QWidget *parent) :
         }
        });
 
-	m_updater->checkForUpdates(false);
+    //everything that touches the disk or network waits until the window is up
+    QTimer::singleShot(0, this, &MainWindow::startupLoad);
+    m_logger->info("Main window constructed in {} ms", m_startupTimer.elapsed());
 }
 
 MainWindow::~MainWindow()
 {
+    ++m_scanGeneration;
+    m_workerPool.waitForDone();
+    if (Trace::IsEnabled()) {
+        saveTrace();
+    }
     delete m_ui;
+    if (m_logger) {
+        m_logger->flush();
+    }
+}
+
+void MainWindow::startupLoad()
+{
+    m_logger->info("Main window shown after {} ms", m_startupTimer.elapsed());
+    m_volumeWatcher->start();
+    auto homeDir = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    auto fseqFolder = m_settings->value("FSEQFolder", homeDir).toString();
+    if (!fseqFolder.isEmpty())
+    {
+        m_fseqFolder = fseqFolder;
+        setWindowTitle(m_title + " - " + m_fseqFolder);
+        searchForFSEQs();
+    }
+    m_updater->checkForUpdates(false);
 }
 
 void MainWindow::on_actionSet_Folder_triggered()
@@ -199,19 +292,195 @@ void MainWindow::on_actionAbout_QT_triggered()
     QMessageBox::aboutQt(this, "About Qt");
 }
 
+void MainWindow::on_actionShow_All_Drives_toggled(bool checked)
+{
+    m_settings->setValue("ShowAllDrives", checked);
+    m_volumeWatcher->setShowAllVolumes(checked);
+}
+
+void MainWindow::on_actionUse_Controller_Profiles_toggled(bool checked)
+{
+    m_settings->setValue("UseControllerProfiles", checked);
+}
+
+void MainWindow::on_actionCalibrate_Controller_Profiles_triggered()
+{
+    auto const fseqs = selectedFSEQs();
+    if (fseqs.empty()) {
+        QMessageBox::warning(this, "No FSEQ Files", "Select the sequences to calibrate with.");
+        return;
+    }
+    //every controller of a profile adds its channels to the sample
+    std::map<std::string, ChannelRanges> profileRanges;
+    for (auto const& controller : m_controllers) {
+        if (auto const* profile = m_profiles.find(controller.vendor, controller.model)) {
+            auto& ranges = profileRanges[profile->name];
+            ranges.insert(ranges.end(), controller.ranges.begin(), controller.ranges.end());
+        }
+    }
+    if (profileRanges.empty()) {
+        QMessageBox::information(this, "No Profiles", "None of the controllers matches a controller profile.");
+        return;
+    }
+    QProgressDialog progress("Calibrating controller profiles...", "Abort", 0, static_cast<int>(profileRanges.size() * fseqs.size()), this);
+    progress.setWindowModality(Qt::WindowModal);
+    QStringList results;
+    int step{ 0 };
+    for (auto const& [name, ranges] : profileRanges) {
+        auto profile = *std::find_if(m_profiles.profiles().begin(), m_profiles.profiles().end(), [&name](auto const& p) { return p.name == name; });
+        auto const sparse = ToSparseRanges(MergeRanges(ranges));
+        //compressed and raw bytes of every sequence add up, so long sequences weigh more
+        std::array<double, 3> compressed{};
+        std::array<double, 3> raw{};
+        for (auto const& fseq : fseqs) {
+            progress.setValue(step++);
+            progress.setLabelText(QString("Compressing %1 for %2...").arg(fseq.fileName).arg(name.c_str()));
+            QCoreApplication::processEvents();
+            if (progress.wasCanceled()) {
+                return;
+            }
+            for (auto const codec : profile.codecs) {
+                if (codec == FSEQFile::CompressionType::none) {
+                    continue;
+                }
+                auto const estimate = EstimateExport(fseq.path.toStdString(), sparse, 2, 2, codec, -99, true);
+                if (estimate.valid) {
+                    compressed[codec] += estimate.ratio * estimate.rawBytes;
+                    raw[codec] += estimate.rawBytes;
+                }
+            }
+        }
+        QStringList ratios;
+        for (int x = 0; x < 3; ++x) {
+            if (raw[x] > 0.0) {
+                profile.ratios[x] = compressed[x] / raw[x];
+                ratios << QString("%1 %2").arg(FSEQFile::CompressionTypeStrings[x]).arg(profile.ratios[x], 0, 'f', 3);
+            }
+        }
+        if (ratios.isEmpty()) {
+            continue;
+        }
+        std::string error;
+        if (!ControllerProfiles::SaveRatios(profilesPath().toStdString(), profile, error)) {
+            m_logger->warn("Calibration of {} not saved, {}", name, error);
+            continue;
+        }
+        m_logger->info("Calibrated {}: {}", name, ratios.join(", ").toStdString());
+        results << QString("%1: %2").arg(name.c_str()).arg(ratios.join(", "));
+    }
+    progress.setValue(progress.maximum());
+    loadProfiles();
+    QMessageBox::information(this, "Profiles Calibrated", results.isEmpty() ? QString("Nothing to calibrate, the matching profiles only take uncompressed files.") :
+        QString("Measured compression ratios, saved to %1:\n\n%2").arg(QDir::toNativeSeparators(profilesPath())).arg(results.join("\n")));
+}
+
+void MainWindow::on_actionRecord_Trace_toggled(bool checked)
+{
+    if (checked) {
+        Trace::SetThreadName("ui");
+        Trace::Start();
+        m_logger->info("Trace recording started");
+        return;
+    }
+    auto const path = saveTrace();
+    if (path.isEmpty()) {
+        QMessageBox::warning(this, "Trace Failed", "Failed to write the trace file. See log for details.");
+        return;
+    }
+    QMessageBox::information(this, "Trace Saved", QString("Trace written to:\n%1\n\nOpen it at ui.perfetto.dev or chrome://tracing.").arg(path));
+}
+
+QString MainWindow::saveTrace()
+{
+    QString const path = m_appdir + "/log/" + QString("trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    auto const count = Trace::Stop(path.toStdString());
+    if (count < 0) {
+        m_logger->error("Failed to write trace: {}", path.toStdString());
+        return QString();
+    }
+    m_logger->info("Trace with {} events written to {}", count, path.toStdString());
+    return path;
+}
+
 void MainWindow::on_pushButtonRefresh_clicked()
 {
     searchForUSBs();
 }
 
+void MainWindow::on_pushButtonSpeedTest_clicked()
+{
+    QString const rootPath = m_ui->comboBoxSDCard->currentData().toString();
+    QString const key = storageSpeedKey(rootPath);
+    if (rootPath.isEmpty() || key.isEmpty()) {
+        QMessageBox::warning(this, "No SD Card Selected", "Please select an SD Card from the dropdown.");
+        return;
+    }
+    m_ui->pushButtonSpeedTest->setEnabled(false);
+    m_ui->labelDriveSpeed->setText("Testing...");
+    m_logger->info("Speed testing {}", rootPath.toStdString());
+    m_workerPool.start([this, rootPath, key]() {
+        auto const speed = ProbeStorageSpeed(rootPath.toStdString());
+        QMetaObject::invokeMethod(this, [this, rootPath, key, speed]() {
+            m_ui->pushButtonSpeedTest->setEnabled(true);
+            if (!speed.valid()) {
+                showStorageSpeed();
+                QMessageBox::warning(this, "Speed Test Failed", QString("Could not write a test file to %1.").arg(rootPath));
+                return;
+            }
+            m_logger->info("{} writes at {:.1f} MB/s, reads at {:.1f} MB/s", rootPath.toStdString(), speed.writeMBps, speed.readMBps);
+            m_settings->setValue(key + "/Write", speed.writeMBps);
+            m_settings->setValue(key + "/Read", speed.readMBps);
+            showStorageSpeed();
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::on_comboBoxSDCard_currentIndexChanged(int)
+{
+    showStorageSpeed();
+}
+
+QString MainWindow::storageSpeedKey(QString const& rootPath) const
+{
+    for (auto const& volume : m_volumes) {
+        if (volume.rootPath != rootPath) {
+            continue;
+        }
+        return "StorageSpeed/" + volume.identity();
+    }
+    return QString();
+}
+
+StorageSpeed MainWindow::cachedStorageSpeed(QString const& rootPath) const
+{
+    StorageSpeed speed;
+    QString const key = storageSpeedKey(rootPath);
+    if (!key.isEmpty()) {
+        speed.writeMBps = m_settings->value(key + "/Write", 0.0).toDouble();
+        speed.readMBps = m_settings->value(key + "/Read", 0.0).toDouble();
+    }
+    return speed;
+}
+
+void MainWindow::showStorageSpeed()
+{
+    auto const speed = cachedStorageSpeed(m_ui->comboBoxSDCard->currentData().toString());
+    if (!speed.valid()) {
+        m_ui->labelDriveSpeed->setText("Not tested");
+        return;
+    }
+    m_ui->labelDriveSpeed->setText(QString("W %1 / R %2 MB/s").arg(speed.writeMBps, 0, 'f', 1).arg(speed.readMBps, 0, 'f', 1));
+}
+
 void MainWindow::on_pushButtonExport_clicked()
 {
     if (m_ui->comboBoxSDCard->currentIndex() < 0) {
         QMessageBox::warning(this, "No SD Card Selected", "Please select an SD Card from the dropdown.");
         return;
     }
-    if (m_ui->tableWidgetFSEQs->rowCount() == 0) {
-        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files found to export.");
+    auto const fseqs = selectedFSEQs();
+    if (fseqs.empty()) {
+        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files selected to export.");
         return;
     }
     QString const sdcardPath = m_ui->comboBoxSDCard->currentData().toString();
@@ -220,142 +489,625 @@ void MainWindow::on_pushButtonExport_clicked()
         QMessageBox::warning(this, "Invalid SD Card Path", "The selected SD Card path is invalid.");
         return;
     }
-    int const startChannel = m_ui->spinBoxStartChannel->value();
-    int const endChannel = m_ui->spinBoxEndChannel->value();
-    auto const compression_level = m_ui->spinBoxCompressionLevel->value();
-    bool const sparse = m_ui->checkBoxSparse->isChecked();
+    ExportSettings settings;
+    if (!exportSettings(settings)) {
+        return;
+    }
     std::vector<std::pair<uint32_t, uint32_t>> ranges;
-    if (sparse) {
-        ranges.push_back(std::pair<uint32_t, uint32_t>(startChannel, endChannel));
+    if (settings.sparse) {
+        ChannelRanges channels;
+        if (!ParseRanges(m_ui->lineEditRanges->text().toStdString(), channels) || channels.empty()) {
+            QMessageBox::warning(this, "Invalid Channel Ranges", "Enter the channels to export, e.g. 1-510, 1021-1530.");
+            return;
+        }
+        ranges = ToSparseRanges(channels);
     }
-    int major_ver { 2 };
-    int minor_ver { 2 };
+    int const idx = m_ui->comboBoxController->currentIndex();
+    FrameTransform transform;
+    PowerPorts power;
+    if (idx >= 0 && idx < static_cast<int>(m_controllers.size())) {
+        transform = m_controllers[idx].exportTransform();
+        power = m_controllers[idx].powerPorts();
+    }
+    std::vector<ExportJob> jobs;
+    for (auto const& fseq : fseqs) {
+        ExportJob job;
+        job.source = fseq.path.toStdString();
+        job.fileName = fseq.fileName.toStdString();
+        job.destination = QDir(sdcardPath).filePath(fseq.fileName).toStdString();
+        job.device = sdcardPath.toStdString();
+        job.ranges = ranges;
+        job.transform = transform;
+        job.power = power;
+        jobs.push_back(std::move(job));
+    }
+    runExport(jobs, settings, sdcardPath);
+}
 
-    auto const s_version = m_ui->comboBoxVersion->currentText();
-    if (s_version.contains('.')) {
-        auto const versions = s_version.split('.');
-        if (versions.size() == 2) {
-            major_ver = versions[0].toInt();
-            minor_ver = versions[1].toInt();
+void MainWindow::on_pushButtonExportAll_clicked()
+{
+    if (m_ui->comboBoxSDCard->currentIndex() < 0) {
+        QMessageBox::warning(this, "No SD Card Selected", "Please select an SD Card from the dropdown.");
+        return;
+    }
+    auto const fseqs = selectedFSEQs();
+    if (fseqs.empty()) {
+        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files selected to export.");
+        return;
+    }
+    QString sdcardPath = m_ui->comboBoxSDCard->currentData().toString();
+    if (sdcardPath.isEmpty()) {
+        m_logger->warn("The selected SD Card path is invalid: {}", sdcardPath.toStdString());
+        QMessageBox::warning(this, "Invalid SD Card Path", "The selected SD Card path is invalid.");
+        return;
+    }
+    ExportSettings settings;
+    if (!exportSettings(settings)) {
+        return;
+    }
+    std::vector<ExportJob> jobs;
+    for (auto const& controller : m_controllers) {
+        if (settings.sparse && controller.ranges.empty()) {
+            m_logger->warn("Controller {} has no channel ranges, skipping", controller.name);
+            continue;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        if (settings.sparse) {
+            ranges = controller.sparseRanges();
+        }
+        auto const transform = controller.exportTransform();
+        auto const power = controller.powerPorts();
+        auto const profile = controllerProfile(controller);
+        QDir outDir(sdcardPath);
+        if (m_controllers.size() > 1) {
+            outDir.setPath(outDir.filePath(controller.name.c_str()));
+        }
+        for (auto const& fseq : fseqs) {
+            ExportJob job;
+            job.source = fseq.path.toStdString();
+            job.fileName = fseq.fileName.toStdString();
+            job.destination = outDir.filePath(fseq.fileName).toStdString();
+            job.device = sdcardPath.toStdString();
+            job.controller = controller.name;
+            job.ranges = ranges;
+            job.transform = transform;
+            job.power = power;
+            job.profile = profile;
+            jobs.push_back(std::move(job));
         }
-    } else {
-        major_ver = s_version.toInt();
     }
+    runExport(jobs, settings, sdcardPath);
+}
 
-    V2FSEQFile::CompressionType compressionType = V2FSEQFile::CompressionType::none;
-    if (m_ui->comboBoxCompression->currentIndex() == 0) {
-        compressionType = V2FSEQFile::CompressionType::zstd;
-    } else if (m_ui->comboBoxCompression->currentIndex() == 1) {
-        compressionType = V2FSEQFile::CompressionType::zlib;
-    }
-    QProgressDialog progress("Exporting FSEQ Files...", "Abort", 0, m_ui->tableWidgetFSEQs->rowCount(), this);
-    bool working { true };
-    for (int row = 0; row < m_ui->tableWidgetFSEQs->rowCount(); ++row) {
-        QTableWidgetItem* checkBoxItem = m_ui->tableWidgetFSEQs->item(row, std::to_underlying(FSEQColumn::Enabled));
-        progress.setValue(row);
-        if (checkBoxItem && checkBoxItem->checkState() == Qt::Checked) {
-            QTableWidgetItem* fileItem = m_ui->tableWidgetFSEQs->item(row, std::to_underlying(FSEQColumn::FileName));
-            if (fileItem) {
-                progress.setLabelText(QString("Exporting %1...").arg(fileItem->text()));
-                QCoreApplication::processEvents();
-                QString const filePath = fileItem->toolTip();
-                if (!filePath.isEmpty()) {
-                    QString outPath = sdcardPath + fileItem->text();
-                    m_logger->info("Exporting {} to {}", filePath.toStdString(), outPath.toStdString());
-                    working &= exportFSEQFile(filePath.toStdString(), outPath.toStdString(), major_ver, minor_ver, compressionType, ranges, sparse, compression_level);
-                }
-            }
+void MainWindow::on_pushButtonExportCards_clicked()
+{
+    if (m_controllers.empty()) {
+        QMessageBox::warning(this, "No Controllers", "Open an xLights controller file first.");
+        return;
+    }
+    auto const fseqs = selectedFSEQs();
+    if (fseqs.empty()) {
+        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files selected to export.");
+        return;
+    }
+    if (m_volumes.isEmpty()) {
+        QMessageBox::warning(this, "No SD Cards", "No SD Cards found, insert the cards and press Refresh.");
+        return;
+    }
+    QStringList names;
+    QStringList current;
+    for (auto const& controller : m_controllers) {
+        names.append(QString::fromStdString(controller.name));
+        current.append(m_settings->value(controllerKey("CardMapping", controller.name)).toString());
+    }
+    CardMappingDialog dialog(names, m_volumes, current, this);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    auto const roots = dialog.rootPaths();
+    auto const identities = dialog.identities();
+    QMap<QString, int> controllersPerCard;
+    for (int c = 0; c < static_cast<int>(m_controllers.size()); ++c) {
+        m_settings->setValue(controllerKey("CardMapping", m_controllers[c].name), identities[c]);
+        if (!roots[c].isEmpty()) {
+            ++controllersPerCard[roots[c]];
         }
-        if (progress.wasCanceled()) {
-            break;
+    }
+
+    ExportSettings settings;
+    if (!exportSettings(settings)) {
+        return;
+    }
+    std::vector<ExportJob> jobs;
+    for (int c = 0; c < static_cast<int>(m_controllers.size()); ++c) {
+        if (roots[c].isEmpty()) {
+            continue;
+        }
+        auto const& controller = m_controllers[c];
+        if (settings.sparse && controller.ranges.empty()) {
+            m_logger->warn("Controller {} has no channel ranges, skipping", controller.name);
+            continue;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        if (settings.sparse) {
+            ranges = controller.sparseRanges();
+        }
+        auto const transform = controller.exportTransform();
+        auto const power = controller.powerPorts();
+        auto const profile = controllerProfile(controller);
+        //controllers sharing a card get a folder each, same as Export All
+        QDir outDir(roots[c]);
+        if (controllersPerCard[roots[c]] > 1) {
+            outDir.setPath(outDir.filePath(controller.name.c_str()));
+        }
+        for (auto const& fseq : fseqs) {
+            ExportJob job;
+            job.source = fseq.path.toStdString();
+            job.fileName = fseq.fileName.toStdString();
+            job.destination = outDir.filePath(fseq.fileName).toStdString();
+            job.device = roots[c].toStdString();
+            job.controller = controller.name;
+            job.ranges = ranges;
+            job.transform = transform;
+            job.power = power;
+            job.profile = profile;
+            jobs.push_back(std::move(job));
         }
     }
-    if (!working) {
-        QMessageBox::warning(this, "Export Error", "One or more FSEQ files failed to export. See log for details.");
+    if (jobs.empty()) {
+        QMessageBox::warning(this, "No Cards Selected", "Select a card for at least one controller.");
         return;
     }
-    QMessageBox::information(this, "Export Complete", "FSEQ files have been exported to the SD Card.");
+    runMultiExport(jobs, settings);
 }
 
-void MainWindow::on_pushButtonExportAll_clicked()
+void MainWindow::on_actionExport_ESEQ_triggered()
 {
     if (m_ui->comboBoxSDCard->currentIndex() < 0) {
         QMessageBox::warning(this, "No SD Card Selected", "Please select an SD Card from the dropdown.");
         return;
     }
-    if (m_ui->tableWidgetFSEQs->rowCount() == 0) {
-        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files found to export.");
+    int const idx = m_ui->comboBoxController->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(m_controllers.size())) {
+        QMessageBox::warning(this, "No Controller Selected", "Open an xLights controller file and select the controller of the models.");
+        return;
+    }
+    auto const fseqs = selectedFSEQs();
+    if (fseqs.empty()) {
+        QMessageBox::warning(this, "No FSEQ Files", "No FSEQ files selected to export.");
         return;
     }
-    QString sdcardPath = m_ui->comboBoxSDCard->currentData().toString();
+    QString const sdcardPath = m_ui->comboBoxSDCard->currentData().toString();
     if (sdcardPath.isEmpty()) {
         m_logger->warn("The selected SD Card path is invalid: {}", sdcardPath.toStdString());
         QMessageBox::warning(this, "Invalid SD Card Path", "The selected SD Card path is invalid.");
         return;
     }
-    auto const compression_level = m_ui->spinBoxCompressionLevel->value();
-    auto const sparse = m_ui->checkBoxSparse->isChecked();
-    int major_ver{ 2 };
-    int minor_ver{ 2 };
+    auto const& controller = m_controllers[idx];
+    //the models when the layout is known, each export range otherwise
+    std::vector<std::pair<std::string, std::pair<uint32_t, uint32_t>>> items;
+    for (auto const& model : controller.models) {
+        auto const ranges = ToSparseRanges(MergeRanges(model.ranges));
+        if (ranges.empty()) {
+            continue;
+        }
+        //an ESEQ holds one range, a model split over several takes the channels between them too
+        uint32_t const start = ranges.front().first;
+        items.emplace_back(model.name, std::make_pair(start, ranges.back().first + ranges.back().second - start));
+    }
+    if (items.empty()) {
+        for (auto const& range : controller.sparseRanges()) {
+            items.emplace_back(FormatRanges({ { range.first + 1, range.second } }), range);
+        }
+    }
+    if (items.empty()) {
+        QMessageBox::warning(this, "No Models", "The controller has no models or channel ranges to export.");
+        return;
+    }
+    QStringList labels;
+    for (auto const& [name, range] : items) {
+        labels << QString("%1 (%2 channels at %3)").arg(name.c_str()).arg(range.second).arg(range.first + 1);
+    }
+    EseqExportDialog dialog(QString::fromStdString(controller.name), labels, this);
+    if (dialog.exec() != QDialog::Accepted || dialog.selected().isEmpty()) {
+        return;
+    }
+
+    ExportSettings settings;
+    if (!exportSettings(settings)) {
+        return;
+    }
+    //every file is one range, there is nothing to trim or join
+    settings.sparse = true;
+    settings.trimDark = false;
+    //the header has no step time and players read ESEQ frames at 50 ms, other sources are resampled
+    settings.stepTime = ESEQFile::StepTime;
+    QDir const outDir(QDir(sdcardPath).filePath("effects"));
+    std::vector<ExportJob> jobs;
+    for (auto const& fseq : fseqs) {
+        QString const sequence = QFileInfo(fseq.fileName).completeBaseName();
+        for (int const item : dialog.selected()) {
+            auto const& [name, range] = items[item];
+            QString fileName = QString("%1 - %2.eseq").arg(sequence).arg(name.c_str());
+            //model names may hold characters no file system takes
+            for (QChar const c : QString("\\/:*?\"<>|")) {
+                fileName.replace(c, QChar('_'));
+            }
+            ExportJob job;
+            job.source = fseq.path.toStdString();
+            job.fileName = fseq.fileName.toStdString();
+            job.destination = outDir.filePath(fileName).toStdString();
+            job.device = sdcardPath.toStdString();
+            job.controller = name;
+            job.ranges = { range };
+            //what the estimate and plan size the file as, ESEQ frames are uncompressed
+            job.format = ExportFormat{ 2, 0, FSEQFile::CompressionType::none, -99 };
+            job.eseq = true;
+            jobs.push_back(std::move(job));
+        }
+    }
+    runMultiExport(jobs, settings);
+}
+
+void MainWindow::runMultiExport(std::vector<ExportJob>& jobs, ExportSettings const& settings)
+{
+    if (!estimateJobs(jobs, settings)) {
+        return;
+    }
+    std::map<std::string, std::vector<ExportJob>> byDevice;
+    for (auto const& job : jobs) {
+        byDevice[job.device].push_back(job);
+    }
+    //cards run side by side, the ETA before any history is set by the slowest one
+    double slowestSeconds{ 0.0 };
+    bool allTested{ true };
+    uint64_t totalBytes{ 0 };
+    for (auto const& [device, deviceJobs] : byDevice) {
+        QString const root = QString::fromStdString(device);
+        auto const speed = cachedStorageSpeed(root);
+        if (!confirmCardSpeed(deviceJobs, speed)) {
+            return;
+        }
+        QStorageInfo const storage(root);
+        auto const plan = BuildExportPlan(deviceJobs, storage.bytesAvailable(), storage.blockSize(), storage.fileSystemType().toStdString());
+        m_logger->info("Export plan for {}: {} bytes needed, {} available", device, plan.requiredBytes(), plan.availableBytes);
+        //the breakdown of each card is shown before anything is written, like a single card export
+        ExportPlanDialog planDialog(plan, root, this);
+        if (planDialog.exec() != QDialog::Accepted) {
+            return;
+        }
+        totalBytes += plan.requiredBytes();
+        if (speed.valid()) {
+            slowestSeconds = std::max(slowestSeconds, plan.requiredBytes() / (speed.writeMBps * 1024.0 * 1024.0));
+        } else {
+            allTested = false;
+        }
+    }
+    double const effectiveMBps = allTested && slowestSeconds > 0.0 ? totalBytes / (1024.0 * 1024.0) / slowestSeconds : 0.0;
+
+    std::vector<std::string> sources;
+    for (auto const& job : jobs) {
+        if (std::find(sources.begin(), sources.end(), job.source) == sources.end()) {
+            sources.push_back(job.source);
+        }
+    }
+
+    ExportProgress progress(this, totalBytes, effectiveMBps);
+    bool working{ true };
+    ExportRunReport runReport;
+    QElapsedTimer runTimer;
+    runTimer.start();
+    for (auto const& source : sources) {
+        std::vector<ExportTarget> targets;
+        std::vector<ExportJob const*> targetJobs;
+        uint64_t estimated{ 0 };
+        QString fileName;
+        for (auto const& job : jobs) {
+            if (job.source != source) {
+                continue;
+            }
+            QDir().mkpath(QFileInfo(QString::fromStdString(job.destination)).absolutePath());
+            targets.push_back({ job.controller, job.device, job.destination, job.ranges, job.transform, job.power, job.format, job.eseq });
+            targetJobs.push_back(&job);
+            estimated += job.estimate.estimatedBytes;
+            fileName = QString::fromStdString(job.fileName);
+        }
+        progress.beginFile(QString("Exporting %1 to %2 outputs on %3 cards...").arg(fileName).arg(targets.size()).arg(byDevice.size()), estimated);
+        m_logger->info("Exporting {} to {} outputs", source, targets.size());
+        size_t const firstReport = runReport.files.size();
+        working &= ExportToTargets(source, targets, settings, runReport.files,
+            [&progress](uint32_t frame, uint32_t frames, uint64_t written) { return progress.update(frame, frames, written); });
+        uint64_t written{ 0 };
+        for (size_t x = firstReport; x < runReport.files.size(); ++x) {
+            auto& fileReport = runReport.files[x];
+            written += fileReport.outputBytes;
+            auto const* job = targetJobs[x - firstReport];
+            fileReport.sparseRanges = settings.sparse ? job->ranges.size() : 0;
+            fileReport.paddedChannels = job->paddedChannels;
+            fileReport.trimmedChannels = job->trimmedChannels;
+        }
+        progress.endFile(written);
+        if (progress.wasCanceled()) {
+            runReport.cancelled = true;
+            break;
+        }
+    }
+    runReport.wallNanos = runTimer.nsecsElapsed();
+    showExportReport(runReport, working);
+}
 
+bool MainWindow::exportSettings(ExportSettings& settings)
+{
+    settings = ExportSettings();
+    //every export path reads its settings here, none may write with a curve the user did not enter
+    if (!ParseCurvePoints(m_ui->lineEditCurve->text().toStdString(), settings.curve.points)) {
+        QMessageBox::warning(this, "Invalid Curve", "Enter the curve as input:output points, e.g. 0:0, 128:64, 255:200.");
+        return false;
+    }
+    settings.compressionLevel = m_ui->spinBoxCompressionLevel->value();
+    settings.sparse = m_ui->checkBoxSparse->isChecked();
+    settings.stepTime = m_ui->spinBoxStepTime->value();
+    settings.blendFrames = m_ui->checkBoxBlendFrames->isChecked();
+    settings.startMS = static_cast<uint32_t>(QTime(0, 0).msecsTo(m_ui->timeEditStart->time()));
+    settings.endMS = static_cast<uint32_t>(QTime(0, 0).msecsTo(m_ui->timeEditEnd->time()));
+    settings.curve.brightness = m_ui->spinBoxBrightness->value();
+    settings.curve.gamma = m_ui->doubleSpinBoxGamma->value();
     auto const s_version = m_ui->comboBoxVersion->currentText();
     if (s_version.contains('.')) {
         auto const versions = s_version.split('.');
         if (versions.size() == 2) {
-            major_ver = versions[0].toInt();
-            minor_ver = versions[1].toInt();
+            settings.major_ver = versions[0].toInt();
+            settings.minor_ver = versions[1].toInt();
         }
     } else {
-        major_ver = s_version.toInt();
+        settings.major_ver = s_version.toInt();
     }
+    //trimmed ranges are only kept apart by sparse V2 files, a curve that lifts 0 lights
+    //channels the source never does
+    settings.trimDark = settings.sparse && settings.major_ver == 2 && m_ui->checkBoxTrimDark->isChecked() &&
+        settings.curve.lut()[0] == 0;
 
-    V2FSEQFile::CompressionType compressionType = V2FSEQFile::CompressionType::none;
+    settings.compressionType = V2FSEQFile::CompressionType::none;
     if (m_ui->comboBoxCompression->currentIndex() == 0) {
-        compressionType = V2FSEQFile::CompressionType::zstd;
+        settings.compressionType = V2FSEQFile::CompressionType::zstd;
     } else if (m_ui->comboBoxCompression->currentIndex() == 1) {
-        compressionType = V2FSEQFile::CompressionType::zlib;
+        settings.compressionType = V2FSEQFile::CompressionType::zlib;
     }
-    QProgressDialog progress("Exporting FSEQ Files...", "Abort", 0, m_ui->tableWidgetFSEQs->rowCount() * m_controllers.size(), this);
-    bool working{ true };
-    for(int c = 0; c < m_controllers.size(); ++c) {
-        auto const& controller = m_controllers[c];
-        std::vector<std::pair<uint32_t, uint32_t>> ranges;
-        if (sparse) {
-            ranges.push_back(std::pair<uint32_t, uint32_t>(controller.start_channel, controller.channels));
-        }
-        for (int row = 0; row < m_ui->tableWidgetFSEQs->rowCount(); ++row) {
-            QTableWidgetItem* checkBoxItem = m_ui->tableWidgetFSEQs->item(row, std::to_underlying(FSEQColumn::Enabled));
-            progress.setValue(c * m_ui->tableWidgetFSEQs->rowCount() + row);
-            if (checkBoxItem && checkBoxItem->checkState() == Qt::Checked) {
-                QTableWidgetItem* fileItem = m_ui->tableWidgetFSEQs->item(row, std::to_underlying(FSEQColumn::FileName));
-                if (fileItem) {
-                    progress.setLabelText(QString("Exporting %1 to %2...").arg(fileItem->text()).arg(controller.name.c_str()));
-                    QCoreApplication::processEvents();
-                    QString const filePath = fileItem->toolTip();
-                    if (!filePath.isEmpty()) {
-                        QString outPath = sdcardPath + fileItem->text();
-                        if (m_controllers.size() > 1) {
-                            QDir().mkpath(sdcardPath + QDir::separator() + controller.name.c_str());
-                            outPath = sdcardPath + controller.name.c_str() + QDir::separator() + fileItem->text();
-                        }
-                        m_logger->info("Exporting {} to {}", filePath.toStdString(), outPath.toStdString());
-                        working &= exportFSEQFile(filePath.toStdString(), outPath.toStdString(), major_ver, minor_ver, compressionType, ranges, sparse, compression_level);
-                    }
-                }
+    return true;
+}
+
+bool MainWindow::estimateJobs(std::vector<ExportJob>& jobs, ExportSettings const& settings)
+{
+    QProgressDialog progress("Estimating output sizes...", "Abort", 0, static_cast<int>(jobs.size()), this);
+    progress.setWindowModality(Qt::WindowModal);
+    //Export All without sparse output writes the same file once per controller
+    std::map<std::tuple<std::string, std::vector<std::pair<uint32_t, uint32_t>>, ExportFormat>, ExportEstimate> estimates;
+    std::map<std::string, ChannelActivity> activities;
+    for (int x = 0; x < static_cast<int>(jobs.size()); ++x) {
+        auto& job = jobs[x];
+        progress.setValue(x);
+        auto const untrimmed = job.ranges;
+        if (settings.trimDark && !job.ranges.empty()) {
+            auto found = activities.find(job.source);
+            if (found == activities.end()) {
+                progress.setLabelText(QString("Scanning %1 for dark channels...").arg(job.fileName.c_str()));
+                found = activities.emplace(job.source, scanChannelActivity(job.source, progress)).first;
             }
             if (progress.wasCanceled()) {
-                break;
+                return false;
             }
+            trimDarkChannels(job, found->second);
         }
+        progress.setLabelText(QString("Estimating %1...").arg(job.fileName.c_str()));
+        QCoreApplication::processEvents();
         if (progress.wasCanceled()) {
-            break;
+            return false;
+        }
+        //sized for the exported window and step time
+        auto const estimate = [&](ExportFormat const& format) {
+            auto const key = std::make_tuple(job.source, job.ranges, format);
+            auto found = estimates.find(key);
+            if (found == estimates.end()) {
+                auto const result = EstimateExport(job.source, job.ranges, format.major_ver, format.minor_ver,
+                    format.compressionType, format.compressionLevel, settings.sparse);
+                m_logger->debug("Estimated {} at {} bytes, ratio {:.3f}", job.source, result.estimatedBytes, result.ratio);
+                found = estimates.emplace(key, result).first;
+            }
+            ExportEstimate result = found->second;
+            if (result.valid) {
+                result.trim(settings.window(result.frames, result.stepTime).count);
+            }
+            result.resample(settings.stepTime);
+            return result;
+        };
+        ExportFormat const run = job.format.value_or(settings.format());
+        job.estimate = estimate(run);
+        if (job.profile) {
+            std::string reason;
+            auto const format = ChooseExportFormat(*job.profile, run, job.estimate, reason, job.warning);
+            if (format != run) {
+                job.format = format;
+                //trimmed ranges only stay apart in sparse V2 files, a V1 file packs them and every
+                //channel after a trimmed one would move
+                if (format.major_ver < 2 && job.ranges != untrimmed) {
+                    m_logger->info("{} profile for {} picked V1, keeping the dark channels", job.profile->name, job.destination);
+                    job.ranges = untrimmed;
+                    job.trimmedChannels = 0;
+                }
+                job.estimate = estimate(format);
+            }
+            //V1 headers have no sparse ranges, the writer packs them from channel 1
+            if (format.major_ver < 2 && !job.ranges.empty()) {
+                job.warning += std::string(job.warning.empty() ? "" : ", ") + "V1 file, the channel ranges are packed from channel 1";
+            }
+            if (!reason.empty()) {
+                m_logger->info("{} profile for {}: V{}.{} {}, {}", job.profile->name, job.destination, format.major_ver, format.minor_ver,
+                    FSEQFile::CompressionTypeStrings[format.compressionType], reason);
+            }
+            if (!job.warning.empty()) {
+                m_logger->warn("{} profile for {}: {}", job.profile->name, job.destination, job.warning);
+            }
+        }
+        optimizeRanges(job, job.settings(settings));
+    }
+    return true;
+}
+
+ChannelActivity MainWindow::scanChannelActivity(std::string const& source, QProgressDialog& progress)
+{
+    //without cached statistics the whole sequence is decoded, keep the dialog responsive while the pool works
+    ScanProgress scan;
+    ChannelActivity activity;
+    QEventLoop loop;
+    m_workerPool.start([&scan, &activity, &loop, source]() {
+        activity = GetChannelActivity(source, &scan);
+        QMetaObject::invokeMethod(&loop, "quit", Qt::QueuedConnection);
+    });
+    QString const label = progress.labelText();
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, &loop, [&]() {
+        progress.setLabelText(QString("%1 (%2 frames)").arg(label).arg(scan.frames.load()));
+        if (progress.wasCanceled()) {
+            scan.cancel = true;
+        }
+    });
+    timer.start(100);
+    loop.exec();
+    if (activity.valid) {
+        m_logger->info("Scanned {}: {} frames, {} of {} channels always dark", source, activity.frames,
+            activity.darkChannels({ { 0, static_cast<uint32_t>(activity.maxValue.size()) } }), activity.maxValue.size());
+    } else if (!scan.cancel) {
+        m_logger->warn("Could not scan {} for dark channels, exporting the full ranges", source);
+    }
+    return activity;
+}
+
+void MainWindow::trimDarkChannels(ExportJob& job, ChannelActivity const& activity)
+{
+    if (!activity.valid) {
+        return;
+    }
+    uint64_t before{ 0 };
+    for (auto const& [start, count] : job.ranges) {
+        before += count;
+    }
+    //a reordered pixel sends its G value where the sequence has R, darkness moves with it
+    ChannelActivity reordered;
+    if (!job.transform.empty()) {
+        reordered = activity;
+        job.transform.apply(reordered.maxValue.data(), reordered.channels());
+    }
+    auto lit = TrimDarkChannels(job.ranges, job.transform.empty() ? activity : reordered);
+    //empty ranges would mean the whole frame, keep a single channel of a dark controller
+    if (lit.empty()) {
+        lit.emplace_back(job.ranges.front().first, 1);
+    }
+    uint64_t after{ 0 };
+    for (auto const& [start, count] : lit) {
+        after += count;
+    }
+    job.trimmedChannels = before - after;
+    m_logger->info("Trimmed {} dark channels from {} ({} ranges)", job.trimmedChannels, job.destination, lit.size());
+    job.ranges = std::move(lit);
+}
+
+void MainWindow::optimizeRanges(ExportJob& job, ExportSettings const& settings)
+{
+    //only V2 files are sparse
+    if (!settings.sparse || settings.major_ver < 2 || job.ranges.size() < 2 || !job.estimate.valid) {
+        return;
+    }
+    double const bytesPerChannel = settings.compressionType == FSEQFile::CompressionType::none ? 1.0 : job.estimate.ratio;
+    auto const result = OptimizeSparseRanges(job.ranges, job.estimate.frames, bytesPerChannel);
+    if (result.ranges == job.ranges) {
+        return;
+    }
+    m_logger->info("Sparse ranges for {}: {} -> {}, padded {} channels (gaps up to {})", job.destination,
+        result.inputRanges, result.ranges.size(), result.paddedChannels, result.maxGap);
+    job.ranges = result.ranges;
+    job.paddedChannels = result.paddedChannels;
+    //the padding is stored in every frame
+    uint64_t const paddedBytes = result.paddedChannels * job.estimate.frames;
+    job.estimate.channels += static_cast<uint32_t>(result.paddedChannels);
+    job.estimate.rawBytes += paddedBytes;
+    job.estimate.estimatedBytes += static_cast<uint64_t>(paddedBytes * bytesPerChannel);
+}
+
+bool MainWindow::confirmCardSpeed(std::vector<ExportJob> const& jobs, StorageSpeed const& speed)
+{
+    double required{ 0.0 };
+    std::string slowest;
+    for (auto const& job : jobs) {
+        if (job.estimate.playbackBytesPerSecond() > required) {
+            required = job.estimate.playbackBytesPerSecond();
+            slowest = job.fileName;
         }
     }
-    if (!working) {
-        QMessageBox::warning(this, "Export Error", "One or more FSEQ files failed to export. See log for details.");
+    double const requiredMBps = required / (1024.0 * 1024.0);
+    if (!speed.valid()) {
+        m_logger->info("No speed test for the selected drive, playback needs up to {:.2f} MB/s", requiredMBps);
+        return true;
+    }
+    //players also seek and read media, leave headroom over the raw data rate
+    if (speed.readMBps >= requiredMBps * 2.0) {
+        return true;
+    }
+    m_logger->warn("Drive reads at {:.1f} MB/s, {} needs {:.2f} MB/s", speed.readMBps, slowest, requiredMBps);
+    auto const ret = QMessageBox::question(this, "Slow SD Card",
+        QString("The selected card reads at %1 MB/s but %2 needs %3 MB/s during playback.\n\n"
+            "Use a faster card or stronger compression. Export anyway?")
+        .arg(speed.readMBps, 0, 'f', 1).arg(slowest.c_str()).arg(requiredMBps, 0, 'f', 2),
+        QMessageBox::Yes | QMessageBox::No);
+    return ret == QMessageBox::Yes;
+}
+
+void MainWindow::runExport(std::vector<ExportJob>& jobs, ExportSettings const& settings, QString const& targetPath)
+{
+    if (!estimateJobs(jobs, settings)) {
+        return;
+    }
+    StorageSpeed const speed = cachedStorageSpeed(targetPath);
+    if (!confirmCardSpeed(jobs, speed)) {
+        return;
+    }
+    QStorageInfo const storage(targetPath);
+    auto const plan = BuildExportPlan(jobs, storage.bytesAvailable(), storage.blockSize(), storage.fileSystemType().toStdString());
+    m_logger->info("Export plan: {} bytes needed, {} available, {} reclaimed", plan.requiredBytes(), plan.availableBytes, plan.reclaimedBytes());
+    ExportPlanDialog planDialog(plan, m_ui->comboBoxSDCard->currentText(), this);
+    if (planDialog.exec() != QDialog::Accepted) {
         return;
     }
-    QMessageBox::information(this, "Export Complete", "FSEQ files have been exported to the SD Card.");
+    uint64_t totalBytes{ 0 };
+    for (auto const& job : jobs) {
+        totalBytes += job.estimate.estimatedBytes;
+    }
+
+    ExportProgress progress(this, totalBytes, speed.writeMBps);
+    bool working{ true };
+    ExportRunReport runReport;
+    QElapsedTimer runTimer;
+    runTimer.start();
+    for (auto const& job : jobs) {
+        QString const label = job.controller.empty() ? QString("Exporting %1...").arg(job.fileName.c_str()) :
+            QString("Exporting %1 to %2...").arg(job.fileName.c_str()).arg(job.controller.c_str());
+        progress.beginFile(label, job.estimate.estimatedBytes);
+        QDir().mkpath(QFileInfo(QString::fromStdString(job.destination)).absolutePath());
+        m_logger->info("Exporting {} to {}", job.source, job.destination);
+        std::vector<ExportTarget> const targets{ { job.controller, job.device, job.destination, job.ranges, job.transform, job.power, job.format, job.eseq } };
+        working &= ExportToTargets(job.source, targets, settings, runReport.files,
+            [&progress](uint32_t frame, uint32_t frames, uint64_t written) { return progress.update(frame, frames, written); });
+        auto& fileReport = runReport.files.back();
+        fileReport.sparseRanges = settings.sparse ? job.ranges.size() : 0;
+        fileReport.paddedChannels = job.paddedChannels;
+        fileReport.trimmedChannels = job.trimmedChannels;
+        progress.endFile(fileReport.outputBytes);
+        if (progress.wasCanceled()) {
+            runReport.cancelled = true;
+            break;
+        }
+    }
+    runReport.wallNanos = runTimer.nsecsElapsed();
+    showExportReport(runReport, working);
 }
 
 void MainWindow::on_comboBoxController_currentIndexChanged(int)
@@ -366,164 +1118,388 @@ void MainWindow::on_comboBoxController_currentIndexChanged(int)
     }
     auto const& controller = m_controllers[idx];
 
-    m_ui->spinBoxStartChannel->setValue(controller.start_channel);
-    m_ui->spinBoxEndChannel->setValue(controller.channels);
+    m_ui->lineEditRanges->setText(QString::fromStdString(FormatRanges(controller.ranges)));
+    m_ui->lineEditRanges->setStyleSheet(QString());
+    m_ui->lineEditColorOrder->setText(QString::fromStdString(FormatColorOrders(controller.colorOrders)));
+    m_ui->lineEditColorOrder->setStyleSheet(QString());
+    m_ui->lineEditChannelMap->setText(QString::fromStdString(controller.channelMapFile));
+    m_ui->lineEditChannelMap->setStyleSheet(!controller.channelMapFile.empty() && !controller.channelMap ? "color: red;" : QString());
+    m_ui->lineEditPowerLimits->setText(QString::fromStdString(FormatPowerLimits(controller.powerLimits)));
+    m_ui->lineEditPowerLimits->setStyleSheet(QString());
+    m_preview->setRanges(controller.ranges);
     //m_logger->info("Selected Controller: {} at {} with {} channels starting at {}", controller.name, controller.ip, controller.totalChannels, controller.startChannel);
 }
 
 void MainWindow::on_checkBoxSparse_stateChanged(int)
 {
-    if (m_ui->checkBoxSparse->isChecked()) {
-        m_ui->spinBoxStartChannel->setEnabled(true);
-        m_ui->spinBoxEndChannel->setEnabled(true);
-    } else {
-        m_ui->spinBoxStartChannel->setEnabled(false);
-        m_ui->spinBoxEndChannel->setEnabled(false);
+    bool const sparse = m_ui->checkBoxSparse->isChecked();
+    m_ui->lineEditRanges->setEnabled(sparse);
+    m_ui->pushButtonEditRanges->setEnabled(sparse);
+    m_ui->checkBoxTrimDark->setEnabled(sparse && m_ui->comboBoxVersion->currentText().section('.', 0, 0).toInt() == 2);
+}
+
+void MainWindow::on_comboBoxVersion_currentIndexChanged(int)
+{
+    on_checkBoxSparse_stateChanged(0);
+}
+
+void MainWindow::on_lineEditRanges_editingFinished()
+{
+    ChannelRanges ranges;
+    if (!ParseRanges(m_ui->lineEditRanges->text().toStdString(), ranges)) {
+        m_ui->lineEditRanges->setStyleSheet("color: red;");
+        m_ui->statusBar->showMessage("Invalid channel ranges, use e.g. 1-510, 1021-1530", 5000);
+        return;
     }
+    m_ui->lineEditRanges->setStyleSheet(QString());
+    m_ui->lineEditRanges->setText(QString::fromStdString(FormatRanges(ranges)));
+    storeControllerRanges(m_ui->comboBoxController->currentIndex(), std::move(ranges));
 }
 
-void MainWindow::refreshList(QFileInfoList const& files)
+void MainWindow::on_lineEditCurve_editingFinished()
 {
-    auto SetItem = [&](int row, FSEQColumn col, QString const& text)
-        {
-            m_ui->tableWidgetFSEQs->setItem(row, std::to_underlying(col), new QTableWidgetItem());
-            m_ui->tableWidgetFSEQs->item(row, std::to_underlying(col))->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-            m_ui->tableWidgetFSEQs->item(row, std::to_underlying(col))->setText(text);
-        };
-    m_ui->tableWidgetFSEQs->clearContents();
-    
-    m_ui->tableWidgetFSEQs->setRowCount(0);
-    m_ui->tableWidgetFSEQs->setRowCount(files.size());
-    int row = 0;
+    std::vector<std::pair<uint8_t, uint8_t>> points;
+    if (!ParseCurvePoints(m_ui->lineEditCurve->text().toStdString(), points)) {
+        m_ui->lineEditCurve->setStyleSheet("color: red;");
+        m_ui->statusBar->showMessage("Invalid curve, use input:output points from 0 to 255, e.g. 0:0, 128:64, 255:200", 5000);
+        return;
+    }
+    m_ui->lineEditCurve->setStyleSheet(QString());
+    m_ui->lineEditCurve->setText(QString::fromStdString(FormatCurvePoints(points)));
+}
 
-    for (const QFileInfo& fileInfo : files) {
-        QTableWidgetItem* checkBoxItem = new QTableWidgetItem();
-        checkBoxItem->setFlags(checkBoxItem->flags() | Qt::ItemIsUserCheckable);
-        checkBoxItem->setCheckState(Qt::Checked);
-        m_ui->tableWidgetFSEQs->setItem(row, std::to_underlying(FSEQColumn::Enabled), checkBoxItem);
-        SetItem(row, FSEQColumn::FileName, fileInfo.fileName());
-        SetItem(row, FSEQColumn::DataModified, fileInfo.lastModified().toString(Qt::ISODate));
-        row++;
+void MainWindow::on_lineEditColorOrder_editingFinished()
+{
+    ColorOrders orders;
+    if (!ParseColorOrders(m_ui->lineEditColorOrder->text().toStdString(), orders)) {
+        m_ui->lineEditColorOrder->setStyleSheet("color: red;");
+        m_ui->statusBar->showMessage("Invalid color order, use e.g. 1-510:GRB, 1021-1530:BRGW", 5000);
+        return;
+    }
+    m_ui->lineEditColorOrder->setStyleSheet(QString());
+    m_ui->lineEditColorOrder->setText(QString::fromStdString(FormatColorOrders(orders)));
+    int const idx = m_ui->comboBoxController->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(m_controllers.size())) {
+        return;
+    }
+    auto& controller = m_controllers[idx];
+    controller.colorOrders = std::move(orders);
+    if (controller.colorOrders.empty()) {
+        m_settings->remove(controllerKey("ColorOrders", controller.name));
+    } else {
+        m_settings->setValue(controllerKey("ColorOrders", controller.name), QString::fromStdString(FormatColorOrders(controller.colorOrders)));
     }
-    m_ui->tableWidgetFSEQs->resizeColumnsToContents();
-    m_ui->tableWidgetFSEQs->horizontalHeader()->setStretchLastSection(true);
 }
 
-void MainWindow::loadControllerFile(const QString& filename)
+void MainWindow::on_lineEditPowerLimits_editingFinished()
 {
-    m_logger->info("Loading xLights Controller File: {}", filename.toStdString());
-    m_ui->comboBoxController->clear();
-    m_controllers.clear();
-    pugi::xml_document doc;
+    PowerLimits limits;
+    if (!ParsePowerLimits(m_ui->lineEditPowerLimits->text().toStdString(), limits)) {
+        m_ui->lineEditPowerLimits->setStyleSheet("color: red;");
+        m_ui->statusBar->showMessage("Invalid power limits, use channels:mA per channel:amps, e.g. 1-510:20mA:5A, 1021-1530:12mA:7.5A", 5000);
+        return;
+    }
+    m_ui->lineEditPowerLimits->setStyleSheet(QString());
+    m_ui->lineEditPowerLimits->setText(QString::fromStdString(FormatPowerLimits(limits)));
+    int const idx = m_ui->comboBoxController->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(m_controllers.size())) {
+        return;
+    }
+    auto& controller = m_controllers[idx];
+    controller.powerLimits = std::move(limits);
+    if (controller.powerLimits.empty()) {
+        m_settings->remove(controllerKey("PowerLimits", controller.name));
+    } else {
+        m_settings->setValue(controllerKey("PowerLimits", controller.name), QString::fromStdString(FormatPowerLimits(controller.powerLimits)));
+    }
+}
 
-    pugi::xml_parse_result result = doc.load_file(filename.toStdString().c_str());
-    pugi::xml_node networks = doc.child("Networks");
-    if(!networks) {
-        m_logger->error("No Networks node found in the controller file: {}", filename.toStdString());
+void MainWindow::on_lineEditChannelMap_editingFinished()
+{
+    int const idx = m_ui->comboBoxController->currentIndex();
+    if (idx < 0 || idx >= static_cast<int>(m_controllers.size())) {
         return;
     }
-    uint64_t startChannel{ 1 };
-    for (pugi::xml_node controller = networks.child("Controller"); controller; controller = controller.next_sibling("Controller")) {
-        auto name = controller.attribute("Name").value();
-        auto ip = controller.attribute("IP").value();
+    auto& controller = m_controllers[idx];
+    QString const path = m_ui->lineEditChannelMap->text().trimmed();
+    std::string error;
+    if (!setChannelMap(controller, path, error)) {
+        m_ui->lineEditChannelMap->setStyleSheet("color: red;");
+        m_ui->statusBar->showMessage(QString("Invalid channel map, %1").arg(QString::fromStdString(error)), 5000);
+        return;
+    }
+    m_ui->lineEditChannelMap->setStyleSheet(QString());
+    if (path.isEmpty()) {
+        m_settings->remove(controllerKey("ChannelMap", controller.name));
+    } else {
+        m_settings->setValue(controllerKey("ChannelMap", controller.name), path);
+    }
+}
 
-        int totalChannels = {0};
-        for (pugi::xml_node network = controller.child("network"); network; network = network.next_sibling("network")) {
-            int size = network.attribute("MaxChannels").as_int();
-            totalChannels += size;
-        }
-        if(totalChannels != 0) {
-            m_logger->debug("Found Controller: {} at {} with {} channels starting at {}", name, ip, totalChannels, startChannel);
-            m_controllers.emplace_back(name, ip, startChannel, totalChannels);
-            m_ui->comboBoxController->addItem(QString("%1 (%2)").arg(name).arg(ip));
-        } else {
-            m_logger->warn("Found Controller: {} at {} with 0 channels, skipping", name, ip);
-        }
-        startChannel += totalChannels;
+void MainWindow::on_pushButtonChannelMap_clicked()
+{
+    QString const current = m_ui->lineEditChannelMap->text();
+    QString const dir = current.isEmpty() ? m_fseqFolder : QFileInfo(current).absolutePath();
+    auto const fn = QFileDialog::getOpenFileName(this, "Select Channel Map", dir, "Channel Maps (*.txt *.map);;All Files (*)");
+    if (fn.isEmpty()) {
+        return;
     }
+    m_ui->lineEditChannelMap->setText(QDir::toNativeSeparators(fn));
+    on_lineEditChannelMap_editingFinished();
 }
 
-void MainWindow::searchForFSEQs()
+bool MainWindow::setChannelMap(Controller& controller, QString const& path, std::string& error)
 {
-    QDir dir(m_fseqFolder);
-    QFileInfoList files = dir.entryInfoList(QStringList() << "*.fseq", QDir::Files | QDir::NoDotAndDotDot);
+    controller.channelMapFile = path.toStdString();
+    controller.channelMap.reset();
+    if (path.isEmpty()) {
+        return true;
+    }
+    ChannelMap map;
+    if (!LoadChannelMap(controller.channelMapFile, map, error)) {
+        m_logger->warn("Channel map {} for {} not loaded, {}", controller.channelMapFile, controller.name, error);
+        return false;
+    }
+    auto plan = std::make_shared<GatherPlan>(map);
+    m_logger->info("Channel map {} for {}: {} channels, {}", controller.channelMapFile, controller.name, plan->mapped(), plan->summary());
+    controller.channelMap = std::move(plan);
+    return true;
+}
 
-    if (files.isEmpty()) {
-        m_logger->warn("No .fseq files found in the directory: {}", m_fseqFolder.toStdString());
+void MainWindow::on_pushButtonEditRanges_clicked()
+{
+    int const idx = m_ui->comboBoxController->currentIndex();
+    bool const hasController = idx >= 0 && idx < static_cast<int>(m_controllers.size());
+    ChannelRanges ranges;
+    if (!ParseRanges(m_ui->lineEditRanges->text().toStdString(), ranges) && hasController) {
+        ranges = m_controllers[idx].ranges;
+    }
+    RangeEditorDialog dialog(hasController ? QString::fromStdString(m_controllers[idx].name) : QString("Export"),
+        ranges, hasController ? m_controllers[idx].defaultRanges() : ChannelRanges(), this);
+    if (dialog.exec() != QDialog::Accepted) {
         return;
     }
-    refreshList(files);
+    ranges = dialog.ranges();
+    m_ui->lineEditRanges->setStyleSheet(QString());
+    m_ui->lineEditRanges->setText(QString::fromStdString(FormatRanges(ranges)));
+    storeControllerRanges(idx, std::move(ranges));
+}
 
-    auto const file = m_fseqFolder + QDir::separator() + "xlights_networks.xml";
+QString MainWindow::controllerKey(QString const& group, std::string const& name) const
+{
+    return group + "/" + QString::fromStdString(name).replace('/', '_').replace('\\', '_');
+}
 
-    if (QFile::exists(file)) {
-        loadControllerFile(file);
+void MainWindow::storeControllerRanges(int idx, ChannelRanges ranges)
+{
+    if (idx < 0 || idx >= static_cast<int>(m_controllers.size())) {
+        return;
+    }
+    auto& controller = m_controllers[idx];
+    controller.setRanges(std::move(ranges));
+    m_preview->setRanges(controller.ranges);
+    //only edits are stored so a changed networks or model file still comes through
+    if (controller.ranges == controller.defaultRanges()) {
+        m_settings->remove(controllerKey("ControllerRanges", controller.name));
     } else {
-        m_logger->warn("No xLights Controller File found in the FSEQ folder.");
+        m_settings->setValue(controllerKey("ControllerRanges", controller.name), QString::fromStdString(FormatRanges(controller.ranges)));
     }
 }
-void MainWindow::searchForUSBs()
+
+void MainWindow::refreshList(QFileInfoList const& files)
 {
-    m_ui->comboBoxSDCard->clear();
-    auto const mountedVolumes = QStorageInfo::mountedVolumes();
-    for ( QStorageInfo const& storage : mountedVolumes) {
-        if (storage.isReady() && storage.isValid()) {
-            m_ui->comboBoxSDCard->addItem(storage.displayName() + " (" + storage.rootPath() + ")", storage.rootPath());
-            qDebug() << "  Device:" << storage.device();
-            qDebug() << "  Name:" << storage.name();
-            qDebug() << "  Root Path:" << storage.rootPath();
-            qDebug() << "  File System Type:" << storage.fileSystemType();
+    m_fseqModel->setFiles(files);
+}
+
+std::vector<FSEQEntry> MainWindow::selectedFSEQs() const
+{
+    //visible rows in view order, so the filter doubles as a selection aid
+    std::vector<FSEQEntry> fseqs;
+    for (int row = 0; row < m_fseqProxy->rowCount(); ++row) {
+        auto const source = m_fseqProxy->mapToSource(m_fseqProxy->index(row, 0));
+        auto const& entry = m_fseqModel->entry(source.row());
+        if (entry.checked) {
+            fseqs.push_back(entry);
         }
     }
+    return fseqs;
 }
 
-bool MainWindow::exportFSEQFile(std::string const& in_path, std::string const& out_path,int major_ver, int minor_ver, V2FSEQFile::CompressionType compressionType, std::vector<std::pair<uint32_t, uint32_t>> ranges, bool sparse, int compressionLevel)
+QString MainWindow::profilesPath() const
 {
-    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(in_path));
-    if (nullptr == src) {
-        spdlog::critical("Error opening input file: {}", in_path);
-        return false;
+    return m_appdir + "/controller_profiles.json";
+}
+
+void MainWindow::loadProfiles()
+{
+    m_profiles = ControllerProfiles();
+    std::string error;
+    QFile builtIn(":/controller_gen/controller_profiles.json");
+    if (!builtIn.open(QIODevice::ReadOnly) || !m_profiles.load(builtIn.readAll().toStdString(), error)) {
+        m_logger->error("Built-in controller profiles not loaded, {}", error);
     }
-    uint32_t channelCount{ 0 };
-    for (auto const& [start, count] : ranges) {
-        channelCount += count;
-    }
-    uint32_t const ogNumber_of_Frames = src->getNumFrames();
-    uint32_t const ogNum_Channels = src->getChannelCount();
-    int const ogFrame_Rate = src->getStepTime();
-    if (ranges.empty()) {
-        ranges.push_back(std::pair<uint32_t, uint32_t>(0, ogNum_Channels));
-        channelCount = ogNum_Channels;
-    }
-    std::unique_ptr<FSEQFile> dest(FSEQFile::createFSEQFile(out_path,
-        major_ver,
-        compressionType,
-        compressionLevel));
-    if (nullptr == dest) {
-        spdlog::critical("Failed to create Dest FSEQ file: {}", out_path);
-        return false;
+    QFile overrides(profilesPath());
+    if (overrides.exists()) {
+        if (!overrides.open(QIODevice::ReadOnly) || !m_profiles.load(overrides.readAll().toStdString(), error)) {
+            m_logger->warn("Controller profiles in {} not loaded, {}", profilesPath().toStdString(), error);
+        }
     }
-    dest->enableMinorVersionFeatures(minor_ver);
+    m_logger->info("{} controller profiles", m_profiles.profiles().size());
+}
 
-    if (major_ver == 2 && sparse) {
-        V2FSEQFile* f = (V2FSEQFile*)dest.get();
-        f->m_sparseRanges = ranges;
+std::shared_ptr<const ControllerProfile> MainWindow::controllerProfile(Controller const& controller) const
+{
+    if (!m_ui->actionUse_Controller_Profiles->isChecked()) {
+        return nullptr;
+    }
+    auto const* profile = m_profiles.find(controller.vendor, controller.model);
+    if (profile == nullptr) {
+        m_logger->info("No controller profile for {} ({} {})", controller.name, controller.vendor, controller.model);
+        return nullptr;
     }
-    src->prepareRead(ranges);
+    return std::make_shared<const ControllerProfile>(*profile);
+}
+
+void MainWindow::loadControllerFile(const QString& filename)
+{
+    m_logger->info("Loading xLights Controller File: {}", filename.toStdString());
+    applyControllers(LoadControllerFile(filename.toStdString()));
+}
 
-    dest->initializeFromFSEQ(*src);
-    dest->setChannelCount(channelCount);
-    dest->writeHeader();
+void MainWindow::applyControllers(std::vector<Controller> controllers)
+{
+    m_ui->comboBoxController->clear();
+    m_controllers = std::move(controllers);
+    for (auto& controller : m_controllers) {
+        auto const key = controllerKey("ControllerRanges", controller.name);
+        ChannelRanges ranges;
+        if (m_settings->contains(key) && ParseRanges(m_settings->value(key).toString().toStdString(), ranges)) {
+            m_logger->info("Using edited channel ranges for {}: {}", controller.name, FormatRanges(ranges));
+            controller.setRanges(std::move(ranges));
+        }
+        ColorOrders orders;
+        if (ParseColorOrders(m_settings->value(controllerKey("ColorOrders", controller.name)).toString().toStdString(), orders)) {
+            controller.colorOrders = std::move(orders);
+        }
+        PowerLimits limits;
+        if (ParsePowerLimits(m_settings->value(controllerKey("PowerLimits", controller.name)).toString().toStdString(), limits)) {
+            controller.powerLimits = std::move(limits);
+        }
+        std::string error;
+        setChannelMap(controller, m_settings->value(controllerKey("ChannelMap", controller.name)).toString(), error);
+        m_ui->comboBoxController->addItem(QString("%1 (%2)").arg(controller.name.c_str()).arg(controller.ip.c_str()));
+    }
+}
 
-    uint8_t* data = (uint8_t*)malloc(8024 * 1024);
-    for (int x = 0; x < src->getNumFrames(); x++) {
-        FSEQFile::FrameData* fdata = src->getFrame(x);
-        fdata->readFrame(data, 8024 * 1024);
-        delete fdata;
+void MainWindow::searchForFSEQs()
+{
+    uint64_t const generation = ++m_scanGeneration;
+    m_fseqModel->clear();
+    m_ui->statusBar->showMessage(QString("Scanning %1...").arg(m_fseqFolder));
 
-        dest->addFrame(x, data);
+    //the folder may be on a slow network share, list it in the background and
+    //hand the files to the model in batches as they are found
+    QString const folder = m_fseqFolder;
+    m_workerPool.start([this, generation, folder]() {
+        QElapsedTimer timer;
+        timer.start();
+        if (!QDir(folder).exists()) {
+            m_logger->warn("FSEQ folder does not exist: {}", folder.toStdString());
+            QMetaObject::invokeMethod(this, [this, generation, folder]() {
+                if (generation == m_scanGeneration) {
+                    m_ui->statusBar->showMessage(QString("Folder not found: %1").arg(folder), 5000);
+                }
+                }, Qt::QueuedConnection);
+            return;
+        }
+        qsizetype total{ 0 };
+        QFileInfoList batch;
+        auto postBatch = [&]() {
+            total += batch.size();
+            QMetaObject::invokeMethod(this, [this, generation, batch, total]() {
+                if (generation == m_scanGeneration) {
+                    m_fseqModel->appendFiles(batch);
+                    m_ui->statusBar->showMessage(QString("Found %1 FSEQ files...").arg(total));
+                }
+                }, Qt::QueuedConnection);
+            batch.clear();
+        };
+        QDirIterator it(folder, QStringList() << "*.fseq", QDir::Files | QDir::NoDotAndDotDot);
+        while (it.hasNext() && generation == m_scanGeneration) {
+            it.next();
+            batch.append(it.fileInfo());
+            if (batch.size() >= 256) {
+                postBatch();
+            }
+        }
+        postBatch();
+        m_logger->info("Scanned {} in {} ms, {} FSEQ files ({} ms since startup)", folder.toStdString(), timer.elapsed(), total, m_startupTimer.elapsed());
+        if (total == 0) {
+            m_logger->warn("No .fseq files found in the directory: {}", folder.toStdString());
+            return;
+        }
+
+        auto const file = folder + QDir::separator() + "xlights_networks.xml";
+        if (!QFile::exists(file)) {
+            m_logger->warn("No xLights Controller File found in the FSEQ folder.");
+            return;
+        }
+        m_logger->info("Loading xLights Controller File: {}", file.toStdString());
+        auto controllers = LoadControllerFile(file.toStdString());
+        QMetaObject::invokeMethod(this, [this, generation, controllers = std::move(controllers)]() mutable {
+            if (generation == m_scanGeneration) {
+                applyControllers(std::move(controllers));
+            }
+            }, Qt::QueuedConnection);
+        m_logger->info("Loaded controllers {} ms since startup", m_startupTimer.elapsed());
+    });
+}
+
+void MainWindow::searchForUSBs()
+{
+    m_volumeWatcher->rescan();
+}
+
+void MainWindow::updateVolumes(QList<VolumeInfo> const& volumes)
+{
+    auto const current = m_ui->comboBoxSDCard->currentData().toString();
+    m_volumes = volumes;
+    m_ui->comboBoxSDCard->clear();
+    for (VolumeInfo const& volume : volumes) {
+        m_ui->comboBoxSDCard->addItem(volume.label(), volume.rootPath);
+        m_logger->debug("Volume: {} {} {} {}", volume.device.toStdString(), volume.rootPath.toStdString(),
+            volume.fileSystemType.toStdString(), volume.removable ? "removable" : "fixed");
     }
-    free(data);
-    dest->finalize();
-    return true;
+    int const idx = m_ui->comboBoxSDCard->findData(current);
+    if (idx >= 0) {
+        m_ui->comboBoxSDCard->setCurrentIndex(idx);
+    }
+    m_logger->info("Volumes changed, {} usable ({} ms since startup)", volumes.size(), m_startupTimer.elapsed());
+}
+
+void MainWindow::showExportReport(ExportRunReport const& report, bool working)
+{
+    m_logger->info("Export summary:\n{}", report.summary());
+    QString const reportPath = m_appdir + "/log/" + QString("export_report_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    if (!report.writeJson(reportPath.toStdString())) {
+        m_logger->warn("Failed to write export report: {}", reportPath.toStdString());
+    }
+
+    QMessageBox msgBox(this);
+    if (report.cancelled) {
+        msgBox.setIcon(QMessageBox::Warning);
+        msgBox.setWindowTitle("Export Cancelled");
+        msgBox.setText("The export was aborted, files already written were kept.");
+    } else if (!working) {
+        msgBox.setIcon(QMessageBox::Warning);
+        msgBox.setWindowTitle("Export Error");
+        msgBox.setText("One or more FSEQ files failed to export. See log for details.");
+    } else {
+        msgBox.setIcon(QMessageBox::Information);
+        msgBox.setWindowTitle("Export Complete");
+        msgBox.setText("FSEQ files have been exported to the SD Card.");
+    }
+    msgBox.setInformativeText(QString::fromStdString(report.summary()));
+    msgBox.setDetailedText(QString::fromStdString(report.details()) + "\nReport: " + reportPath);
+    msgBox.exec();
 }
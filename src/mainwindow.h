@@ -5,6 +5,8 @@
 #include <QNetworkReply>
 #include <QSettings>
 #include <QFileInfoList>
+#include <QThreadPool>
+#include <QElapsedTimer>
 
 #include "spdlog/spdlog.h"
 #include "spdlog/common.h"
@@ -13,13 +15,24 @@
 #include <atomic>
 
 #include "FSEQFile.h"
+#include "controller.h"
+#include "controller_profile.h"
+#include "channel_activity.h"
+#include "export_job.h"
+#include "export_report.h"
+#include "storage_probe.h"
+#include "volume_watcher.h"
 
 namespace Ui {
 class MainWindow;
 }
 
-struct Controller;
+struct FSEQEntry;
 class AutoUpdater;
+class FSEQTableModel;
+class QProgressDialog;
+class QSortFilterProxyModel;
+class SequencePreviewDock;
 
 class MainWindow : public QMainWindow
 {
@@ -37,12 +50,28 @@ private slots:
     void on_actionOpen_Log_triggered();
     void on_actionAbout_triggered();
     void on_actionAbout_QT_triggered();
+    void on_actionShow_All_Drives_toggled(bool checked);
+    void on_actionRecord_Trace_toggled(bool checked);
+    void on_actionUse_Controller_Profiles_toggled(bool checked);
+    void on_actionCalibrate_Controller_Profiles_triggered();
 
     void on_pushButtonExport_clicked();
     void on_pushButtonExportAll_clicked();
+    void on_pushButtonExportCards_clicked();
+    void on_actionExport_ESEQ_triggered();
     void on_pushButtonRefresh_clicked();
+    void on_pushButtonSpeedTest_clicked();
+    void on_comboBoxSDCard_currentIndexChanged(int);
     void on_comboBoxController_currentIndexChanged(int);
     void on_checkBoxSparse_stateChanged(int);
+    void on_comboBoxVersion_currentIndexChanged(int);
+    void on_lineEditRanges_editingFinished();
+    void on_pushButtonEditRanges_clicked();
+    void on_lineEditCurve_editingFinished();
+    void on_lineEditColorOrder_editingFinished();
+    void on_lineEditPowerLimits_editingFinished();
+    void on_lineEditChannelMap_editingFinished();
+    void on_pushButtonChannelMap_clicked();
 private:
     Ui::MainWindow* m_ui;
     QNetworkAccessManager* m_manager;
@@ -56,14 +85,51 @@ private:
     QString m_title;
 
     std::vector<Controller> m_controllers;
-
-    bool exportFSEQFile(std::string const& in_path, std::string const& out_path, 
-        int major_ver, int minor_ver, V2FSEQFile::CompressionType, 
-        std::vector<std::pair<uint32_t, uint32_t>> ranges, bool sparse, int compressionLevel = -99);
-
-
+    ControllerProfiles m_profiles;
+
+    FSEQTableModel* m_fseqModel{ nullptr };
+    QSortFilterProxyModel* m_fseqProxy{ nullptr };
+    SequencePreviewDock* m_preview{ nullptr };
+
+    //folder scans, controller parsing and volume enumeration run here, never on the UI thread
+    QThreadPool m_workerPool;
+    std::atomic<uint64_t> m_scanGeneration{ 0 };
+    QElapsedTimer m_startupTimer;
+
+    VolumeWatcher* m_volumeWatcher{ nullptr };
+    QList<VolumeInfo> m_volumes;
+
+    //false after telling the user when a setting does not parse
+    bool exportSettings(ExportSettings& settings);
+    bool estimateJobs(std::vector<ExportJob>& jobs, ExportSettings const& settings);
+    void optimizeRanges(ExportJob& job, ExportSettings const& settings);
+    ChannelActivity scanChannelActivity(std::string const& source, QProgressDialog& progress);
+    void trimDarkChannels(ExportJob& job, ChannelActivity const& activity);
+    bool confirmCardSpeed(std::vector<ExportJob> const& jobs, StorageSpeed const& speed);
+    void runExport(std::vector<ExportJob>& jobs, ExportSettings const& settings, QString const& targetPath);
+    void runMultiExport(std::vector<ExportJob>& jobs, ExportSettings const& settings);
+    QString storageSpeedKey(QString const& rootPath) const;
+    StorageSpeed cachedStorageSpeed(QString const& rootPath) const;
+    void showStorageSpeed();
+    void showExportReport(ExportRunReport const& report, bool working);
+    QString saveTrace();
+
+
+    void startupLoad();
     void loadControllerFile(const QString& filename);
+    //built-in profiles, then the user's overrides
+    void loadProfiles();
+    QString profilesPath() const;
+    //null when profiles are off or none matches
+    std::shared_ptr<const ControllerProfile> controllerProfile(Controller const& controller) const;
+    void applyControllers(std::vector<Controller> controllers);
+    QString controllerKey(QString const& group, std::string const& name) const;
+    void storeControllerRanges(int idx, ChannelRanges ranges);
+    //loads and compiles path, an empty path clears the map
+    bool setChannelMap(Controller& controller, QString const& path, std::string& error);
     void refreshList(QFileInfoList const& files);
+    std::vector<FSEQEntry> selectedFSEQs() const;
     void searchForFSEQs();
     void searchForUSBs();
+    void updateVolumes(QList<VolumeInfo> const& volumes);
 };
@@ -0,0 +1,486 @@
+#include "multi_target_export.h"
+
+#include "spdlog/spdlog.h"
+
+#include "channel_activity.h"
+#include "frame_resampler.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    using FramePtr = std::shared_ptr<const std::vector<uint8_t>>;
+
+    //Frame buffers go back to the pool when the last writer drops them, so a run allocates
+    //about one buffer per queued frame instead of one per frame. Buffers come back holding
+    //the previous frame, ExportFSEQ clears what the decode won't overwrite before the curve.
+    class FramePool
+    {
+    public:
+        FramePool(uint32_t frameSize, size_t capacity) :
+            m_state(std::make_shared<State>())
+        {
+            m_state->frameSize = frameSize;
+            m_state->capacity = capacity;
+        }
+
+        [[nodiscard]] std::shared_ptr<std::vector<uint8_t>> acquire()
+        {
+            std::unique_ptr<std::vector<uint8_t>> buffer;
+            {
+                std::lock_guard<std::mutex> lock(m_state->lock);
+                if (!m_state->free.empty()) {
+                    buffer = std::move(m_state->free.back());
+                    m_state->free.pop_back();
+                }
+            }
+            if (!buffer) {
+                buffer = std::make_unique<std::vector<uint8_t>>(m_state->frameSize);
+            }
+            //the state outlives the pool while frames are still queued
+            return std::shared_ptr<std::vector<uint8_t>>(buffer.release(), [state = m_state](std::vector<uint8_t>* released) {
+                std::unique_ptr<std::vector<uint8_t>> owned(released);
+                std::lock_guard<std::mutex> lock(state->lock);
+                if (state->free.size() < state->capacity) {
+                    state->free.push_back(std::move(owned));
+                }
+            });
+        }
+
+    private:
+        struct State
+        {
+            std::mutex lock;
+            std::vector<std::unique_ptr<std::vector<uint8_t>>> free;
+            uint32_t frameSize{ 0 };
+            size_t capacity{ 0 };
+        };
+        std::shared_ptr<State> m_state;
+    };
+
+    //channels of a size byte frame that reading readRanges from src leaves alone, a sparse
+    //source only fills its own ranges
+    std::vector<std::pair<uint32_t, uint32_t>> UndecodedRanges(FSEQFile const& src,
+        std::vector<std::pair<uint32_t, uint32_t>> const& readRanges, uint32_t size)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> held{ { 0, src.getChannelCount() } };
+        if (auto const* v2 = dynamic_cast<V2FSEQFile const*>(&src); v2 && !v2->m_sparseRanges.empty()) {
+            held = v2->m_sparseRanges;
+        }
+        std::vector<uint8_t> decoded(size, 0);
+        for (auto const& [readStart, readCount] : readRanges) {
+            for (auto const& [heldStart, heldCount] : held) {
+                uint64_t const start = std::max(readStart, heldStart);
+                uint64_t const end = std::min<uint64_t>({ static_cast<uint64_t>(readStart) + readCount, static_cast<uint64_t>(heldStart) + heldCount, size });
+                if (start < end) {
+                    std::fill(decoded.begin() + start, decoded.begin() + end, 1);
+                }
+            }
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> undecoded;
+        for (uint32_t c = 0; c < size;) {
+            if (decoded[c]) {
+                ++c;
+                continue;
+            }
+            uint32_t const start = c;
+            while (c < size && !decoded[c]) {
+                ++c;
+            }
+            undecoded.emplace_back(start, c - start);
+        }
+        return undecoded;
+    }
+
+    struct Output
+    {
+        std::unique_ptr<FSEQFile> dest;
+        ExportFileReport* report{ nullptr };
+        FrameTransform transform;
+        PowerLimiter power;
+        std::vector<uint8_t> scratch;
+        //ranges of a file that isn't sparse, packed from its first channel
+        std::vector<std::pair<uint32_t, uint32_t>> pack;
+        std::vector<uint8_t> packed;
+    };
+
+    class DeviceWriter
+    {
+    public:
+        explicit DeviceWriter(size_t depth) :
+            m_depth(std::max<size_t>(depth, 1))
+        {}
+
+        ~DeviceWriter()
+        {
+            finish(true);
+        }
+
+        void addOutput(std::unique_ptr<FSEQFile> dest, ExportFileReport* report, FrameTransform transform, PowerPorts power,
+            std::vector<std::pair<uint32_t, uint32_t>> pack)
+        {
+            m_outputs.push_back({ std::move(dest), report, std::move(transform), PowerLimiter(std::move(power)), {}, std::move(pack), {} });
+        }
+
+        void start()
+        {
+            m_thread = std::thread([this]() { run(); });
+        }
+
+        //blocks while the queue is full, that is what keeps a slow card from buffering the whole sequence
+        void push(uint32_t frame, FramePtr data)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_notFull.wait(lock, [this]() { return m_queue.size() < m_depth || m_abort; });
+            if (m_abort) {
+                return;
+            }
+            m_queue.emplace_back(frame, std::move(data));
+            m_notEmpty.notify_one();
+        }
+
+        void finish(bool abort)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_done = true;
+                m_abort = m_abort || abort;
+            }
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+        }
+
+        void closeOutputs()
+        {
+            for (auto& output : m_outputs) {
+                output.dest.reset();
+            }
+        }
+
+        [[nodiscard]] uint64_t bytesWritten() const { return m_written; }
+        [[nodiscard]] std::vector<Output> const& outputs() const { return m_outputs; }
+
+    private:
+        void run()
+        {
+            Trace::SetThreadName("writer");
+            for (;;) {
+                std::pair<uint32_t, FramePtr> item;
+                {
+                    std::unique_lock<std::mutex> lock(m_lock);
+                    m_notEmpty.wait(lock, [this]() { return !m_queue.empty() || m_done || m_abort; });
+                    if (m_abort || (m_done && m_queue.empty())) {
+                        break;
+                    }
+                    item = std::move(m_queue.front());
+                    m_queue.pop_front();
+                    m_notFull.notify_one();
+                }
+                TRACE_SCOPE("write frame");
+                uint64_t written{ 0 };
+                for (auto& output : m_outputs) {
+                    const uint8_t* frame = item.second->data();
+                    //the frame is shared with the other targets, this one changes a copy
+                    if (!output.transform.empty() || !output.power.empty()) {
+                        output.scratch.assign(item.second->begin(), item.second->end());
+                        uint32_t const size = static_cast<uint32_t>(output.scratch.size());
+                        output.transform.apply(output.scratch.data(), size);
+                        //limited last, on the values the controller will actually drive
+                        output.power.apply(output.scratch.data(), size, item.first);
+                        frame = output.scratch.data();
+                    }
+                    if (!output.pack.empty()) {
+                        output.packed.resize(output.dest->getChannelCount());
+                        RangeCopy::Gather(output.packed.data(), frame, output.pack.data(), output.pack.size());
+                        frame = output.packed.data();
+                    }
+                    output.dest->addFrame(item.first, frame);
+                    written += output.report->stats.bytes[FSEQFile::Stats::Write];
+                }
+                m_written = written;
+            }
+            if (m_abort) {
+                return;
+            }
+            uint64_t written{ 0 };
+            for (auto& output : m_outputs) {
+                output.dest->finalize();
+                written += output.report->stats.bytes[FSEQFile::Stats::Write];
+            }
+            m_written = written;
+        }
+
+        size_t const m_depth;
+        std::vector<Output> m_outputs;
+        std::thread m_thread;
+        std::mutex m_lock;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+        std::deque<std::pair<uint32_t, FramePtr>> m_queue;
+        bool m_done{ false };
+        bool m_abort{ false };
+        std::atomic<uint64_t> m_written{ 0 };
+    };
+}
+
+bool ExportToTargets(std::string const& source, std::vector<ExportTarget> const& targets, ExportSettings const& settings,
+    std::vector<ExportFileReport>& reports, ExportProgressCallback const& progress, size_t queueDepth)
+{
+    TRACE_SCOPE("ExportToTargets");
+    auto const wallStart = std::chrono::steady_clock::now();
+    size_t const firstReport = reports.size();
+    for (auto const& target : targets) {
+        auto& report = reports.emplace_back();
+        report.source = source;
+        report.destination = target.destination;
+        report.controller = target.controller;
+    }
+    if (targets.empty()) {
+        return true;
+    }
+
+    FSEQFile::Stats decodeStats;
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(source));
+    if (nullptr == src) {
+        spdlog::critical("Error opening input file: {}", source);
+        return false;
+    }
+    src->setStats(&decodeStats);
+    uint32_t const srcChannels = src->getChannelCount();
+    //a sparse source holds fewer channels than its highest one, whole frames run up to that
+    uint32_t const srcFrameSize = std::max(srcChannels, src->getMaxChannel());
+
+    //read the union of what the targets need, or everything if any target takes the whole frame
+    bool wholeFrame = !settings.sparse;
+    std::vector<std::pair<uint32_t, uint32_t>> readRanges;
+    uint32_t frameSize = srcFrameSize;
+    for (auto const& target : targets) {
+        if (target.ranges.empty()) {
+            wholeFrame = true;
+        }
+        //a channel map may route channels in from outside the target's ranges
+        for (auto const& [start, count] : target.transform.sourceRanges(target.ranges)) {
+            readRanges.emplace_back(start, count);
+            frameSize = std::max(frameSize, start + count);
+        }
+        frameSize = std::max(frameSize, target.transform.extent());
+    }
+    if (wholeFrame) {
+        readRanges.assign(1, std::pair<uint32_t, uint32_t>(0, srcFrameSize));
+    }
+
+    uint32_t const sourceFrames = src->getNumFrames();
+    FrameWindow const window = settings.window(sourceFrames, src->getStepTime());
+    if (window.count == 0) {
+        spdlog::critical("Export window {}-{} ms is outside {}", settings.startMS, settings.endMS, source);
+        return false;
+    }
+    if (window.trims(sourceFrames)) {
+        spdlog::info("Exporting frames {}-{} of {}", window.first, window.first + window.count - 1, source);
+    }
+    std::unique_ptr<FrameResampler> resampler;
+    if (settings.stepTime > 0 && settings.stepTime != src->getStepTime()) {
+        resampler = std::make_unique<FrameResampler>(window.count, src->getStepTime(), settings.stepTime, settings.blendFrames, frameSize);
+        spdlog::info("Resampling {} from {} ms to {} ms, {} frames become {}", source, src->getStepTime(), settings.stepTime,
+            window.count, resampler->frames());
+    }
+    //a full frame export decodes everything a statistics scan would, fill the cache on the way
+    std::unique_ptr<ChannelActivityAccumulator> activity;
+    if (wholeFrame && !resampler && !window.trims(sourceFrames) && src->getMaxChannel() == srcChannels && !LoadChannelActivity(source).valid) {
+        activity = std::make_unique<ChannelActivityAccumulator>(srcChannels);
+    }
+    //every target gets the same curve, so it is applied once to the shared frame
+    FrameTransform transform;
+    transform.add(readRanges, settings.curve);
+    if (!transform.empty()) {
+        spdlog::info("Applying brightness {}%, gamma {}, curve '{}' to {} with the {} lookup kernel", settings.curve.brightness, settings.curve.gamma,
+            FormatCurvePoints(settings.curve.points), source, LutTransform::KernelName(LutTransform::ActiveKernel()));
+    }
+
+    std::map<std::string, std::unique_ptr<DeviceWriter>> writers;
+    std::vector<uint32_t> channelCounts(targets.size());
+    for (size_t x = 0; x < targets.size(); ++x) {
+        auto const& target = targets[x];
+        auto& report = reports[firstReport + x];
+        ExportSettings const format = target.format ? settings.with(*target.format) : settings;
+        std::unique_ptr<FSEQFile> dest;
+        if (!target.eseq) {
+            dest.reset(FSEQFile::createFSEQFile(target.destination, format.major_ver, format.compressionType, format.compressionLevel));
+        } else if (target.ranges.size() == 1) {
+            dest.reset(FSEQFile::createESEQFile(target.destination, target.ranges[0].first, target.ranges[0].second));
+        }
+        if (nullptr == dest) {
+            spdlog::critical("Failed to create Dest FSEQ file: {}", target.destination);
+            writers.clear();
+            std::error_code ec;
+            for (size_t y = 0; y < x; ++y) {
+                std::filesystem::remove(targets[y].destination, ec);
+            }
+            return false;
+        }
+        uint32_t channelCount{ 0 };
+        for (auto const& [start, count] : target.ranges) {
+            channelCount += count;
+        }
+        if (target.ranges.empty()) {
+            channelCount = srcFrameSize;
+        }
+        channelCounts[x] = channelCount;
+        report.compressed = !target.eseq && format.major_ver == 2 && format.compressionType != FSEQFile::CompressionType::none;
+        dest->enableMinorVersionFeatures(format.minor_ver);
+        dest->setStats(&report.stats);
+        bool const sparse = !target.eseq && format.major_ver == 2 && format.sparse && !target.ranges.empty();
+        if (sparse) {
+            static_cast<V2FSEQFile*>(dest.get())->m_sparseRanges = target.ranges;
+        }
+        dest->initializeFromFSEQ(*src);
+        if (window.trims(sourceFrames)) {
+            TrimExportHeader(*dest, window);
+        }
+        if (resampler) {
+            dest->setStepTime(resampler->stepTime());
+            dest->setNumFrames(resampler->frames());
+        }
+        if (target.eseq && dest->getStepTime() != ESEQFile::StepTime) {
+            spdlog::warn("ESEQ files have no step time, {} holds {} ms frames that play at {} ms",
+                target.destination, dest->getStepTime(), ESEQFile::StepTime);
+        }
+        //sparse headers clip their ranges against the source channel count and sum them up themselves
+        if (!sparse) {
+            dest->setChannelCount(channelCount);
+        }
+        dest->writeHeader();
+
+        if (!target.power.empty()) {
+            spdlog::info("Limiting {} power ports of {} with the {} sum kernel", target.power.size(), target.destination,
+                RangeCopy::KernelName(ChannelSum::ActiveKernel()));
+        }
+        auto& writer = writers[target.device];
+        if (!writer) {
+            writer = std::make_unique<DeviceWriter>(queueDepth);
+        }
+        //without sparse ranges in the header the file holds the ranges back to back
+        std::vector<std::pair<uint32_t, uint32_t>> pack;
+        if (!sparse && !target.eseq && !target.ranges.empty()) {
+            pack = target.ranges;
+            spdlog::warn("{} is a V{}.{} file without sparse ranges, its {} ranges are packed from channel 1",
+                target.destination, format.major_ver, format.minor_ver, pack.size());
+        }
+        writer->addOutput(std::move(dest), &report, target.transform, target.power, std::move(pack));
+    }
+    //reading starts in the compressed block holding the first frame of the window
+    src->prepareRead(readRanges, window.first);
+    for (auto& [device, writer] : writers) {
+        writer->start();
+    }
+
+    //frames are numbered from the start of the window
+    auto const decode = [&src, &decodeStats, first = window.first](uint32_t frame, uint8_t* buffer, uint32_t size) {
+        std::unique_ptr<FSEQFile::FrameData> fdata(src->getFrame(first + frame));
+        auto const extractStart = std::chrono::steady_clock::now();
+        //a frame that can't be read goes out dark instead of repeating what the buffer held
+        if (!fdata || !fdata->readFrame(buffer, size)) {
+            std::memset(buffer, 0, size);
+        }
+        decodeStats.nanos[FSEQFile::Stats::Extract] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - extractStart).count();
+        decodeStats.bytes[FSEQFile::Stats::Extract] += size;
+    };
+    uint32_t const frames = resampler ? resampler->frames() : window.count;
+    //a pooled buffer still holds the last frame through the curve, the resampler copies whole
+    //frames but a decode only rewrites the channels the source holds
+    std::vector<std::pair<uint32_t, uint32_t>> undecoded;
+    if (!resampler && !transform.empty()) {
+        undecoded = UndecodedRanges(*src, readRanges, frameSize);
+    }
+    //every queue full plus the frame being decoded and the one each writer holds
+    FramePool pool(frameSize, (queueDepth + 1) * writers.size() + 1);
+    bool cancelled{ false };
+    for (uint32_t x = 0; x < frames && !cancelled; x++) {
+        //readFrame scatters each range to its absolute channel offset, so one buffer serves every target
+        auto data = pool.acquire();
+        for (auto const& [start, count] : undecoded) {
+            std::memset(data->data() + start, 0, count);
+        }
+        if (resampler) {
+            resampler->frame(x, data->data(), decode);
+        } else {
+            decode(x, data->data(), frameSize);
+        }
+        //statistics describe the source, so they see the frame before the curve
+        if (activity) {
+            activity->add(data->data());
+        }
+        if (!transform.empty()) {
+            TRACE_SCOPE("transform frame");
+            transform.apply(data->data(), frameSize);
+        }
+        FramePtr frame = std::move(data);
+        for (auto& [device, writer] : writers) {
+            writer->push(x, frame);
+        }
+        if (progress) {
+            uint64_t written{ 0 };
+            for (auto const& [device, writer] : writers) {
+                written += writer->bytesWritten();
+            }
+            cancelled = !progress(x + 1, frames, written);
+        }
+    }
+
+    for (auto& [device, writer] : writers) {
+        writer->finish(cancelled);
+        writer->closeOutputs();
+        for (auto const& output : writer->outputs()) {
+            output.report->powerLimitedFrames = output.power.limitedFrames();
+            output.report->powerLimits = output.power.summary();
+            if (!cancelled && output.power.limitedFrames() != 0) {
+                spdlog::warn("{} frames of {} power limited\n{}", output.power.limitedFrames(), output.report->destination, output.report->powerLimits);
+            }
+        }
+    }
+    if (!cancelled && activity) {
+        SaveChannelActivity(source, activity->result(src->getUniqueId()));
+    }
+    auto const wallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wallStart).count();
+    std::error_code ec;
+    auto const sourceBytes = std::filesystem::file_size(source, ec);
+    for (size_t x = 0; x < targets.size(); ++x) {
+        auto& report = reports[firstReport + x];
+        if (cancelled) {
+            std::filesystem::remove(report.destination, ec);
+            continue;
+        }
+        report.frames = frames;
+        report.sourceBytes = sourceBytes;
+        report.outputBytes = report.stats.bytes[FSEQFile::Stats::Write];
+        report.rawBytes = static_cast<uint64_t>(frames) * channelCounts[x];
+        report.wallNanos = wallNanos;
+        report.ok = true;
+    }
+    //the shared decode is charged once, to the first target
+    reports[firstReport].stats.add(decodeStats);
+    if (!cancelled) {
+        for (size_t x = firstReport; x < reports.size(); ++x) {
+            spdlog::info("Exported {} in {} ms, bottleneck {}", reports[x].destination, reports[x].wallNanos / 1000000,
+                FSEQFile::Stats::StageStrings[reports[x].bottleneck()]);
+        }
+    }
+    if (cancelled) {
+        spdlog::warn("Export of {} aborted, partial files removed", source);
+    }
+    return !cancelled;
+}
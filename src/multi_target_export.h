@@ -0,0 +1,31 @@
+#pragma once
+
+#include "export_job.h"
+#include "export_report.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ExportTarget
+{
+    std::string controller;
+    std::string device;      //targets on the same device share one writer thread
+    std::string destination;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    //applied to a copy of the shared frame for this target only
+    FrameTransform transform;
+    PowerPorts power;
+    //file format of this target, the settings' when unset
+    std::optional<ExportFormat> format;
+    //writes an ESEQ of ranges, which must be a single range, and ignores format
+    bool eseq{ false };
+};
+
+//Decodes source once and feeds every target from the same frames. Each device
+//gets its own writer thread behind a bounded queue, so a run takes as long as the
+//slowest card rather than the sum of all of them. reports gets one entry per target.
+bool ExportToTargets(std::string const& source, std::vector<ExportTarget> const& targets, ExportSettings const& settings,
+    std::vector<ExportFileReport>& reports, ExportProgressCallback const& progress = nullptr, size_t queueDepth = 32);
@@ -0,0 +1,222 @@
+#include "power_limiter.h"
+
+#include "frame_transform.h"
+#include "kernel_dispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHANNEL_SUM_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CHANNEL_SUM_TARGET(x)
+#else
+#define CHANNEL_SUM_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+PowerLimiter::PowerLimiter(PowerPorts ports) :
+    m_ports(std::move(ports))
+{
+    m_ports.erase(std::remove_if(m_ports.begin(), m_ports.end(),
+        [](auto const& port) { return port.count == 0 || port.amps <= 0.0 || port.milliampsPerChannel <= 0.0; }), m_ports.end());
+    for (auto const& port : m_ports) {
+        //a channel at 255 draws milliampsPerChannel
+        double const budget = port.amps * 1000.0 / port.milliampsPerChannel * 255.0;
+        m_budgets.push_back(static_cast<uint64_t>(std::min(budget, 255.0 * port.count)));
+    }
+    m_reports.resize(m_ports.size());
+}
+
+unsigned PowerLimiter::apply(uint8_t* frame, uint32_t size, uint32_t frameNumber)
+{
+    unsigned limited{ 0 };
+    for (size_t x = 0; x < m_ports.size(); ++x) {
+        auto const& port = m_ports[x];
+        if (port.start >= size) {
+            continue;
+        }
+        uint8_t* data = frame + port.start;
+        uint32_t const count = std::min(port.count, size - port.start);
+        uint64_t const sum = ChannelSum::Sum(data, count);
+        auto& report = m_reports[x];
+        report.peakAmps = std::max(report.peakAmps, sum / 255.0 * port.milliampsPerChannel / 1000.0);
+        uint64_t const budget = m_budgets[x];
+        if (sum <= budget) {
+            continue;
+        }
+        //rounding every value down keeps the scaled sum within the budget
+        ChannelLut lut;
+        for (uint32_t v = 0; v < 256; ++v) {
+            lut[v] = static_cast<uint8_t>(v * budget / sum);
+        }
+        LutTransform::Apply(data, count, lut);
+
+        ++limited;
+        ++report.limitedFrames;
+        report.minScale = std::min(report.minScale, static_cast<double>(budget) / sum);
+        if (!report.frames.empty() && report.frames.back().second + 1 == frameNumber) {
+            report.frames.back().second = frameNumber;
+        } else {
+            report.frames.emplace_back(frameNumber, frameNumber);
+        }
+    }
+    if (limited != 0) {
+        ++m_limitedFrames;
+    }
+    return limited;
+}
+
+std::string PowerLimiter::summary() const
+{
+    //long shows dim hundreds of separate runs, the first few say where to look
+    constexpr size_t ListedRuns = 8;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    for (size_t x = 0; x < m_ports.size(); ++x) {
+        auto const& report = m_reports[x];
+        if (report.limitedFrames == 0) {
+            continue;
+        }
+        auto const& port = m_ports[x];
+        out << (out.tellp() > 0 ? "\n" : "") << port.start + 1 << "-" << port.start + port.count << ": " << report.limitedFrames << " frames (";
+        for (size_t r = 0; r < report.frames.size() && r < ListedRuns; ++r) {
+            out << (r != 0 ? ", " : "") << report.frames[r].first;
+            if (report.frames[r].second != report.frames[r].first) {
+                out << "-" << report.frames[r].second;
+            }
+        }
+        if (report.frames.size() > ListedRuns) {
+            out << ", ...";
+        }
+        out << "), peak " << report.peakAmps << " A of " << port.amps << " A, down to " << std::setprecision(0)
+            << report.minScale * 100.0 << "%" << std::setprecision(1);
+    }
+    return out.str();
+}
+
+namespace ChannelSum
+{
+    namespace
+    {
+        using SumFn = uint64_t (*)(const uint8_t*, size_t);
+
+        uint64_t sumScalar(const uint8_t* data, size_t count)
+        {
+            uint64_t sum{ 0 };
+            for (size_t x = 0; x < count; ++x) {
+                sum += data[x];
+            }
+            return sum;
+        }
+
+#if defined(CHANNEL_SUM_X86)
+        CHANNEL_SUM_TARGET("sse2")
+        uint64_t sumSSE2(const uint8_t* data, size_t count)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i a = zero;
+            __m128i b = zero;
+            size_t x = 0;
+            //two accumulators so the adds don't wait on each other
+            for (; x + 32 <= count; x += 32) {
+                a = _mm_add_epi64(a, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x)), zero));
+                b = _mm_add_epi64(b, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x + 16)), zero));
+            }
+            for (; x + 16 <= count; x += 16) {
+                a = _mm_add_epi64(a, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x)), zero));
+            }
+            a = _mm_add_epi64(a, b);
+            uint64_t lanes[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), a);
+            return lanes[0] + lanes[1] + sumScalar(data + x, count - x);
+        }
+
+        CHANNEL_SUM_TARGET("avx2")
+        uint64_t sumAVX2(const uint8_t* data, size_t count)
+        {
+            __m256i const zero = _mm256_setzero_si256();
+            __m256i a = zero;
+            __m256i b = zero;
+            size_t x = 0;
+            for (; x + 64 <= count; x += 64) {
+                a = _mm256_add_epi64(a, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + x)), zero));
+                b = _mm256_add_epi64(b, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + x + 32)), zero));
+            }
+            a = _mm256_add_epi64(a, b);
+            //the tail stays VEX encoded, 16 bytes at a time
+            __m128i rest = _mm_add_epi64(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+            for (; x + 16 <= count; x += 16) {
+                rest = _mm_add_epi64(rest, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x)), _mm_setzero_si128()));
+            }
+            uint64_t lanes[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), rest);
+            return lanes[0] + lanes[1] + sumScalar(data + x, count - x);
+        }
+
+        CHANNEL_SUM_TARGET("avx512f,avx512bw")
+        uint64_t sumAVX512(const uint8_t* data, size_t count)
+        {
+            __m512i const zero = _mm512_setzero_si512();
+            __m512i a = zero;
+            __m512i b = zero;
+            size_t x = 0;
+            for (; x + 128 <= count; x += 128) {
+                a = _mm512_add_epi64(a, _mm512_sad_epu8(_mm512_loadu_si512(data + x), zero));
+                b = _mm512_add_epi64(b, _mm512_sad_epu8(_mm512_loadu_si512(data + x + 64), zero));
+            }
+            for (; x + 64 <= count; x += 64) {
+                a = _mm512_add_epi64(a, _mm512_sad_epu8(_mm512_loadu_si512(data + x), zero));
+            }
+            //zeroed bytes past the end add nothing
+            if (x < count) {
+                __mmask64 const mask = ~0ULL >> (64 - (count - x));
+                b = _mm512_add_epi64(b, _mm512_sad_epu8(_mm512_maskz_loadu_epi8(mask, data + x), zero));
+            }
+            return _mm512_reduce_add_epi64(_mm512_add_epi64(a, b));
+        }
+#endif
+
+        SumFn kernelFor(Kernel kernel)
+        {
+            switch (kernel) {
+#if defined(CHANNEL_SUM_X86)
+            case Kernel::SSE2:
+                return sumSSE2;
+            case Kernel::AVX2:
+                return sumAVX2;
+            case Kernel::AVX512:
+                return sumAVX512;
+#endif
+            default:
+                return sumScalar;
+            }
+        }
+
+        KernelDispatch<Kernel, SumFn>& dispatch()
+        {
+            //FSEQ_SUM_KERNEL=scalar|sse2|avx2|avx512 pins a kernel for comparisons
+            static KernelDispatch<Kernel, SumFn> d("FSEQ_SUM_KERNEL", { Kernel::AVX512, Kernel::AVX2, Kernel::SSE2 },
+                RangeCopy::KernelName, RangeCopy::IsSupported, kernelFor);
+            return d;
+        }
+    }
+
+    uint64_t Sum(const uint8_t* data, size_t count)
+    {
+        return dispatch().fn()(data, count);
+    }
+
+    Kernel ActiveKernel()
+    {
+        return dispatch().active();
+    }
+
+    bool SetKernel(Kernel kernel)
+    {
+        return dispatch().set(kernel);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "range_copy.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//0-based channel range fed through one fuse or power injection point
+struct PowerPort
+{
+    uint32_t start{ 0 };
+    uint32_t count{ 0 };
+    //draw of one channel at full value, pixels draw close to linear in the value
+    double milliampsPerChannel{ 20.0 };
+    //budget of the whole range, frames drawing more are dimmed to fit
+    double amps{ 0.0 };
+};
+using PowerPorts = std::vector<PowerPort>;
+
+//what the limiter did to one port over an export
+struct PowerPortReport
+{
+    uint32_t limitedFrames{ 0 };
+    //first and last frame of each run of limited frames
+    std::vector<std::pair<uint32_t, uint32_t>> frames;
+    double peakAmps{ 0.0 };
+    //lowest share of the values left in a limited frame
+    double minScale{ 1.0 };
+};
+
+//Sums the channel values of each port every frame and scales the ports whose draw
+//would exceed their budget, leaving every other frame and port untouched.
+class PowerLimiter
+{
+public:
+    PowerLimiter() = default;
+    explicit PowerLimiter(PowerPorts ports);
+
+    [[nodiscard]] bool empty() const { return m_ports.empty(); }
+    //frame is size bytes long, returns the number of ports limited in it
+    unsigned apply(uint8_t* frame, uint32_t size, uint32_t frameNumber);
+
+    [[nodiscard]] PowerPorts const& ports() const { return m_ports; }
+    [[nodiscard]] std::vector<PowerPortReport> const& reports() const { return m_reports; }
+    //frames in which at least one port was limited
+    [[nodiscard]] uint32_t limitedFrames() const { return m_limitedFrames; }
+    //one line per limited port, "1-510: 14 frames (340-352, 400), peak 7.2 A, down to 71%"
+    [[nodiscard]] std::string summary() const;
+
+private:
+    PowerPorts m_ports;
+    //largest channel value sum each port may have
+    std::vector<uint64_t> m_budgets;
+    std::vector<PowerPortReport> m_reports;
+    uint32_t m_limitedFrames{ 0 };
+};
+
+//Sum of a run of channel values, psadbw against zero adds 8 bytes per lane at a time.
+//The widest kernel the CPU supports is picked on first use.
+namespace ChannelSum
+{
+    using RangeCopy::Kernel;
+
+    uint64_t Sum(const uint8_t* data, size_t count);
+
+    Kernel ActiveKernel();
+    //for benchmarks, false when the CPU can't run it
+    bool SetKernel(Kernel kernel);
+}
@@ -0,0 +1,290 @@
+#include "range_bench.h"
+
+#include "range_copy.h"
+#include "channel_map.h"
+#include "controller.h"
+#include "frame_transform.h"
+#include "power_limiter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    //the app is built as a Windows GUI program, which starts without a console for printf
+    void AttachConsoleOutput()
+    {
+#if defined(_WIN32)
+        //output redirected to a file or pipe already has somewhere to go
+        HANDLE const out = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (out != nullptr && out != INVALID_HANDLE_VALUE && GetFileType(out) != FILE_TYPE_UNKNOWN) {
+            return;
+        }
+        if (!AttachConsole(ATTACH_PARENT_PROCESS) && !AllocConsole()) {
+            return;
+        }
+        FILE* stream{ nullptr };
+        freopen_s(&stream, "CONOUT$", "w", stdout);
+        freopen_s(&stream, "CONOUT$", "w", stderr);
+#endif
+    }
+
+    using Ranges = std::vector<RangeCopy::Range>;
+
+    struct RangeMap
+    {
+        std::string name;
+        Ranges ranges;
+    };
+
+    size_t loopGather(uint8_t* packed, const uint8_t* frame, Ranges const& ranges)
+    {
+        size_t offset = 0;
+        for (auto& rng : ranges) {
+            memcpy(&packed[offset], &frame[rng.first], rng.second);
+            offset += rng.second;
+        }
+        return offset;
+    }
+
+    size_t loopScatter(uint8_t* frame, const uint8_t* packed, Ranges const& ranges)
+    {
+        size_t offset = 0;
+        for (auto& rng : ranges) {
+            memcpy(&frame[rng.first], &packed[offset], rng.second);
+            offset += rng.second;
+        }
+        return offset;
+    }
+
+    //runs fn until about 200ms have passed, returns nanoseconds per call
+    template<class Fn>
+    double timeIt(Fn&& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+        uint64_t calls = 0;
+        auto const start = Clock::now();
+        auto now = start;
+        while (now - start < std::chrono::milliseconds(200)) {
+            for (int x = 0; x < 64; ++x) {
+                fn();
+            }
+            calls += 64;
+            now = Clock::now();
+        }
+        return std::chrono::duration<double, std::nano>(now - start).count() / calls;
+    }
+
+    std::vector<RangeMap> syntheticMaps()
+    {
+        std::vector<RangeMap> maps;
+        Ranges nodes;
+        for (uint32_t x = 0; x < 4000; ++x) {
+            nodes.emplace_back(x * 6, 3);
+        }
+        maps.push_back({ "4000 single nodes", nodes });
+
+        Ranges ports;
+        for (uint32_t x = 0; x < 48; ++x) {
+            ports.emplace_back(x * 1024, 510);
+        }
+        maps.push_back({ "48 pixel ports", ports });
+
+        std::mt19937 rng(42);
+        Ranges mixed;
+        uint32_t pos = 0;
+        for (uint32_t x = 0; x < 255; ++x) {
+            uint32_t const len = 3 + rng() % 190;
+            mixed.emplace_back(pos, len);
+            pos += len + rng() % 64;
+        }
+        maps.push_back({ "255 mixed ranges", mixed });
+
+        maps.push_back({ "1 range of 100000", { { 0, 100000 } } });
+        return maps;
+    }
+
+    void benchMap(RangeMap const& map)
+    {
+        uint32_t frameSize = 0;
+        size_t bytes = 0;
+        for (auto& rng : map.ranges) {
+            frameSize = std::max(frameSize, rng.first + rng.second);
+            bytes += rng.second;
+        }
+        std::vector<uint8_t> frame(frameSize);
+        std::mt19937 rng(1);
+        for (auto& b : frame) {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::vector<uint8_t> expected(bytes);
+        std::vector<uint8_t> packed(bytes);
+        std::vector<uint8_t> scattered(frameSize);
+        loopGather(expected.data(), frame.data(), map.ranges);
+
+        printf("%s: %zu ranges, %zu bytes\n", map.name.c_str(), map.ranges.size(), bytes);
+        printf("    %-8s %12s %10s %12s %10s\n", "kernel", "gather ns", "GB/s", "scatter ns", "GB/s");
+        auto report = [&](const char* name, double gatherNs, double scatterNs, bool ok) {
+            printf("    %-8s %12.0f %10.2f %12.0f %10.2f%s\n", name, gatherNs, bytes / gatherNs, scatterNs, bytes / scatterNs, ok ? "" : "  MISMATCH");
+        };
+
+        double const loopGatherNs = timeIt([&]() { loopGather(packed.data(), frame.data(), map.ranges); });
+        double const loopScatterNs = timeIt([&]() { loopScatter(scattered.data(), expected.data(), map.ranges); });
+        report("memcpy", loopGatherNs, loopScatterNs, true);
+
+        auto const active = RangeCopy::ActiveKernel();
+        for (int k = 0; k < static_cast<int>(RangeCopy::Kernel::Count); ++k) {
+            auto const kernel = static_cast<RangeCopy::Kernel>(k);
+            if (!RangeCopy::SetKernel(kernel)) {
+                continue;
+            }
+            std::fill(packed.begin(), packed.end(), 0);
+            RangeCopy::Gather(packed.data(), frame.data(), map.ranges.data(), map.ranges.size());
+            std::vector<uint8_t> back(frameSize, 0);
+            std::vector<uint8_t> backLoop(frameSize, 0);
+            RangeCopy::Scatter(back.data(), expected.data(), map.ranges.data(), map.ranges.size());
+            loopScatter(backLoop.data(), expected.data(), map.ranges);
+            bool const ok = packed == expected && back == backLoop;
+
+            double const gatherNs = timeIt([&]() { RangeCopy::Gather(packed.data(), frame.data(), map.ranges.data(), map.ranges.size()); });
+            double const scatterNs = timeIt([&]() { RangeCopy::Scatter(scattered.data(), expected.data(), map.ranges.data(), map.ranges.size()); });
+            report(RangeCopy::KernelName(kernel), gatherNs, scatterNs, ok);
+        }
+        RangeCopy::SetKernel(active);
+
+        //the brightness and gamma stage runs over the same ranges in place
+        ChannelCurve curve;
+        curve.brightness = 60;
+        curve.gamma = 2.2;
+        FrameTransform transform;
+        transform.add(map.ranges, curve);
+        auto const lut = curve.lut();
+        std::vector<uint8_t> expectedLut = frame;
+        for (auto& rng : map.ranges) {
+            for (uint32_t x = rng.first; x < rng.first + rng.second; ++x) {
+                expectedLut[x] = lut[frame[x]];
+            }
+        }
+        printf("    %-8s %12s %10s\n", "lut", "apply ns", "GB/s");
+        auto const activeLut = LutTransform::ActiveKernel();
+        for (int k = 0; k < static_cast<int>(LutTransform::Kernel::Count); ++k) {
+            auto const kernel = static_cast<LutTransform::Kernel>(k);
+            if (!LutTransform::SetKernel(kernel)) {
+                continue;
+            }
+            std::vector<uint8_t> applied = frame;
+            transform.apply(applied.data(), frameSize);
+            bool const ok = applied == expectedLut;
+            double const applyNs = timeIt([&]() { transform.apply(applied.data(), frameSize); });
+            printf("    %-8s %12.0f %10.2f%s\n", LutTransform::KernelName(kernel), applyNs, bytes / applyNs, ok ? "" : "  MISMATCH");
+        }
+        LutTransform::SetKernel(activeLut);
+
+        //GRB pixels on every range
+        FrameTransform reorder;
+        std::vector<uint8_t> expectedOrder = frame;
+        for (auto& rng : map.ranges) {
+            reorder.addColorOrder(rng.first, rng.second, "GRB");
+            for (uint32_t x = rng.first; x + 3 <= rng.first + rng.second; x += 3) {
+                std::swap(expectedOrder[x], expectedOrder[x + 1]);
+            }
+        }
+        printf("    %-8s %12s %10s\n", "shuffle", "apply ns", "GB/s");
+        auto const activeShuffle = PixelShuffle::ActiveKernel();
+        for (int k = 0; k < static_cast<int>(PixelShuffle::Kernel::Count); ++k) {
+            auto const kernel = static_cast<PixelShuffle::Kernel>(k);
+            if (!PixelShuffle::SetKernel(kernel)) {
+                continue;
+            }
+            std::vector<uint8_t> applied = frame;
+            reorder.apply(applied.data(), frameSize);
+            bool const ok = applied == expectedOrder;
+            double const applyNs = timeIt([&]() { reorder.apply(applied.data(), frameSize); });
+            printf("    %-8s %12.0f %10.2f%s\n", LutTransform::KernelName(kernel), applyNs, bytes / applyNs, ok ? "" : "  MISMATCH");
+        }
+        PixelShuffle::SetKernel(activeShuffle);
+
+        //every range a string of RGB pixels wired from its far end
+        ChannelMap reversed;
+        std::vector<uint8_t> expectedMap = frame;
+        for (auto& rng : map.ranges) {
+            uint32_t const pixels = rng.second / 3;
+            reversed.addReversed(rng.first, pixels * 3, 3);
+            for (uint32_t p = 0; p < pixels; ++p) {
+                memcpy(&expectedMap[rng.first + p * 3], &frame[rng.first + (pixels - 1 - p) * 3], 3);
+            }
+        }
+        GatherPlan const plan(reversed);
+        printf("    %-8s %12s %10s  %s\n", "reverse", "apply ns", "GB/s", plan.summary().c_str());
+        auto const activeGather = ChannelGather::ActiveKernel();
+        for (int k = 0; k < static_cast<int>(ChannelGather::Kernel::Count); ++k) {
+            auto const kernel = static_cast<ChannelGather::Kernel>(k);
+            if (!ChannelGather::SetKernel(kernel)) {
+                continue;
+            }
+            std::vector<uint8_t> applied = frame;
+            plan.apply(applied.data(), frameSize);
+            bool const ok = applied == expectedMap;
+            double const applyNs = timeIt([&]() { plan.apply(applied.data(), frameSize); });
+            printf("    %-8s %12.0f %10.2f%s\n", LutTransform::KernelName(kernel), applyNs, bytes / applyNs, ok ? "" : "  MISMATCH");
+        }
+        ChannelGather::SetKernel(activeGather);
+
+        //the power limiter sums every port each frame, here every range is a port
+        uint64_t expectedSum{ 0 };
+        for (auto& rng : map.ranges) {
+            for (uint32_t x = rng.first; x < rng.first + rng.second; ++x) {
+                expectedSum += frame[x];
+            }
+        }
+        printf("    %-8s %12s %10s\n", "sum", "ns", "GB/s");
+        auto const activeSum = ChannelSum::ActiveKernel();
+        for (int k = 0; k < static_cast<int>(ChannelSum::Kernel::Count); ++k) {
+            auto const kernel = static_cast<ChannelSum::Kernel>(k);
+            if (!ChannelSum::SetKernel(kernel)) {
+                continue;
+            }
+            uint64_t sum{ 0 };
+            double const sumNs = timeIt([&]() {
+                sum = 0;
+                for (auto& rng : map.ranges) {
+                    sum += ChannelSum::Sum(&frame[rng.first], rng.second);
+                }
+            });
+            printf("    %-8s %12.0f %10.2f%s\n", RangeCopy::KernelName(kernel), sumNs, bytes / sumNs, sum == expectedSum ? "" : "  MISMATCH");
+        }
+        ChannelSum::SetKernel(activeSum);
+    }
+}
+
+int RunRangeBenchmark(int argc, char* argv[])
+{
+    AttachConsoleOutput();
+    std::vector<RangeMap> maps = syntheticMaps();
+    for (int x = 0; x < argc; ++x) {
+        if (strcmp(argv[x], "--bench-ranges") != 0 || x + 1 >= argc) {
+            continue;
+        }
+        for (auto const& controller : LoadControllerFile(argv[x + 1])) {
+            auto const sparse = controller.sparseRanges();
+            maps.push_back({ controller.name, Ranges(sparse.begin(), sparse.end()) });
+        }
+    }
+    printf("Active kernel: %s, lut kernel: %s, shuffle kernel: %s, gather kernel: %s, sum kernel: %s\n\n", RangeCopy::KernelName(RangeCopy::ActiveKernel()),
+        LutTransform::KernelName(LutTransform::ActiveKernel()), LutTransform::KernelName(PixelShuffle::ActiveKernel()),
+        LutTransform::KernelName(ChannelGather::ActiveKernel()), RangeCopy::KernelName(ChannelSum::ActiveKernel()));
+    for (auto const& map : maps) {
+        benchMap(map);
+        printf("\n");
+    }
+    return 0;
+}
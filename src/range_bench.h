@@ -0,0 +1,6 @@
+#pragma once
+
+//Times the range copy and lookup table kernels against plain loops on synthetic range maps
+//and, when a networks file is given, on the ranges of each controller in it.
+//Run as: controller_gen --bench-ranges [xlights_networks.xml]
+int RunRangeBenchmark(int argc, char* argv[]);
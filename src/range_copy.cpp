@@ -0,0 +1,337 @@
+#include "range_copy.h"
+
+#include "kernel_dispatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RANGE_COPY_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RANGE_COPY_TARGET(x)
+#else
+#define RANGE_COPY_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace RangeCopy
+{
+    namespace
+    {
+        using CopyFn = size_t (*)(uint8_t*, const uint8_t*, const Range*, size_t);
+
+        struct Kernels
+        {
+            CopyFn gather;
+            CopyFn scatter;
+        };
+
+        //past this libc memcpy wins, it switches to rep movsb / non temporal stores
+        constexpr uint32_t LargeRange = 1024;
+
+        inline void copySmall(uint8_t* d, const uint8_t* s, uint32_t n)
+        {
+            //two overlapping moves cover every length in the bucket without a loop
+            if (n >= 8) {
+                uint64_t a, b;
+                memcpy(&a, s, 8);
+                memcpy(&b, s + n - 8, 8);
+                memcpy(d, &a, 8);
+                memcpy(d + n - 8, &b, 8);
+            } else if (n >= 4) {
+                uint32_t a, b;
+                memcpy(&a, s, 4);
+                memcpy(&b, s + n - 4, 4);
+                memcpy(d, &a, 4);
+                memcpy(d + n - 4, &b, 4);
+            } else if (n != 0) {
+                //RGB nodes land here
+                d[0] = s[0];
+                d[n >> 1] = s[n >> 1];
+                d[n - 1] = s[n - 1];
+            }
+        }
+
+        inline void copyScalar(uint8_t* d, const uint8_t* s, uint32_t n)
+        {
+            if (n < 16) {
+                copySmall(d, s, n);
+            } else {
+                memcpy(d, s, n);
+            }
+        }
+
+        size_t gatherScalar(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyScalar(packed + offset, frame + ranges[x].first, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        size_t scatterScalar(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyScalar(frame + ranges[x].first, packed + offset, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+#if defined(RANGE_COPY_X86)
+        RANGE_COPY_TARGET("sse2")
+        inline void copySSE2(uint8_t* d, const uint8_t* s, uint32_t n)
+        {
+            if (n < 16) {
+                copySmall(d, s, n);
+                return;
+            }
+            if (n > LargeRange) {
+                memcpy(d, s, n);
+                return;
+            }
+            //the last block overlaps the previous one instead of a byte tail
+            __m128i const last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + n - 16));
+            for (uint32_t x = 0; x + 16 < n; x += 16) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + n - 16), last);
+        }
+
+        RANGE_COPY_TARGET("sse2")
+        size_t gatherSSE2(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copySSE2(packed + offset, frame + ranges[x].first, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        RANGE_COPY_TARGET("sse2")
+        size_t scatterSSE2(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copySSE2(frame + ranges[x].first, packed + offset, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        RANGE_COPY_TARGET("avx2")
+        inline void copyAVX2(uint8_t* d, const uint8_t* s, uint32_t n)
+        {
+            if (n < 16) {
+                copySmall(d, s, n);
+                return;
+            }
+            if (n <= 32) {
+                __m128i const a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+                __m128i const b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + n - 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d), a);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + n - 16), b);
+                return;
+            }
+            if (n > LargeRange) {
+                memcpy(d, s, n);
+                return;
+            }
+            __m256i const last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + n - 32));
+            for (uint32_t x = 0; x + 32 < n; x += 32) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + x)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + n - 32), last);
+        }
+
+        RANGE_COPY_TARGET("avx2")
+        size_t gatherAVX2(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyAVX2(packed + offset, frame + ranges[x].first, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        RANGE_COPY_TARGET("avx2")
+        size_t scatterAVX2(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyAVX2(frame + ranges[x].first, packed + offset, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        RANGE_COPY_TARGET("avx512f,avx512bw")
+        inline void copyAVX512(uint8_t* d, const uint8_t* s, uint32_t n)
+        {
+            //masked moves have a longer latency than the plain small copies
+            if (n < 16) {
+                copySmall(d, s, n);
+                return;
+            }
+            if (n > LargeRange) {
+                memcpy(d, s, n);
+                return;
+            }
+            //masked moves never touch the bytes outside the range, so the tail
+            //is a single load and store with no branches on its size
+            uint32_t x = 0;
+            for (; x + 64 <= n; x += 64) {
+                _mm512_storeu_si512(d + x, _mm512_loadu_si512(s + x));
+            }
+            if (x < n) {
+                __mmask64 const mask = ~0ULL >> (64 - (n - x));
+                _mm512_mask_storeu_epi8(d + x, mask, _mm512_maskz_loadu_epi8(mask, s + x));
+            }
+        }
+
+        RANGE_COPY_TARGET("avx512f,avx512bw")
+        size_t gatherAVX512(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyAVX512(packed + offset, frame + ranges[x].first, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        RANGE_COPY_TARGET("avx512f,avx512bw")
+        size_t scatterAVX512(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count)
+        {
+            size_t offset = 0;
+            for (size_t x = 0; x < count; ++x) {
+                copyAVX512(frame + ranges[x].first, packed + offset, ranges[x].second);
+                offset += ranges[x].second;
+            }
+            return offset;
+        }
+
+        bool cpuHas(Kernel kernel)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            int const maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool const sse2 = (info[3] & (1 << 26)) != 0;
+            bool const osxsave = (info[2] & (1 << 27)) != 0;
+            if (kernel == Kernel::SSE2) {
+                return sse2;
+            }
+            if (!osxsave || maxLeaf < 7) {
+                return false;
+            }
+            unsigned long long const xcr0 = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            if (kernel == Kernel::AVX2) {
+                return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+            }
+            //AVX-512 needs the opmask and upper ZMM state enabled by the OS as well
+            return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+#else
+            __builtin_cpu_init();
+            switch (kernel) {
+            case Kernel::SSE2:
+                return __builtin_cpu_supports("sse2");
+            case Kernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case Kernel::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+            default:
+                return false;
+            }
+#endif
+        }
+#endif
+
+        Kernels const* kernelsFor(Kernel kernel)
+        {
+            static constexpr Kernels scalar{ gatherScalar, scatterScalar };
+#if defined(RANGE_COPY_X86)
+            static constexpr Kernels sse2{ gatherSSE2, scatterSSE2 };
+            static constexpr Kernels avx2{ gatherAVX2, scatterAVX2 };
+            static constexpr Kernels avx512{ gatherAVX512, scatterAVX512 };
+#endif
+            switch (kernel) {
+#if defined(RANGE_COPY_X86)
+            case Kernel::SSE2:
+                return &sse2;
+            case Kernel::AVX2:
+                return &avx2;
+            case Kernel::AVX512:
+                return &avx512;
+#endif
+            default:
+                return &scalar;
+            }
+        }
+
+        KernelDispatch<Kernel, Kernels const*>& dispatch()
+        {
+            //FSEQ_RANGE_KERNEL=scalar|sse2|avx2|avx512 pins a kernel for comparisons
+            static KernelDispatch<Kernel, Kernels const*> d("FSEQ_RANGE_KERNEL", { Kernel::AVX512, Kernel::AVX2, Kernel::SSE2 },
+                KernelName, IsSupported, kernelsFor);
+            return d;
+        }
+    }
+
+    size_t Gather(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count)
+    {
+        return dispatch().fn()->gather(packed, frame, ranges, count);
+    }
+
+    size_t Scatter(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count)
+    {
+        return dispatch().fn()->scatter(frame, packed, ranges, count);
+    }
+
+    Kernel ActiveKernel()
+    {
+        return dispatch().active();
+    }
+
+    const char* KernelName(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::SSE2:
+            return "sse2";
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::AVX512:
+            return "avx512";
+        default:
+            return "unknown";
+        }
+    }
+
+    bool IsSupported(Kernel kernel)
+    {
+        if (kernel == Kernel::Scalar) {
+            return true;
+        }
+#if defined(RANGE_COPY_X86)
+        return cpuHas(kernel);
+#else
+        return false;
+#endif
+    }
+
+    bool SetKernel(Kernel kernel)
+    {
+        return dispatch().set(kernel);
+    }
+}
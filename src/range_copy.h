@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+//Copies lists of channel ranges between a full frame and a packed buffer. Sparse
+//controllers are often hundreds of short pixel port ranges, so each range is copied
+//with inline vector moves instead of a memcpy call. The widest kernel the CPU
+//supports is picked on first use.
+namespace RangeCopy
+{
+    //start channel and channel count, same as the FSEQFile ranges
+    using Range = std::pair<uint32_t, uint32_t>;
+
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512,
+        Count
+    };
+
+    //frame[ranges[i].first...] -> packed, returns the bytes copied
+    size_t Gather(uint8_t* packed, const uint8_t* frame, const Range* ranges, size_t count);
+    //packed -> frame[ranges[i].first...], returns the bytes copied
+    size_t Scatter(uint8_t* frame, const uint8_t* packed, const Range* ranges, size_t count);
+
+    Kernel ActiveKernel();
+    const char* KernelName(Kernel kernel);
+    bool IsSupported(Kernel kernel);
+    //for benchmarks, false when the CPU can't run it
+    bool SetKernel(Kernel kernel);
+}
@@ -0,0 +1,135 @@
+#include "range_editor_dialog.h"
+
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+RangeEditorDialog::RangeEditorDialog(QString const& title, ChannelRanges const& ranges, ChannelRanges const& defaults, QWidget* parent) :
+    QDialog(parent),
+    m_defaults(defaults)
+{
+    setWindowTitle(QString("Channel Ranges - %1").arg(title));
+    resize(420, 360);
+    auto* layout = new QVBoxLayout(this);
+    auto* label = new QLabel("Only these channels are written to the sparse FSEQ. Channels are 1-based and the end channel is included.", this);
+    label->setWordWrap(true);
+    layout->addWidget(label);
+
+    m_table = new QTableWidget(0, 2, this);
+    m_table->setHorizontalHeaderLabels({ "Start Channel", "End Channel" });
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    connect(m_table, &QTableWidget::itemChanged, this, &RangeEditorDialog::updateTotal);
+    layout->addWidget(m_table);
+
+    m_total = new QLabel(this);
+    layout->addWidget(m_total);
+
+    auto* rowButtons = new QHBoxLayout();
+    auto* add = new QPushButton("Add", this);
+    connect(add, &QPushButton::clicked, this, [this]() {
+        uint64_t start{ 1 };
+        int const last = m_table->rowCount() - 1;
+        if (last >= 0) {
+            start = m_table->item(last, 1)->text().toULongLong() + 1;
+        }
+        addRow(start, start);
+        m_table->editItem(m_table->item(m_table->rowCount() - 1, 0));
+    });
+    rowButtons->addWidget(add);
+    auto* remove = new QPushButton("Remove", this);
+    connect(remove, &QPushButton::clicked, this, [this]() {
+        auto const rows = m_table->selectionModel()->selectedRows();
+        for (int x = static_cast<int>(rows.size()) - 1; x >= 0; --x) {
+            m_table->removeRow(rows[x].row());
+        }
+        updateTotal();
+    });
+    rowButtons->addWidget(remove);
+    if (!m_defaults.empty()) {
+        auto* reset = new QPushButton("Reset to Defaults", this);
+        connect(reset, &QPushButton::clicked, this, [this]() { setRanges(m_defaults); });
+        rowButtons->addWidget(reset);
+    }
+    rowButtons->addStretch();
+    layout->addLayout(rowButtons);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &RangeEditorDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    setRanges(ranges);
+}
+
+ChannelRanges RangeEditorDialog::ranges() const
+{
+    ChannelRanges ranges;
+    readRanges(ranges);
+    return ranges;
+}
+
+void RangeEditorDialog::accept()
+{
+    ChannelRanges ranges;
+    if (!readRanges(ranges)) {
+        QMessageBox::warning(this, "Invalid Range", "Every range needs a start channel of 1 or more and an end channel at or after it.");
+        return;
+    }
+    QDialog::accept();
+}
+
+void RangeEditorDialog::setRanges(ChannelRanges const& ranges)
+{
+    m_table->setRowCount(0);
+    for (auto const& [start, count] : ranges) {
+        addRow(start, start + count - 1);
+    }
+    updateTotal();
+}
+
+void RangeEditorDialog::addRow(uint64_t start, uint64_t end)
+{
+    QSignalBlocker blocker(m_table);
+    int const row = m_table->rowCount();
+    m_table->insertRow(row);
+    m_table->setItem(row, 0, new QTableWidgetItem(QString::number(start)));
+    m_table->setItem(row, 1, new QTableWidgetItem(QString::number(end)));
+}
+
+bool RangeEditorDialog::readRanges(ChannelRanges& ranges) const
+{
+    ChannelRanges read;
+    for (int row = 0; row < m_table->rowCount(); ++row) {
+        bool startOk{ false };
+        bool endOk{ false };
+        uint64_t const start = m_table->item(row, 0)->text().trimmed().toULongLong(&startOk);
+        uint64_t const end = m_table->item(row, 1)->text().trimmed().toULongLong(&endOk);
+        if (!startOk || !endOk || start == 0 || end < start) {
+            return false;
+        }
+        read.emplace_back(start, end - start + 1);
+    }
+    ranges = MergeRanges(std::move(read));
+    return true;
+}
+
+void RangeEditorDialog::updateTotal()
+{
+    ChannelRanges ranges;
+    if (!readRanges(ranges)) {
+        m_total->setText("Invalid range");
+        return;
+    }
+    uint64_t total{ 0 };
+    for (auto const& [start, count] : ranges) {
+        total += count;
+    }
+    m_total->setText(QString("%1 channels in %2 ranges").arg(total).arg(ranges.size()));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "controller.h"
+
+#include <QDialog>
+
+class QLabel;
+class QTableWidget;
+
+//Edits the channel ranges a controller exports, one row per range
+class RangeEditorDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    //defaults are what Reset goes back to, the controller's model or network ranges, empty hides the button
+    RangeEditorDialog(QString const& title, ChannelRanges const& ranges, ChannelRanges const& defaults, QWidget* parent = nullptr);
+
+    [[nodiscard]] ChannelRanges ranges() const;
+
+    void accept() override;
+
+private:
+    void setRanges(ChannelRanges const& ranges);
+    void addRow(uint64_t start, uint64_t end);
+    bool readRanges(ChannelRanges& ranges) const;
+    void updateTotal();
+
+    QTableWidget* m_table{ nullptr };
+    QLabel* m_total{ nullptr };
+    ChannelRanges m_defaults;
+};
@@ -0,0 +1,29 @@
+#include "range_optimizer.h"
+
+#include "FSEQFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double SparseRangeHeaderBytes = 6.0;
+}
+
+RangeOptimizerResult OptimizeSparseRanges(std::vector<std::pair<uint32_t, uint32_t>> const& ranges, uint32_t frames,
+    double bytesPerChannel, RangeOptimizerOptions const& options)
+{
+    RangeOptimizerResult result;
+    result.ranges = ranges;
+    result.inputRanges = ranges.size();
+
+    //a gap of g channels is filled when g * frames * bytesPerChannel <= header + frames * rangeFrameCost
+    double const paddingCost = std::max<uint32_t>(frames, 1) * std::max(bytesPerChannel, 1e-6);
+    double const rangeCost = SparseRangeHeaderBytes + frames * options.rangeFrameCost;
+    double const gap = std::floor(rangeCost / paddingCost);
+    result.maxGap = gap >= std::numeric_limits<uint32_t>::max() ? std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(gap);
+
+    result.paddedChannels = FSEQFile::CoalesceRanges(result.ranges, options.maxRanges, result.maxGap);
+    return result;
+}
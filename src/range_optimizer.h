@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct RangeOptimizerOptions
+{
+    //the V2 header stores the range count in one byte
+    size_t maxRanges{ 255 };
+    //what one more range costs per frame, in output bytes, for the player's
+    //per range handling; the 6 byte header entry is added on top
+    double rangeFrameCost{ 1.0 };
+};
+
+struct RangeOptimizerResult
+{
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    size_t inputRanges{ 0 };
+    uint64_t paddedChannels{ 0 };
+    //largest gap that was worth filling on cost alone
+    uint32_t maxGap{ 0 };
+};
+
+//Merges sparse ranges whose gap costs less to store than the range it saves.
+//A padded channel costs bytesPerChannel in every frame, which is the compressed
+//to raw ratio from the export estimate, or 1.0 without compression.
+RangeOptimizerResult OptimizeSparseRanges(std::vector<std::pair<uint32_t, uint32_t>> const& ranges, uint32_t frames,
+    double bytesPerChannel, RangeOptimizerOptions const& options = {});
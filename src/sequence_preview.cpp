@@ -0,0 +1,318 @@
+#include "sequence_preview.h"
+
+#include "trace.h"
+
+#include <QCursor>
+#include <QFileInfo>
+#include <QLabel>
+#include <QMetaObject>
+#include <QPainter>
+#include <QTimer>
+#include <QToolTip>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    //black through red and yellow to white, 1 is still visible against 0
+    std::array<QRgb, 256> const& HeatPalette()
+    {
+        static auto const palette = []() {
+            std::array<QRgb, 256> colors{};
+            colors[0] = qRgb(24, 24, 24);
+            for (int v = 1; v < 256; ++v) {
+                double const t = v / 255.0;
+                auto const channel = [t](double offset) { return static_cast<int>(std::clamp(3.0 * t - offset, 0.0, 1.0) * 255); };
+                colors[v] = qRgb(std::max(64, channel(0.0)), channel(1.0), channel(2.0));
+            }
+            return colors;
+        }();
+        return palette;
+    }
+
+    QString FormatTime(uint64_t ms)
+    {
+        return QString("%1:%2.%3").arg(ms / 60000).arg((ms / 1000) % 60, 2, 10, QChar('0')).arg(ms % 1000, 3, 10, QChar('0'));
+    }
+}
+
+HeatmapView::HeatmapView(QWidget* parent) :
+    QWidget(parent)
+{
+    setMouseTracking(true);
+    setMinimumSize(200, 80);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void HeatmapView::setPyramid(std::shared_ptr<const SequencePyramid> pyramid)
+{
+    m_pyramid = std::move(pyramid);
+    setRanges(m_requested);
+}
+
+void HeatmapView::setRanges(std::vector<std::pair<uint32_t, uint32_t>> ranges)
+{
+    m_requested = std::move(ranges);
+    m_ranges.clear();
+    m_sliceChannels = 0;
+    if (m_pyramid) {
+        uint32_t const channels = m_pyramid->channels;
+        if (m_requested.empty()) {
+            m_ranges.emplace_back(0, channels);
+        }
+        for (auto const& [start, count] : m_requested) {
+            if (start < channels) {
+                m_ranges.emplace_back(start, std::min(count, channels - start));
+            }
+        }
+        for (auto const& [start, count] : m_ranges) {
+            m_sliceChannels += count;
+        }
+    }
+    render();
+    update();
+}
+
+uint32_t HeatmapView::channelAt(int y) const
+{
+    if (m_sliceChannels == 0 || y < 0 || y >= height()) {
+        return UINT32_MAX;
+    }
+    uint64_t slice = static_cast<uint64_t>(y) * m_sliceChannels / height();
+    for (auto const& [start, count] : m_ranges) {
+        if (slice < count) {
+            return start + static_cast<uint32_t>(slice);
+        }
+        slice -= count;
+    }
+    return UINT32_MAX;
+}
+
+void HeatmapView::render()
+{
+    m_image = QImage();
+    int const w = width();
+    int const h = height();
+    if (!m_pyramid || m_sliceChannels == 0 || w <= 0 || h <= 0) {
+        return;
+    }
+    TRACE_SCOPE_CAT("render heatmap", "preview");
+    auto const& pyramid = *m_pyramid;
+    auto const& level = pyramid.levelFor(static_cast<double>(m_sliceChannels) / h, static_cast<double>(pyramid.frames) / w);
+    auto const& palette = HeatPalette();
+
+    //first slice position of each range, rows can straddle two ranges
+    std::vector<uint64_t> offsets;
+    uint64_t offset{ 0 };
+    for (auto const& [start, count] : m_ranges) {
+        offsets.push_back(offset);
+        offset += count;
+    }
+
+    m_image = QImage(w, h, QImage::Format_RGB32);
+    std::vector<std::pair<uint32_t, uint32_t>> segments;
+    for (int y = 0; y < h; ++y) {
+        uint64_t const s0 = static_cast<uint64_t>(y) * m_sliceChannels / h;
+        uint64_t const s1 = std::max(s0 + 1, static_cast<uint64_t>(y + 1) * m_sliceChannels / h);
+        segments.clear();
+        size_t r = std::upper_bound(offsets.begin(), offsets.end(), s0) - offsets.begin() - 1;
+        for (; r < m_ranges.size() && offsets[r] < s1; ++r) {
+            uint64_t const from = std::max(s0, offsets[r]) - offsets[r];
+            uint64_t const to = std::min<uint64_t>(s1 - offsets[r], m_ranges[r].second);
+            segments.emplace_back(m_ranges[r].first + static_cast<uint32_t>(from), m_ranges[r].first + static_cast<uint32_t>(to));
+        }
+        auto* line = reinterpret_cast<QRgb*>(m_image.scanLine(y));
+        for (int x = 0; x < w; ++x) {
+            uint32_t const f0 = static_cast<uint32_t>(static_cast<uint64_t>(x) * pyramid.frames / w);
+            uint32_t const f1 = std::max(f0 + 1, static_cast<uint32_t>(static_cast<uint64_t>(x + 1) * pyramid.frames / w));
+            uint8_t value{ 0 };
+            for (auto const& [c0, c1] : segments) {
+                value = std::max(value, pyramid.maxOver(level, c0, c1, f0, f1));
+            }
+            line[x] = palette[value];
+        }
+    }
+}
+
+void HeatmapView::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(HeatPalette()[0]));
+    if (m_image.isNull()) {
+        return;
+    }
+    painter.drawImage(0, 0, m_image);
+
+    //range boundaries, skipped when they would cover the data
+    if (m_ranges.size() > 1 && static_cast<int>(m_ranges.size()) < height() / 4) {
+        painter.setPen(QColor(90, 90, 200));
+        uint64_t offset{ 0 };
+        for (size_t x = 0; x + 1 < m_ranges.size(); ++x) {
+            offset += m_ranges[x].second;
+            int const y = static_cast<int>(offset * height() / m_sliceChannels);
+            painter.drawLine(0, y, width(), y);
+        }
+    }
+    if (m_pyramid->litChannels(m_ranges) == 0) {
+        painter.setPen(Qt::white);
+        painter.drawText(rect(), Qt::AlignCenter, "No channel in these ranges is ever on");
+    }
+}
+
+void HeatmapView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    render();
+}
+
+void HeatmapView::mouseMoveEvent(QMouseEvent*)
+{
+    //cursor position instead of the event accessors, those differ between Qt 5 and 6
+    QPoint const global = QCursor::pos();
+    QPoint const pos = mapFromGlobal(global);
+    uint32_t const channel = channelAt(pos.y());
+    if (!m_pyramid || channel == UINT32_MAX || width() <= 0) {
+        QToolTip::hideText();
+        return;
+    }
+    uint32_t const frame = static_cast<uint32_t>(static_cast<uint64_t>(std::clamp(pos.x(), 0, width() - 1)) * m_pyramid->frames / width());
+    QToolTip::showText(global,
+        QString("Channel %1, %2\nMax over the sequence %3").arg(channel + 1).arg(FormatTime(static_cast<uint64_t>(frame) * m_pyramid->stepTime))
+            .arg(m_pyramid->activity.maxValue[channel]), this);
+}
+
+SequencePreviewDock::SequencePreviewDock(QWidget* parent) :
+    QDockWidget("Sequence Preview", parent)
+{
+    setObjectName("dockSequencePreview");
+    //one build at a time, the build itself fans out over the file
+    m_pool.setMaxThreadCount(1);
+
+    auto* body = new QWidget(this);
+    auto* layout = new QVBoxLayout(body);
+    layout->setContentsMargins(4, 4, 4, 4);
+    m_status = new QLabel("Select a sequence", body);
+    layout->addWidget(m_status);
+    m_view = new HeatmapView(body);
+    layout->addWidget(m_view, 1);
+    setWidget(body);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(200);
+    connect(m_progressTimer, &QTimer::timeout, this, &SequencePreviewDock::updateStatus);
+    //nothing is decoded while the dock is closed
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            refresh();
+        }
+    });
+}
+
+SequencePreviewDock::~SequencePreviewDock()
+{
+    if (m_progress) {
+        m_progress->cancel = true;
+    }
+    m_pool.waitForDone();
+}
+
+void SequencePreviewDock::setSequence(QString const& path)
+{
+    if (path == m_path) {
+        return;
+    }
+    m_path = path;
+    refresh();
+}
+
+void SequencePreviewDock::setRanges(ChannelRanges const& ranges)
+{
+    m_ranges = ToSparseRanges(ranges);
+    m_view->setRanges(m_ranges);
+    updateStatus();
+}
+
+void SequencePreviewDock::refresh()
+{
+    if (!isVisible() || m_path.isEmpty()) {
+        return;
+    }
+    if (m_pyramid && m_pyramidPath == m_path) {
+        return;
+    }
+    if (m_progress) {
+        m_progress->cancel = true;
+        m_progress.reset();
+    }
+    ++m_generation;
+    auto const cached = std::find_if(m_recent.begin(), m_recent.end(), [this](auto const& recent) { return recent.first == m_path; });
+    if (cached != m_recent.end()) {
+        applyPyramid(m_generation, m_path, cached->second);
+        return;
+    }
+
+    m_pyramid.reset();
+    m_pyramidPath.clear();
+    m_view->setPyramid(nullptr);
+    auto progress = std::make_shared<ScanProgress>();
+    m_progress = progress;
+    m_pool.start([this, generation = m_generation, path = m_path, progress]() {
+        auto pyramid = std::make_shared<SequencePyramid>(GetSequencePyramid(path.toStdString(), progress.get()));
+        QMetaObject::invokeMethod(this, [this, generation, path, pyramid = std::move(pyramid)]() mutable {
+            applyPyramid(generation, path, std::move(pyramid));
+            }, Qt::QueuedConnection);
+    });
+    m_progressTimer->start();
+    updateStatus();
+}
+
+void SequencePreviewDock::applyPyramid(uint64_t generation, QString const& path, std::shared_ptr<const SequencePyramid> pyramid)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_progressTimer->stop();
+    m_progress.reset();
+    if (!pyramid->valid) {
+        m_pyramid.reset();
+        m_pyramidPath.clear();
+        m_view->setPyramid(nullptr);
+        m_status->setText(QString("Could not read %1").arg(QFileInfo(path).fileName()));
+        return;
+    }
+    //most recently used last
+    std::erase_if(m_recent, [&path](auto const& recent) { return recent.first == path; });
+    m_recent.emplace_back(path, pyramid);
+    if (m_recent.size() > RecentPyramids) {
+        m_recent.erase(m_recent.begin());
+    }
+    m_pyramid = std::move(pyramid);
+    m_pyramidPath = path;
+    m_view->setPyramid(m_pyramid);
+    updateStatus();
+}
+
+void SequencePreviewDock::updateStatus()
+{
+    QString const name = QFileInfo(m_path).fileName();
+    if (m_progress) {
+        m_status->setText(QString("Building preview of %1... %2 frames").arg(name).arg(m_progress->frames.load()));
+        return;
+    }
+    if (!m_pyramid) {
+        return;
+    }
+    auto ranges = m_ranges;
+    uint64_t total{ 0 };
+    if (ranges.empty()) {
+        ranges.emplace_back(0, m_pyramid->channels);
+    }
+    for (auto const& [start, count] : ranges) {
+        total += count;
+    }
+    m_status->setText(QString("%1 - %2 of %3 channels lit, %4")
+        .arg(name).arg(m_pyramid->litChannels(ranges)).arg(total)
+        .arg(FormatTime(static_cast<uint64_t>(m_pyramid->frames) * m_pyramid->stepTime)));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "controller.h"
+#include "sequence_pyramid.h"
+
+#include <QDockWidget>
+#include <QImage>
+#include <QThreadPool>
+
+#include <memory>
+#include <vector>
+
+class QLabel;
+class QTimer;
+
+//Channel x time heatmap of a pyramid, channels run down and time runs across.
+//Only the given 0-based ranges are drawn, stacked in order.
+class HeatmapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HeatmapView(QWidget* parent = nullptr);
+
+    void setPyramid(std::shared_ptr<const SequencePyramid> pyramid);
+    void setRanges(std::vector<std::pair<uint32_t, uint32_t>> ranges);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    //absolute 0-based channel shown at row y, UINT32_MAX outside the ranges
+    [[nodiscard]] uint32_t channelAt(int y) const;
+    void render();
+
+    std::shared_ptr<const SequencePyramid> m_pyramid;
+    std::vector<std::pair<uint32_t, uint32_t>> m_ranges; //clipped to the sequence
+    std::vector<std::pair<uint32_t, uint32_t>> m_requested;
+    uint64_t m_sliceChannels{ 0 };
+    QImage m_image;
+};
+
+//Dock showing a heatmap of the selected sequence for the selected controller ranges.
+//The pyramid is built or loaded on a worker thread and the last few are kept in memory.
+class SequencePreviewDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SequencePreviewDock(QWidget* parent = nullptr);
+    ~SequencePreviewDock();
+
+    void setSequence(QString const& path);
+    //1-based controller ranges, empty shows the whole sequence
+    void setRanges(ChannelRanges const& ranges);
+
+private:
+    void refresh();
+    void applyPyramid(uint64_t generation, QString const& path, std::shared_ptr<const SequencePyramid> pyramid);
+    void updateStatus();
+
+    static constexpr size_t RecentPyramids = 4;
+
+    QThreadPool m_pool;
+    HeatmapView* m_view{ nullptr };
+    QLabel* m_status{ nullptr };
+    QTimer* m_progressTimer{ nullptr };
+
+    QString m_path;
+    std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    std::shared_ptr<const SequencePyramid> m_pyramid;
+    QString m_pyramidPath;
+    std::vector<std::pair<QString, std::shared_ptr<const SequencePyramid>>> m_recent;
+    std::shared_ptr<ScanProgress> m_progress;
+    uint64_t m_generation{ 0 };
+};
@@ -0,0 +1,269 @@
+#include "sequence_pyramid.h"
+
+#include "FSEQFile.h"
+
+#include "spdlog/spdlog.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    //level 0 stays around 2 MB however long or wide the sequence is
+    constexpr uint32_t MaxChannelBuckets = 4096;
+    constexpr uint32_t MaxFrameBuckets = 512;
+    //no point in halving further, the preview is never that small
+    constexpr uint32_t MinBuckets = 32;
+
+    constexpr char SidecarMagic[4] = { 'F', 'S', 'P', 'Y' };
+    constexpr uint16_t SidecarVersion = 2;
+
+    struct SidecarHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint64_t uniqueId;
+        uint32_t frames;
+        uint32_t channels;
+        uint32_t stepTime;
+        uint32_t channelsPerBucket;
+        uint32_t framesPerBucket;
+        uint32_t channelBuckets;
+        uint32_t frameBuckets;
+        uint32_t padding;
+    };
+    static_assert(sizeof(SidecarHeader) == 48);
+
+    uint32_t DivUp(uint32_t value, uint32_t divisor)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(value) + divisor - 1) / divisor);
+    }
+
+    PyramidLevel BaseLevel(uint32_t channels, uint32_t frames)
+    {
+        PyramidLevel level;
+        level.channelsPerBucket = std::max(1u, DivUp(channels, MaxChannelBuckets));
+        level.framesPerBucket = std::max(1u, DivUp(frames, MaxFrameBuckets));
+        level.channelBuckets = DivUp(channels, level.channelsPerBucket);
+        level.frameBuckets = DivUp(frames, level.framesPerBucket);
+        level.values.assign(static_cast<size_t>(level.channelBuckets) * level.frameBuckets, 0);
+        return level;
+    }
+
+    //folds one frame into its row of the base level
+    void AddFrame(PyramidLevel& level, uint32_t frame, const uint8_t* data, uint32_t channels)
+    {
+        uint8_t* row = level.values.data() + static_cast<size_t>(frame / level.framesPerBucket) * level.channelBuckets;
+        uint32_t const width = level.channelsPerBucket;
+        if (width == 1) {
+            MaxInto(row, data, channels);
+            return;
+        }
+        for (uint32_t b = 0; b < level.channelBuckets; ++b) {
+            uint32_t const start = b * width;
+            uint32_t const end = std::min(start + width, channels);
+            row[b] = std::max(row[b], *std::max_element(data + start, data + end));
+        }
+    }
+
+    PyramidLevel HalveLevel(PyramidLevel const& fine)
+    {
+        PyramidLevel level;
+        level.channelsPerBucket = fine.channelsPerBucket * 2;
+        level.framesPerBucket = fine.framesPerBucket * 2;
+        level.channelBuckets = DivUp(fine.channelBuckets, 2);
+        level.frameBuckets = DivUp(fine.frameBuckets, 2);
+        level.values.assign(static_cast<size_t>(level.channelBuckets) * level.frameBuckets, 0);
+        for (uint32_t f = 0; f < fine.frameBuckets; ++f) {
+            uint8_t* row = level.values.data() + static_cast<size_t>(f / 2) * level.channelBuckets;
+            for (uint32_t c = 0; c < fine.channelBuckets; ++c) {
+                row[c / 2] = std::max(row[c / 2], fine.at(f, c));
+            }
+        }
+        return level;
+    }
+
+    void BuildLevels(SequencePyramid& pyramid)
+    {
+        pyramid.levels.resize(1);
+        while (pyramid.levels.back().channelBuckets > MinBuckets || pyramid.levels.back().frameBuckets > MinBuckets) {
+            pyramid.levels.push_back(HalveLevel(pyramid.levels.back()));
+        }
+    }
+}
+
+PyramidLevel const& SequencePyramid::levelFor(double channelsPerPixel, double framesPerPixel) const
+{
+    for (size_t x = levels.size(); x-- > 1;) {
+        if (levels[x].channelsPerBucket <= channelsPerPixel && levels[x].framesPerBucket <= framesPerPixel) {
+            return levels[x];
+        }
+    }
+    return levels.front();
+}
+
+uint8_t SequencePyramid::maxOver(PyramidLevel const& level, uint32_t c0, uint32_t c1, uint32_t f0, uint32_t f1) const
+{
+    uint32_t const cb0 = c0 / level.channelsPerBucket;
+    uint32_t const cb1 = std::min(DivUp(c1, level.channelsPerBucket), level.channelBuckets);
+    uint32_t const fb0 = f0 / level.framesPerBucket;
+    uint32_t const fb1 = std::min(DivUp(f1, level.framesPerBucket), level.frameBuckets);
+    uint8_t value{ 0 };
+    for (uint32_t f = fb0; f < fb1; ++f) {
+        for (uint32_t c = cb0; c < cb1; ++c) {
+            value = std::max(value, level.at(f, c));
+        }
+    }
+    return value;
+}
+
+uint64_t SequencePyramid::litChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges) const
+{
+    uint64_t lit{ 0 };
+    for (auto const& [start, count] : ranges) {
+        uint32_t const end = std::min<uint64_t>(static_cast<uint64_t>(start) + count, activity.channels());
+        for (uint32_t c = start; c < end; ++c) {
+            lit += !activity.isDark(c);
+        }
+    }
+    return lit;
+}
+
+SequencePyramid BuildSequencePyramid(std::string const& path, ScanProgress* progress, unsigned threads)
+{
+    TRACE_SCOPE_CAT("BuildSequencePyramid", "analysis");
+    SequencePyramid pyramid;
+    std::unique_ptr<FSEQFile> src(FSEQFile::openFSEQFile(path));
+    if (nullptr == src) {
+        spdlog::error("Error opening input file: {}", path);
+        return pyramid;
+    }
+    uint32_t const channels = src->getMaxChannel();
+    uint32_t const frames = src->getNumFrames();
+    if (channels == 0 || frames == 0) {
+        return pyramid;
+    }
+    auto const starts = SplitFrameSpans(*src, ScanThreads(threads));
+    size_t const spans = starts.size() - 1;
+
+    //each span gets its own base level, spans are not aligned to frame buckets
+    std::vector<PyramidLevel> bases(spans, BaseLevel(channels, frames));
+    std::vector<ChannelActivityAccumulator> accumulators(spans, ChannelActivityAccumulator(channels));
+    std::vector<char> ok(spans, 0);
+    std::vector<std::thread> workers;
+    for (size_t x = 0; x < spans; ++x) {
+        workers.emplace_back([&, x]() {
+            Trace::SetThreadName("pyramid " + std::to_string(x));
+            ok[x] = ScanFrames(path, starts[x], starts[x + 1], channels, progress,
+                [&base = bases[x], &acc = accumulators[x], channels](uint32_t frame, const uint8_t* data) {
+                    AddFrame(base, frame, data, channels);
+                    acc.add(data);
+                });
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        return pyramid;
+    }
+
+    for (size_t x = 1; x < spans; ++x) {
+        MaxInto(bases[0].values.data(), bases[x].values.data(), bases[0].values.size());
+        accumulators[0].append(accumulators[x]);
+    }
+    pyramid.uniqueId = src->getUniqueId();
+    pyramid.frames = frames;
+    pyramid.channels = channels;
+    pyramid.stepTime = src->getStepTime();
+    pyramid.activity = accumulators[0].result(pyramid.uniqueId);
+    //same as ScanChannelActivity, the cache is matched against the header count
+    pyramid.activity.frames = frames;
+    pyramid.levels.push_back(std::move(bases[0]));
+    BuildLevels(pyramid);
+    pyramid.valid = true;
+    return pyramid;
+}
+
+std::string SequencePyramidPath(std::string const& path)
+{
+    return path + ".preview";
+}
+
+SequencePyramid LoadSequencePyramid(std::string const& path)
+{
+    TRACE_SCOPE_CAT("LoadSequencePyramid", "analysis");
+    std::ifstream in(SequencePyramidPath(path), std::ios::binary);
+    if (!in) {
+        return SequencePyramid();
+    }
+    SidecarHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !std::equal(std::begin(SidecarMagic), std::end(SidecarMagic), header.magic) || header.version != SidecarVersion) {
+        return SequencePyramid();
+    }
+    //the activity sidecar is checked against the sequence, this one only has to match it
+    auto activity = LoadChannelActivity(path);
+    if (!activity.valid || activity.uniqueId != header.uniqueId || activity.frames != header.frames ||
+        activity.channels() != header.channels) {
+        return SequencePyramid();
+    }
+    //a sidecar from a different build could use other bucket sizes
+    PyramidLevel base = BaseLevel(header.channels, header.frames);
+    if (base.channelsPerBucket != header.channelsPerBucket || base.framesPerBucket != header.framesPerBucket ||
+        base.channelBuckets != header.channelBuckets || base.frameBuckets != header.frameBuckets) {
+        return SequencePyramid();
+    }
+    SequencePyramid pyramid;
+    pyramid.uniqueId = header.uniqueId;
+    pyramid.frames = header.frames;
+    pyramid.channels = header.channels;
+    pyramid.stepTime = header.stepTime;
+    pyramid.activity = std::move(activity);
+    in.read(reinterpret_cast<char*>(base.values.data()), base.values.size());
+    if (!in) {
+        return SequencePyramid();
+    }
+    pyramid.levels.push_back(std::move(base));
+    BuildLevels(pyramid);
+    pyramid.valid = true;
+    return pyramid;
+}
+
+bool SaveSequencePyramid(std::string const& path, SequencePyramid const& pyramid)
+{
+    if (!pyramid.valid || !SaveChannelActivity(path, pyramid.activity)) {
+        return false;
+    }
+    auto const& base = pyramid.levels.front();
+    SidecarHeader header{};
+    std::copy(std::begin(SidecarMagic), std::end(SidecarMagic), header.magic);
+    header.version = SidecarVersion;
+    header.uniqueId = pyramid.uniqueId;
+    header.frames = pyramid.frames;
+    header.channels = pyramid.channels;
+    header.stepTime = pyramid.stepTime;
+    header.channelsPerBucket = base.channelsPerBucket;
+    header.framesPerBucket = base.framesPerBucket;
+    header.channelBuckets = base.channelBuckets;
+    header.frameBuckets = base.frameBuckets;
+    return WriteSidecarFile(SequencePyramidPath(path), {
+        { &header, sizeof(header) },
+        { base.values.data(), base.values.size() } });
+}
+
+SequencePyramid GetSequencePyramid(std::string const& path, ScanProgress* progress, unsigned threads)
+{
+    auto pyramid = LoadSequencePyramid(path);
+    if (pyramid.valid) {
+        return pyramid;
+    }
+    pyramid = BuildSequencePyramid(path, progress, threads);
+    SaveSequencePyramid(path, pyramid);
+    return pyramid;
+}
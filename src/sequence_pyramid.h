@@ -0,0 +1,51 @@
+#pragma once
+
+#include "channel_activity.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Max value of each channel bucket over each frame bucket, buckets double in size every level
+struct PyramidLevel
+{
+    uint32_t channelsPerBucket{ 1 };
+    uint32_t framesPerBucket{ 1 };
+    uint32_t channelBuckets{ 0 };
+    uint32_t frameBuckets{ 0 };
+    std::vector<uint8_t> values; //frameBuckets rows of channelBuckets
+
+    [[nodiscard]] uint8_t at(uint32_t frameBucket, uint32_t channelBucket) const { return values[static_cast<size_t>(frameBucket) * channelBuckets + channelBucket]; }
+};
+
+//Decimated overview of a whole sequence for previews, level 0 is the finest
+struct SequencePyramid
+{
+    bool valid{ false };
+    uint64_t uniqueId{ 0 };
+    uint32_t frames{ 0 };
+    uint32_t channels{ 0 };
+    uint32_t stepTime{ 0 };
+    //exact per channel statistics from the same scan, the export's dark channel trim reads them too
+    ChannelActivity activity;
+    std::vector<PyramidLevel> levels;
+
+    //coarsest level that still resolves the given channels and frames per pixel
+    [[nodiscard]] PyramidLevel const& levelFor(double channelsPerPixel, double framesPerPixel) const;
+    //max over the 0-based channels [c0, c1) and frames [f0, f1), rounded out to whole buckets
+    [[nodiscard]] uint8_t maxOver(PyramidLevel const& level, uint32_t c0, uint32_t c1, uint32_t f0, uint32_t f1) const;
+    //exact count of channels in the 0-based ranges that are on in any frame
+    [[nodiscard]] uint64_t litChannels(std::vector<std::pair<uint32_t, uint32_t>> const& ranges) const;
+};
+
+//Decodes the sequence in block aligned spans on separate threads, collecting the pyramid and the
+//channel activity in one pass. Returns an invalid result on errors or cancel.
+SequencePyramid BuildSequencePyramid(std::string const& path, ScanProgress* progress = nullptr, unsigned threads = 0);
+
+//level 0 is cached in a sidecar next to the sequence, coarser levels are rebuilt on load and
+//the activity lives in the ChannelActivityPath sidecar
+std::string SequencePyramidPath(std::string const& path);
+SequencePyramid LoadSequencePyramid(std::string const& path);
+bool SaveSequencePyramid(std::string const& path, SequencePyramid const& pyramid);
+//cached pyramid when it matches the sequence, otherwise builds and stores it
+SequencePyramid GetSequencePyramid(std::string const& path, ScanProgress* progress = nullptr, unsigned threads = 0);
@@ -0,0 +1,141 @@
+#include "storage_probe.h"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t ChunkSize = 1024 * 1024;
+
+    void SyncFile(FILE* file)
+    {
+        fflush(file);
+#if defined(_WIN32)
+        _commit(_fileno(file));
+#else
+        fsync(fileno(file));
+#endif
+    }
+
+    //without this the read pass measures the page cache instead of the card, Windows has
+    //no call for it and reads around the cache in ReadMBps instead
+    void DropCache(FILE* file)
+    {
+#if defined(__linux__)
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_DONTNEED);
+#elif defined(__APPLE__)
+        fcntl(fileno(file), F_NOCACHE, 1);
+#else
+        (void)file;
+#endif
+    }
+
+    double MBps(uint64_t bytes, std::chrono::steady_clock::duration elapsed)
+    {
+        double const seconds = std::chrono::duration<double>(elapsed).count();
+        if (seconds <= 0.0) {
+            return 0.0;
+        }
+        return bytes / (1024.0 * 1024.0) / seconds;
+    }
+
+    //read the test file back from the card, 0 when it can't be opened
+    double ReadMBps(std::string const& path)
+    {
+#if defined(_WIN32)
+        //unbuffered reads skip the cache but need sector aligned buffers and sizes,
+        //ChunkSize is a multiple of every sector size in use
+        HANDLE const file = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return 0.0;
+        }
+        void* buffer = _aligned_malloc(ChunkSize, 4096);
+        if (buffer == nullptr) {
+            CloseHandle(file);
+            return 0.0;
+        }
+        auto const start = std::chrono::steady_clock::now();
+        uint64_t read{ 0 };
+        DWORD r{ 0 };
+        while (ReadFile(file, buffer, static_cast<DWORD>(ChunkSize), &r, nullptr) && r > 0) {
+            read += r;
+        }
+        double const mbps = MBps(read, std::chrono::steady_clock::now() - start);
+        _aligned_free(buffer);
+        CloseHandle(file);
+        return mbps;
+#else
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return 0.0;
+        }
+        DropCache(file);
+        std::vector<uint8_t> buffer(ChunkSize);
+        auto const start = std::chrono::steady_clock::now();
+        uint64_t read{ 0 };
+        size_t r{ 0 };
+        while ((r = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+            read += r;
+        }
+        double const mbps = MBps(read, std::chrono::steady_clock::now() - start);
+        fclose(file);
+        return mbps;
+#endif
+    }
+}
+
+StorageSpeed ProbeStorageSpeed(std::string const& directory, uint64_t testBytes)
+{
+    StorageSpeed speed;
+    auto const path = (std::filesystem::path(directory) / ".controller_gen_speed_test.tmp").string();
+
+    //random looking data so a compressing file system can't cheat
+    std::vector<uint8_t> buffer(ChunkSize);
+    uint32_t seed = 0x9E3779B9;
+    for (auto& b : buffer) {
+        seed = seed * 1664525 + 1013904223;
+        b = static_cast<uint8_t>(seed >> 24);
+    }
+    uint64_t const chunks = std::max<uint64_t>(1, testBytes / ChunkSize);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        spdlog::error("Speed test could not create {}", path);
+        return speed;
+    }
+    auto const start = std::chrono::steady_clock::now();
+    uint64_t written{ 0 };
+    for (uint64_t x = 0; x < chunks; x++) {
+        written += fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+    SyncFile(file);
+    speed.writeMBps = MBps(written, std::chrono::steady_clock::now() - start);
+    DropCache(file);
+    fclose(file);
+
+    speed.readMBps = ReadMBps(path);
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (written != chunks * ChunkSize) {
+        spdlog::error("Speed test wrote {} of {} bytes to {}", written, chunks * ChunkSize, directory);
+        speed = StorageSpeed();
+    }
+    return speed;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct StorageSpeed
+{
+    double writeMBps{ 0.0 };
+    double readMBps{ 0.0 };
+
+    [[nodiscard]] bool valid() const { return writeMBps > 0.0 && readMBps > 0.0; }
+};
+
+//Writes, syncs and reads back a scratch file in directory. Blocks for a few
+//seconds on slow cards, call it from a worker thread.
+StorageSpeed ProbeStorageSpeed(std::string const& directory, uint64_t testBytes = 32 * 1024 * 1024);
@@ -0,0 +1,127 @@
+#include "trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace
+{
+    std::atomic<bool> g_enabled{ false };
+
+    namespace
+    {
+        struct Event
+        {
+            const char* name;
+            const char* category;
+            uint64_t start;
+            uint64_t duration;
+        };
+
+        //one buffer per thread, only the owning thread appends while recording
+        struct ThreadBuffer
+        {
+            uint32_t tid{ 0 };
+            std::string name;
+            std::mutex lock;
+            std::vector<Event> events;
+            uint64_t dropped{ 0 };
+        };
+
+        //keeps a runaway recording from eating all memory, roughly 32MB per thread
+        constexpr size_t MaxEventsPerThread = 1024 * 1024;
+
+        std::mutex g_registryLock;
+        std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+        uint32_t g_nextTid{ 1 };
+
+        auto const g_epoch = std::chrono::steady_clock::now();
+
+        ThreadBuffer& LocalBuffer()
+        {
+            //the registry holds a reference too, so events survive pool threads exiting
+            thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+                auto b = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(g_registryLock);
+                b->tid = g_nextTid++;
+                g_buffers.push_back(b);
+                return b;
+            }();
+            return *buffer;
+        }
+    }
+
+    uint64_t NowMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_epoch).count();
+    }
+
+    void Record(const char* name, const char* category, uint64_t startUs, uint64_t durationUs)
+    {
+        auto& buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.lock);
+        if (buffer.events.size() >= MaxEventsPerThread) {
+            ++buffer.dropped;
+            return;
+        }
+        buffer.events.push_back({ name, category, startUs, durationUs });
+    }
+
+    void SetThreadName(std::string const& name)
+    {
+        auto& buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.lock);
+        buffer.name = name;
+    }
+
+    void Start()
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_registryLock);
+            for (auto& buffer : g_buffers) {
+                std::lock_guard<std::mutex> bufferLock(buffer->lock);
+                buffer->events.clear();
+                buffer->dropped = 0;
+            }
+        }
+        g_enabled = true;
+    }
+
+    int64_t Stop(std::string const& path)
+    {
+        g_enabled = false;
+
+        std::ofstream out(path);
+        if (!out) {
+            return -1;
+        }
+        int64_t count{ 0 };
+        bool first{ true };
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        std::lock_guard<std::mutex> lock(g_registryLock);
+        for (auto& buffer : g_buffers) {
+            std::lock_guard<std::mutex> bufferLock(buffer->lock);
+            if (buffer->events.empty()) {
+                continue;
+            }
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"" << (buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name) << "\"}}";
+            first = false;
+            for (auto const& event : buffer->events) {
+                out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":" << event.start
+                    << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << buffer->tid << "}";
+            }
+            if (buffer->dropped != 0) {
+                out << ",\n{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << buffer->events.back().start
+                    << ",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"count\":" << buffer->dropped << "}}";
+            }
+            count += buffer->events.size();
+            buffer->events.clear();
+            buffer->events.shrink_to_fit();
+        }
+        out << "\n]}\n";
+        return out.good() ? count : -1;
+    }
+}
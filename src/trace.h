@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//Opt in timeline recorder. Events are kept in per thread buffers while recording
+//and written out as a Chrome trace JSON file that loads in Perfetto or chrome://tracing.
+namespace Trace
+{
+    extern std::atomic<bool> g_enabled;
+
+    inline bool IsEnabled()
+    {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    void Start();
+    void SetThreadName(std::string const& name);
+    //stops recording and writes everything recorded since Start(), returns the event count or -1 on error
+    int64_t Stop(std::string const& path);
+
+    uint64_t NowMicros();
+    //name and category must be string literals, only the pointer is stored
+    void Record(const char* name, const char* category, uint64_t startUs, uint64_t durationUs);
+
+    class Scope
+    {
+    public:
+        Scope(const char* name, const char* category) :
+            m_name(name),
+            m_category(category),
+            m_active(IsEnabled())
+        {
+            if (m_active) {
+                m_start = NowMicros();
+            }
+        }
+        ~Scope()
+        {
+            if (m_active) {
+                Record(m_name, m_category, m_start, NowMicros() - m_start);
+            }
+        }
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+    private:
+        const char* m_name;
+        const char* m_category;
+        bool m_active;
+        uint64_t m_start{ 0 };
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name, "fseq")
+#define TRACE_SCOPE_CAT(name, category) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name, category)
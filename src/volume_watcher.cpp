@@ -0,0 +1,168 @@
+#include "volume_watcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QSocketNotifier>
+#include <QStorageInfo>
+#include <QTimer>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+QString VolumeInfo::label() const
+{
+    auto const gb = [](qint64 bytes) { return QString::number(bytes / (1024.0 * 1024.0 * 1024.0), 'f', 1); };
+    QString name = displayName.isEmpty() ? rootPath : displayName;
+    return QString("%1 (%2) - %3 of %4 GB free, %5").arg(name).arg(rootPath).arg(gb(bytesFree)).arg(gb(bytesTotal)).arg(fileSystemType);
+}
+
+QString VolumeInfo::identity() const
+{
+    QString key = QString("%1_%2_%3").arg(displayName).arg(bytesTotal).arg(fileSystemType);
+    key.replace('/', '_').replace('\\', '_');
+    return key;
+}
+
+bool VolumeInfo::operator==(VolumeInfo const& other) const
+{
+    //free space is left out on purpose, it changes during every export
+    return rootPath == other.rootPath && device == other.device && displayName == other.displayName &&
+        fileSystemType == other.fileSystemType && bytesTotal == other.bytesTotal && removable == other.removable;
+}
+
+VolumeWatcher::VolumeWatcher(QObject* parent) :
+    QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+
+    m_debounce = new QTimer(this);
+    m_debounce->setSingleShot(true);
+    //mount events come in bursts when a card with several partitions is inserted
+    m_debounce->setInterval(250);
+    connect(m_debounce, &QTimer::timeout, this, &VolumeWatcher::rescan);
+}
+
+VolumeWatcher::~VolumeWatcher()
+{
+    m_pool.waitForDone();
+#if defined(__linux__)
+    if (m_mountFd >= 0) {
+        ::close(m_mountFd);
+    }
+#endif
+}
+
+void VolumeWatcher::start()
+{
+#if defined(__linux__)
+    //the kernel flags POLLPRI on mountinfo whenever the mount table changes
+    m_mountFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (m_mountFd >= 0) {
+        m_mountNotifier = new QSocketNotifier(m_mountFd, QSocketNotifier::Exception, this);
+        connect(m_mountNotifier, QOverload<QSocketDescriptor, QSocketNotifier::Type>::of(&QSocketNotifier::activated), m_debounce, qOverload<>(&QTimer::start));
+    }
+#endif
+    if (m_mountNotifier == nullptr) {
+        m_pollTimer = new QTimer(this);
+        m_pollTimer->setInterval(2000);
+        connect(m_pollTimer, &QTimer::timeout, this, &VolumeWatcher::rescan);
+        m_pollTimer->start();
+    }
+    rescan();
+}
+
+void VolumeWatcher::rescan()
+{
+    if (m_scanPending.exchange(true)) {
+        return;
+    }
+    m_pool.start([this]() {
+        m_scanPending = false;
+        auto volumes = enumerate(m_showAll);
+        QMetaObject::invokeMethod(this, [this, volumes = std::move(volumes)]() mutable { publish(std::move(volumes)); }, Qt::QueuedConnection);
+    });
+}
+
+void VolumeWatcher::setShowAllVolumes(bool showAll)
+{
+    if (m_showAll.exchange(showAll) != showAll) {
+        m_forceNotify = true;
+        rescan();
+    }
+}
+
+void VolumeWatcher::publish(QList<VolumeInfo> volumes)
+{
+    if (!m_forceNotify && volumes == m_volumes) {
+        return;
+    }
+    m_forceNotify = false;
+    m_volumes = std::move(volumes);
+    emit volumesChanged(m_volumes);
+}
+
+QList<VolumeInfo> VolumeWatcher::enumerate(bool showAll)
+{
+    QList<VolumeInfo> volumes;
+    for (QStorageInfo const& storage : QStorageInfo::mountedVolumes()) {
+        if (!storage.isValid() || !storage.isReady() || storage.isReadOnly()) {
+            continue;
+        }
+        VolumeInfo info;
+        info.rootPath = storage.rootPath();
+        info.displayName = storage.displayName();
+        info.device = QString::fromUtf8(storage.device());
+        info.fileSystemType = QString::fromUtf8(storage.fileSystemType());
+        info.bytesFree = storage.bytesAvailable();
+        info.bytesTotal = storage.bytesTotal();
+        info.removable = isRemovable(info.rootPath, info.device);
+        if (info.removable || showAll) {
+            volumes.append(info);
+        }
+    }
+    return volumes;
+}
+
+bool VolumeWatcher::isRemovable(QString const& rootPath, QString const& device)
+{
+#if defined(_WIN32)
+    Q_UNUSED(device);
+    return GetDriveTypeW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(rootPath).utf16())) == DRIVE_REMOVABLE;
+#elif defined(__linux__)
+    if (!device.startsWith("/dev/")) {
+        return false;
+    }
+    //partitions live under their parent disk in sysfs, walk up to the disk
+    QString const name = QFileInfo(device).canonicalFilePath().section('/', -1);
+    QString sysPath = QFileInfo("/sys/class/block/" + name).canonicalFilePath();
+    if (sysPath.isEmpty()) {
+        return false;
+    }
+    if (!QFile::exists(sysPath + "/removable") || QFile::exists(sysPath + "/partition")) {
+        sysPath = QFileInfo(sysPath + "/..").canonicalFilePath();
+    }
+    QFile removable(sysPath + "/removable");
+    if (removable.open(QIODevice::ReadOnly) && removable.read(1) == "1") {
+        return true;
+    }
+    //built in SD slots report 0, as do many USB card readers
+    if (name.startsWith("mmcblk") || sysPath.contains("/usb")) {
+        return true;
+    }
+    return rootPath.startsWith("/media/") || rootPath.startsWith("/run/media/");
+#elif defined(__APPLE__)
+    Q_UNUSED(device);
+    return rootPath.startsWith("/Volumes/");
+#else
+    Q_UNUSED(rootPath);
+    Q_UNUSED(device);
+    return true;
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+
+class QSocketNotifier;
+class QTimer;
+
+struct VolumeInfo
+{
+    QString rootPath;
+    QString displayName;
+    QString device;
+    QString fileSystemType;
+    qint64 bytesFree{ 0 };
+    qint64 bytesTotal{ 0 };
+    bool removable{ false };
+
+    [[nodiscard]] QString label() const;
+    //stable across re-insertions, unlike the device node or mount point
+    [[nodiscard]] QString identity() const;
+    bool operator==(VolumeInfo const& other) const;
+};
+
+//Tracks mounted volumes without blocking the UI thread. On Linux the mount table
+//is watched through /proc/self/mountinfo, elsewhere it is polled on a worker thread.
+class VolumeWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VolumeWatcher(QObject* parent = nullptr);
+    ~VolumeWatcher();
+
+    void start();
+    void rescan();
+
+    void setShowAllVolumes(bool showAll);
+    [[nodiscard]] bool showAllVolumes() const { return m_showAll; }
+
+Q_SIGNALS:
+    void volumesChanged(QList<VolumeInfo> const& volumes);
+
+private:
+    static QList<VolumeInfo> enumerate(bool showAll);
+    static bool isRemovable(QString const& rootPath, QString const& device);
+    void publish(QList<VolumeInfo> volumes);
+
+    QThreadPool m_pool;
+    QTimer* m_debounce{ nullptr };
+    QTimer* m_pollTimer{ nullptr };
+    QSocketNotifier* m_mountNotifier{ nullptr };
+    int m_mountFd{ -1 };
+
+    std::atomic<bool> m_showAll{ false };
+    std::atomic<bool> m_scanPending{ false };
+    bool m_forceNotify{ true };
+    QList<VolumeInfo> m_volumes;
+};